@@ -0,0 +1,67 @@
+// Asset baker.
+//
+// Converts source assets into an asset pack (see classes/AssetPack.h) that
+// the runtime maps and uploads without decoding or parsing anything:
+//
+//   ./baker assets.pack
+//       --shader vertexShader.glsl ../src/shaders/vertexShader.glsl
+//       --texture texture.png ../src/resources/texture.png
+//       --mesh grid model.obj
+//
+// Each asset is stored under the given name.
+
+#include "classes/AssetPackWriter.h"
+#include "classes/JobSystem.h"
+#include "classes/Log.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static void printUsage() {
+    cerr << "Usage: baker OUTPUT [--mesh NAME FILE.obj] [--texture NAME IMAGE] "
+            "[--shader NAME FILE]..."
+         << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    Log::Start(stderr);
+
+    const char *outputPath = argv[1];
+    JobSystem jobs;
+    AssetPackWriter writer;
+    for (int i = 2; i < argc; i++) {
+        if (i + 2 >= argc) {
+            printUsage();
+            return 2;
+        }
+        const char *name = argv[i + 1];
+        const char *path = argv[i + 2];
+        bool added;
+        if (strcmp(argv[i], "--mesh") == 0) {
+            added = writer.AddMeshFile(name, path, &jobs);
+        } else if (strcmp(argv[i], "--texture") == 0) {
+            added = writer.AddTextureFile(name, path);
+        } else if (strcmp(argv[i], "--shader") == 0) {
+            added = writer.AddShaderFile(name, path);
+        } else {
+            printUsage();
+            return 2;
+        }
+        if (!added) {
+            return 1;
+        }
+        i += 2;
+    }
+
+    if (!writer.Write(outputPath)) {
+        return 1;
+    }
+    cout << "Wrote " << writer.EntryCount() << " assets, " << writer.Size()
+         << " bytes, to " << outputPath << endl;
+    return 0;
+}
@@ -0,0 +1,450 @@
+// Deterministic frame benchmark.
+//
+// Renders a fixed number of frames of a scripted scene in headless mode and
+// prints CPU frame time, GL submit time and GPU time percentiles as JSON.
+// The scenes live in src/bench; this file runs the frame loop they share
+// and writes the report.
+//
+//   ./bench --scene draws --frames 500 --output bench.json
+#include "bench/Bench.h"
+#include "classes/ElementBufferObject.h"
+#include "classes/FrameBufferObject.h"
+#include "classes/GLDebug.h"
+#include "classes/GLDispatch.h"
+#include "classes/GLHandlePool.h"
+#include "classes/GpuProfiler.h"
+#include "classes/HeadlessContext.h"
+#include "classes/JobSystem.h"
+#include "classes/Log.h"
+#include "classes/Shader.h"
+#include "classes/Texture.h"
+#include "classes/Trace.h"
+#include "classes/UniformRing.h"
+#include "classes/VertexArrayObject.h"
+#include "classes/VertexBufferObject.h"
+#include "glad/glad.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// GPU timer queries are read this many frames late so reading never stalls.
+const int QUERY_LATENCY = 4;
+
+// Quads the draws scene draws each frame.
+const int DRAWS_PER_FRAME = 1000;
+
+// Same quad as the demo.
+float vertices[] = {
+    //     COORDINATES     /        COLORS      /   TexCoord  //
+    -0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, // Lower left corner
+    -0.5f, 0.5f,  0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, // Upper left corner
+    0.5f,  0.5f,  0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, // Upper right corner
+    0.5f,  -0.5f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f  // Lower right corner
+};
+
+unsigned int indices[] = {
+    0, 2, 1, // upper triangle
+    0, 3, 2  // lower triangle
+};
+
+static BenchScene *createQuadScene(const Options &) {
+    return new BenchScene(1);
+}
+
+static BenchScene *createDrawsScene(const Options &) {
+    return new BenchScene(DRAWS_PER_FRAME);
+}
+
+// A scene --scene can name, and the function that creates it.
+struct SceneEntry {
+    const char *name;
+    BenchScene *(*create)(const Options &options);
+};
+
+const SceneEntry SCENES[] = {
+    // The demo scene.
+    {"quad", createQuadScene},
+    // Many small draws.
+    {"draws", createDrawsScene},
+    // Shader compile, image decode.
+    {"assets", CreateAssetsScene},
+    // Frustum cull 1M boxes.
+    {"cull", CreateCullScene},
+    // BVH build and queries.
+    {"bvh", CreateBvhScene},
+    // Software occlusion.
+    {"occlusion", CreateOcclusionScene},
+    // 111100 transforms.
+    {"transforms", CreateTransformsScene},
+    // SIMD against scalar.
+    {"math", CreateMathScene},
+    // 500K triangle OBJ load.
+    {"obj", CreateObjScene},
+    // 500K triangle GLB load.
+    {"glb", CreateGlbScene},
+    // Startup from source files against a baked asset pack.
+    {"startup", CreateStartupScene},
+    // Fly past 32 streamed textures, three times the budget.
+    {"streaming", CreateStreamingScene},
+    // Fly over a 32K x 32K virtual texture.
+    {"virtual", CreateVirtualScene},
+    // Create and delete 10000 buffers through the pool and one by one.
+    {"handles", CreateHandlesScene},
+    // Load and unload 20000 buffers, half the levels through the deferred
+    // deletion queue.
+    {"unload", CreateUnloadScene},
+    // Per-frame draw lists of 100000 objects on the heap and in arenas.
+    {"arena", CreateArenaScene},
+    // The demo scene capped at 60 FPS by the frame pacer.
+    {"paced", CreatePacedScene},
+    // 20000 particles simulated at a fixed rate, on the render thread for
+    // the first half of the frames and on their own for the second.
+    {"sim", CreateSimScene},
+};
+
+static void printUsage() {
+    cerr << "Usage: bench [--scene ";
+    const char *separator = "";
+    for (const SceneEntry &entry : SCENES) {
+        cerr << separator << entry.name;
+        separator = "|";
+    }
+    cerr << "] [--frames N] [--warmup N] [--output FILE] [--gl-debug] "
+            "[--count-calls] [--mock] [--objects N] [--model FILE]"
+         << endl;
+}
+
+static bool parseArguments(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            options.scene = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--gl-debug") == 0) {
+            options.glDebug = true;
+        } else if (strcmp(argv[i], "--count-calls") == 0) {
+            options.countCalls = true;
+        } else if (strcmp(argv[i], "--mock") == 0) {
+            options.countCalls = true;
+            options.mock = true;
+        } else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            options.objects = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            options.modelPath = argv[++i];
+        } else {
+            printUsage();
+            return false;
+        }
+    }
+    return options.frames > 0 && options.warmup >= 0;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 2;
+    }
+
+    const SceneEntry *entry = NULL;
+    for (const SceneEntry &candidate : SCENES) {
+        if (options.scene == candidate.name) {
+            entry = &candidate;
+        }
+    }
+    if (entry == NULL) {
+        cerr << "Unknown scene: " << options.scene << endl;
+        return 2;
+    }
+
+    // Keep stdout for the JSON report.
+    Log::Start(stderr);
+
+    // Writes bench_trace.json at exit when built with -DLEARNGL_TRACE=ON.
+    TRACE_BEGIN_SESSION("bench_trace.json");
+
+    // The mock dispatch needs no context at all, so it runs on any machine.
+    HeadlessContext *context = NULL;
+    if (options.mock) {
+        GLDispatch::InstallRecording(GLDispatch::Mock);
+    } else {
+        context = new HeadlessContext(3, 3, options.glDebug);
+        if (!context->IsValid() || !context->MakeCurrent() ||
+            !gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress)) {
+            LOG_ERROR("Failed to create headless context");
+            return 1;
+        }
+
+        if (options.countCalls) {
+            GLDispatch::InstallRecording(GLDispatch::Forward);
+        }
+    }
+
+    // Asynchronous so the callback does not distort the timings.
+    if (options.glDebug && !options.mock) {
+        GLDebug::Install(false, (GLADloadproc)HeadlessContext::GetProcAddress);
+    }
+
+    FrameBufferObject offscreen(FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
+    if (!offscreen.IsComplete()) {
+        LOG_ERROR("Offscreen framebuffer is incomplete");
+        return 1;
+    }
+
+    // Scene setup, identical to the demo.
+    Shader shader("../src/shaders/vertexShader.glsl",
+                  "../src/shaders/fragmentShader.glsl");
+
+    VertexArrayObject VAO;
+    VAO.Bind();
+    VertexBufferObject VBO(vertices, sizeof(vertices));
+    ElementBufferObject EBO(indices, sizeof(indices));
+    linkMeshAttribs(VAO, VBO);
+    VAO.Unbind();
+    VBO.Unbind();
+    EBO.Unbind();
+
+    JobSystem jobs;
+    BenchScene *scene = entry->create(options);
+
+    shader.bindUniformBlock("PerDraw", PER_DRAW_BINDING);
+    UniformBlockLayout perDrawLayout = shader.getUniformBlockLayout("PerDraw");
+    GLint scaleOffset = perDrawLayout.members["scale"].offset;
+    vector<unsigned char> perDraw(perDrawLayout.size);
+    // Room for the scene's own blocks after its quads'.
+    UniformRing uniformRing((scene->MaxDraws() + 1) * 256);
+
+    Texture face("../src/resources/texture.png", GL_TEXTURE_2D, GL_TEXTURE0,
+                 GL_RGBA, GL_UNSIGNED_BYTE);
+    face.textureUnit(shader, "tex0", 0);
+
+    Bench bench = {options,     jobs, offscreen, shader, face, VAO,
+                   uniformRing, &VAO, 6,         0,      0};
+    if (!scene->Setup(bench)) {
+        return 1;
+    }
+
+    // One GL_TIME_ELAPSED query per frame in a small ring.
+    GLuint queries[QUERY_LATENCY];
+    glGenQueries(QUERY_LATENCY, queries);
+
+    // Per-phase GPU timings.
+    GpuProfiler gpuProfiler(options.frames);
+
+    vector<double> cpuFrameTimes, submitTimes, gpuTimes;
+    long long uniformBytes = 0;
+
+    int totalFrames = options.warmup + options.frames;
+    for (int index = 0; index < totalFrames; index++) {
+        TRACE_SCOPE("frame");
+        Frame frame = {index, index >= options.warmup, scene->drawsPerFrame,
+                       0.0};
+        scene->WaitForFrame();
+        Clock::time_point frameStart = Clock::now();
+
+        // Only count the calls of measured frames.
+        if (index == options.warmup) {
+            GLDispatch::Reset();
+        }
+
+        // Collect the query issued QUERY_LATENCY frames ago.
+        GLuint query = queries[index % QUERY_LATENCY];
+        if (index >= QUERY_LATENCY) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if (index - QUERY_LATENCY >= options.warmup) {
+                gpuTimes.push_back(elapsed / 1.0e6);
+            }
+        }
+
+        scene->Update(bench, frame);
+
+        Clock::time_point submitStart = Clock::now();
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        gpuProfiler.BeginFrame();
+
+        {
+            TRACE_SCOPE("clear");
+            GpuScope gpuScope(gpuProfiler, "clear");
+            offscreen.Bind();
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        scene->Prepare(bench, frame);
+
+        // Deterministic per-draw constants: shrink every quad a little more.
+        vector<GLintptr> offsets(frame.draws);
+        {
+            TRACE_SCOPE("update constants");
+            uniformRing.BeginFrame();
+            for (int draw = 0; draw < frame.draws; draw++) {
+                float scale =
+                    scene->drawsPerFrame <= 1
+                        ? 1.0f
+                        : 0.1f - 0.09f * draw / scene->drawsPerFrame;
+                memcpy(perDraw.data() + scaleOffset, &scale, sizeof(scale));
+                offsets[draw] =
+                    uniformRing.Push(perDraw.data(), perDraw.size());
+            }
+            scene->PushConstants(bench, frame);
+            uniformRing.Unmap();
+        }
+
+        {
+            TRACE_SCOPE("draw");
+            GpuScope gpuScope(gpuProfiler, "draw");
+            shader.Activate();
+            face.Bind();
+            bench.drawVAO->Bind();
+            for (int draw = 0; draw < frame.draws; draw++) {
+                uniformRing.BindRange(PER_DRAW_BINDING, offsets[draw],
+                                      perDraw.size());
+                scene->DrawQuad(bench, draw);
+            }
+            scene->Draw(bench, frame);
+            uniformRing.EndFrame();
+        }
+
+        gpuProfiler.EndFrame();
+        frame.poolEndFrameTime =
+            timeMilliseconds([]() { GLHandlePool::EndFrame(); });
+        scene->EndFrame(bench, frame);
+        glEndQuery(GL_TIME_ELAPSED);
+        double submitTime = millisecondsSince(submitStart);
+
+        scene->Present();
+
+        if (frame.measured) {
+            cpuFrameTimes.push_back(millisecondsSince(frameStart));
+            submitTimes.push_back(submitTime);
+            bench.drawCalls += frame.draws;
+            bench.triangles +=
+                (long long)frame.draws * bench.drawIndexCount / 3;
+            uniformBytes += (long long)frame.draws * perDraw.size();
+        }
+    }
+
+    scene->Finish(bench);
+
+    // Drain the queries still in flight.
+    for (int index = totalFrames; index < totalFrames + QUERY_LATENCY;
+         index++) {
+        if (index - QUERY_LATENCY < options.warmup) {
+            continue;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[index % QUERY_LATENCY], GL_QUERY_RESULT,
+                              &elapsed);
+        gpuTimes.push_back(elapsed / 1.0e6);
+    }
+
+    // Snapshot before the readbacks below add their own calls.
+    uint64_t glCalls = GLDispatch::TotalCalls();
+    uint64_t glStateChanges = GLDispatch::StateChanges();
+    uint64_t glRedundantStateCalls = GLDispatch::RedundantStateCalls();
+    vector<pair<const char *, uint64_t>> glCallCounts =
+        GLDispatch::CallCounts();
+
+    gpuProfiler.Flush();
+    GLDebug::Counters glDebugCounters = GLDebug::GetCounters();
+
+    ofstream file;
+    if (options.outputPath != NULL) {
+        file.open(options.outputPath);
+        if (!file) {
+            LOG_ERROR("Failed to open %s", options.outputPath);
+            return 1;
+        }
+    }
+    ostream &out = options.outputPath != NULL ? file : cout;
+
+    out << "{\n"
+        << "  \"scene\": \"" << entry->name << "\",\n"
+        << "  \"renderer\": \"" << (const char *)glGetString(GL_RENDERER)
+        << "\",\n"
+        << "  \"width\": " << FRAMEBUFFER_WIDTH << ",\n"
+        << "  \"height\": " << FRAMEBUFFER_HEIGHT << ",\n"
+        << "  \"frames\": " << options.frames << ",\n"
+        << "  \"warmup\": " << options.warmup << ",\n"
+        << "  \"timings_ms\": {";
+    JsonObject timings(out);
+    timings.Samples("cpu_frame", cpuFrameTimes);
+    timings.Samples("gl_submit", submitTimes);
+    timings.Samples("gpu", gpuTimes);
+    scene->WriteTimings(bench, timings);
+    out << "\n  },\n"
+        << "  \"gpu_scopes_ms\": {";
+    const char *separator = "\n";
+    for (const auto &scope : gpuProfiler.Stats()) {
+        out << separator << "    \"" << scope.first
+            << "\": {\"mean\": " << scope.second.average
+            << ", \"min\": " << scope.second.min
+            << ", \"max\": " << scope.second.max << "}";
+        separator = ",\n";
+    }
+    out << "\n  },\n"
+        << "  \"counters\": {";
+    JsonObject counters(out);
+    counters.Number("draw_calls", bench.drawCalls);
+    counters.Number("draw_calls_per_frame",
+                    (double)bench.drawCalls / options.frames);
+    counters.Number("triangles", bench.triangles);
+    counters.Number("uniform_bytes", uniformBytes);
+    counters.Number("gpu_profiler_dropped_frames",
+                    gpuProfiler.DroppedFrames());
+    counters.Number("gl_debug_errors", glDebugCounters.high);
+    counters.Number("gl_debug_warnings", glDebugCounters.medium);
+    counters.Number("gl_debug_performance_warnings",
+                    glDebugCounters.performance);
+    counters.Number("peak_rss_megabytes", peakRssMegabytes());
+    scene->WriteCounters(bench, counters);
+    if (options.countCalls) {
+        counters.Number("gl_calls_per_frame",
+                        (double)glCalls / options.frames);
+        counters.Number("gl_state_changes_per_frame",
+                        (double)glStateChanges / options.frames);
+        counters.Number("gl_redundant_state_calls_per_frame",
+                        (double)glRedundantStateCalls / options.frames);
+    }
+    out << "\n  }";
+
+    if (options.countCalls) {
+        out << ",\n  \"gl_call_counts\": {";
+        JsonObject callCounts(out);
+        for (const auto &count : glCallCounts) {
+            callCounts.Number(count.first, count.second);
+        }
+        out << "\n  }";
+    }
+    out << "\n}" << endl;
+
+    glDeleteQueries(QUERY_LATENCY, queries);
+    VAO.Delete();
+    VBO.Delete();
+    EBO.Delete();
+    face.Delete();
+    uniformRing.Delete();
+    scene->Delete();
+    delete scene;
+    gpuProfiler.Delete();
+    shader.Delete();
+    offscreen.Delete();
+    GLHandlePool::FlushAll();
+    GLDispatch::Uninstall();
+    if (context != NULL) {
+        context->Delete();
+        delete context;
+    }
+    return 0;
+}
@@ -0,0 +1,465 @@
+#include "../classes/AssetPack.h"
+#include "../classes/AssetPackWriter.h"
+#include "../classes/ElementBufferObject.h"
+#include "../classes/GlbModel.h"
+#include "../classes/Log.h"
+#include "../classes/Mesh.h"
+#include "../classes/ObjLoader.h"
+#include "../classes/TextureDecoder.h"
+#include "../classes/Trace.h"
+#include "Bench.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Quads along each side of the grids the obj and glb scenes load, 500K
+// triangles, and of the grid the startup scene bakes.
+const int OBJ_GRID_SIZE = 500;
+const int GLB_GRID_SIZE = 500;
+const int STARTUP_GRID_SIZE = 200;
+
+// Writes a size x size grid of quads in the z = 0 plane, spanning
+// [-0.6, 0.6], as an OBJ file with texture coordinates.
+bool writeGridObj(const char *path, int size) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    char line[128];
+    string text;
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            float u = (float)x / size, v = (float)y / size;
+            int length = snprintf(line, sizeof(line),
+                                  "v %.6f %.6f 0.0 %.3f %.3f 1.0\nvt %.6f %.6f\n",
+                                  1.2f * u - 0.6f, 1.2f * v - 0.6f, u, v, u, v);
+            text.append(line, length);
+        }
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int corner = y * (size + 1) + x + 1;
+            int above = corner + size + 1;
+            int length = snprintf(line, sizeof(line),
+                                  "f %d/%d %d/%d %d/%d %d/%d\n", corner, corner,
+                                  corner + 1, corner + 1, above + 1, above + 1,
+                                  above, above);
+            text.append(line, length);
+        }
+    }
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    return fclose(file) == 0 && written;
+}
+
+// Writes the same grid as writeGridObj as a binary glTF file: positions and
+// texture coordinates interleaved as floats, normalized 8 bit colours in a
+// second buffer view, 32 bit indices and imagePath embedded as the base
+// colour texture.
+bool writeGridGlb(const char *path, int size, const char *imagePath) {
+    ifstream image(imagePath, ios::binary);
+    string png((istreambuf_iterator<char>(image)), istreambuf_iterator<char>());
+    if (png.empty()) {
+        return false;
+    }
+
+    int side = size + 1;
+    size_t vertexCount = (size_t)side * side;
+    vector<float> interleaved;
+    vector<unsigned char> colours;
+    vector<unsigned int> gridIndices;
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            float u = (float)x / size, v = (float)y / size;
+            // glTF texture coordinates start at the top of the image.
+            float vertex[] = {1.2f * u - 0.6f, 1.2f * v - 0.6f, 0.0f, u,
+                              1.0f - v};
+            interleaved.insert(interleaved.end(), vertex, vertex + 5);
+            unsigned char colour[] = {(unsigned char)(255 * u),
+                                      (unsigned char)(255 * v), 255, 255};
+            colours.insert(colours.end(), colour, colour + 4);
+        }
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            unsigned int corner = y * side + x;
+            unsigned int quad[] = {corner, corner + 1,        corner + side + 1,
+                                   corner, corner + side + 1, corner + side};
+            gridIndices.insert(gridIndices.end(), quad, quad + 6);
+        }
+    }
+
+    // Every buffer view starts 4 byte aligned.
+    string bin;
+    auto appendView = [&](const void *data, size_t bytes) {
+        size_t offset = bin.size();
+        bin.append((const char *)data, bytes);
+        bin.resize((bin.size() + 3) & ~(size_t)3, '\0');
+        return offset;
+    };
+    size_t vertexBytes = interleaved.size() * sizeof(float);
+    size_t colourBytes = colours.size();
+    size_t indexBytes = gridIndices.size() * sizeof(unsigned int);
+    size_t vertexOffset = appendView(interleaved.data(), vertexBytes);
+    size_t colourOffset = appendView(colours.data(), colourBytes);
+    size_t indexOffset = appendView(gridIndices.data(), indexBytes);
+    size_t imageOffset = appendView(png.data(), png.size());
+
+    char json[2048];
+    int jsonLength = snprintf(
+        json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\",\"generator\":\"bench\"},"
+        "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,"
+        "\"TEXCOORD_0\":1,\"COLOR_0\":2},\"indices\":3,\"material\":0}]}],"
+        "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorTexture\":"
+        "{\"index\":0}}}],"
+        "\"textures\":[{\"source\":0}],"
+        "\"images\":[{\"bufferView\":3,\"mimeType\":\"image/png\"}],"
+        "\"buffers\":[{\"byteLength\":%zu}],"
+        "\"bufferViews\":["
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,"
+        "\"byteStride\":20},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+        "\"accessors\":["
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,"
+        "\"type\":\"VEC3\",\"min\":[-0.6,-0.6,0],\"max\":[0.6,0.6,0]},"
+        "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,"
+        "\"count\":%zu,\"type\":\"VEC2\"},"
+        "{\"bufferView\":1,\"componentType\":5121,\"normalized\":true,"
+        "\"count\":%zu,\"type\":\"VEC4\"},"
+        "{\"bufferView\":2,\"componentType\":5125,\"count\":%zu,"
+        "\"type\":\"SCALAR\"}]}",
+        bin.size(), vertexOffset, vertexBytes, colourOffset, colourBytes,
+        indexOffset, indexBytes, imageOffset, png.size(), vertexCount,
+        vertexCount, vertexCount, gridIndices.size());
+    if (jsonLength < 0 || jsonLength >= (int)sizeof(json)) {
+        return false;
+    }
+    string chunk(json, jsonLength);
+    chunk.resize((chunk.size() + 3) & ~(size_t)3, ' ');
+
+    string text;
+    auto appendWord = [&](size_t word) {
+        uint32_t value = (uint32_t)word;
+        text.append((const char *)&value, sizeof(value));
+    };
+    appendWord(0x46546c67); // "glTF"
+    appendWord(2);
+    appendWord(12 + 8 + chunk.size() + 8 + bin.size());
+    appendWord(chunk.size());
+    appendWord(0x4e4f534a); // "JSON"
+    text += chunk;
+    appendWord(bin.size());
+    appendWord(0x004e4942); // "BIN"
+    text += bin;
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    return fclose(file) == 0 && written;
+}
+
+// Loads the demo's shaders and texture and an OBJ mesh from their source
+// files, the way the demo starts up, then deletes them again.
+void loadSourceAssets(const char *meshPath) {
+    Shader shader("../src/shaders/vertexShader.glsl",
+                  "../src/shaders/fragmentShader.glsl");
+    Texture texture("../src/resources/texture.png", GL_TEXTURE_2D, GL_TEXTURE1,
+                    GL_RGBA, GL_UNSIGNED_BYTE);
+    Mesh mesh;
+    ObjLoader::Load(meshPath, mesh);
+    VertexArrayObject vao;
+    vao.Bind();
+    VertexBufferObject vbo(mesh.vertices.data(),
+                           mesh.vertices.size() * sizeof(float));
+    ElementBufferObject ebo(mesh.indices.data(),
+                            mesh.indices.size() * sizeof(unsigned int));
+    linkMeshAttribs(vao, vbo);
+    vao.Unbind();
+    glFinish();
+
+    vao.Delete();
+    vbo.Delete();
+    ebo.Delete();
+    texture.Delete();
+    shader.Delete();
+}
+
+// Loads the same assets from a pack baked by bakeStartupPack.
+void loadPackedAssets(const char *packPath) {
+    AssetPack pack(packPath);
+    Shader shader = pack.LoadShader("vertexShader.glsl", "fragmentShader.glsl");
+    Texture texture = pack.LoadTexture("texture.png", GL_TEXTURE1);
+    BakedMesh mesh = pack.LoadMesh("mesh");
+    glFinish();
+
+    mesh.Delete();
+    texture.Delete();
+    shader.Delete();
+}
+
+// Bakes the demo's shaders and texture and an OBJ mesh into a pack, and
+// returns its size, or 0 on failure.
+size_t bakeStartupPack(const char *packPath, const char *meshPath) {
+    AssetPackWriter writer;
+    bool added =
+        writer.AddShaderFile("vertexShader.glsl",
+                             "../src/shaders/vertexShader.glsl") &&
+        writer.AddShaderFile("fragmentShader.glsl",
+                             "../src/shaders/fragmentShader.glsl") &&
+        writer.AddTextureFile("texture.png", "../src/resources/texture.png") &&
+        writer.AddMeshFile("mesh", meshPath);
+    return added && writer.Write(packPath) ? writer.Size() : 0;
+}
+
+// Compiles the demo's shader and decodes and uploads its texture every
+// frame, then throws them away.
+class AssetsScene : public BenchScene {
+  public:
+    void Prepare(Bench &, Frame &) override {
+        TRACE_SCOPE("reload assets");
+        Shader reloadedShader("../src/shaders/vertexShader.glsl",
+                              "../src/shaders/fragmentShader.glsl");
+        Texture reloadedTexture("../src/resources/texture.png", GL_TEXTURE_2D,
+                                GL_TEXTURE1, GL_RGBA, GL_UNSIGNED_BYTE);
+        reloadedTexture.Delete();
+        reloadedShader.Delete();
+        glActiveTexture(GL_TEXTURE0);
+    }
+};
+
+// Draws a loaded mesh instead of the quad. The file is loaded twice, on one
+// thread and on the job system; the generated grid is still in the page
+// cache, so this measures parsing.
+class ObjScene : public BenchScene {
+  public:
+    ObjScene(int gridSize, const char *modelPath)
+        : gridSize(gridSize), modelPath(modelPath) {}
+
+    bool Setup(Bench &bench) override {
+        TRACE_SCOPE("load mesh");
+        const char *path = modelPath;
+        if (path == NULL) {
+            path = "bench_grid.obj";
+            if (!writeGridObj(path, gridSize)) {
+                LOG_ERROR("Failed to write %s", path);
+                return false;
+            }
+        }
+
+        bool loaded = false;
+        loadSerialTime =
+            timeMilliseconds([&]() { loaded = ObjLoader::Load(path, mesh); });
+        loadParallelTime = timeMilliseconds([&]() {
+            loaded = loaded && ObjLoader::Load(path, mesh, &bench.jobs);
+        });
+        if (!loaded) {
+            LOG_ERROR("Failed to load %s", path);
+            return false;
+        }
+        meshFileBytes = fileBytes(path);
+
+        vao.reset(new VertexArrayObject());
+        vao->Bind();
+        vbo.reset(new VertexBufferObject(
+            mesh.vertices.data(), mesh.vertices.size() * sizeof(float)));
+        ebo.reset(new ElementBufferObject(
+            mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int)));
+        linkMeshAttribs(*vao, *vbo);
+        vao->Unbind();
+        bench.drawVAO = vao.get();
+        bench.drawIndexCount = (GLsizei)mesh.indices.size();
+        return true;
+    }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        double megabytes = meshFileBytes / 1.0e6;
+        counters.Number("mesh_file_megabytes", megabytes);
+        counters.Number("mesh_vertices", mesh.VertexCount());
+        counters.Number("mesh_triangles", mesh.TriangleCount());
+        counters.Number("mesh_load_serial_ms", loadSerialTime);
+        counters.Number("mesh_load_parallel_ms", loadParallelTime);
+        counters.Number("mesh_load_megabytes_per_second",
+                        megabytes / (loadParallelTime / 1000.0));
+    }
+
+    void Delete() override {
+        if (vao) {
+            vao->Delete();
+            vbo->Delete();
+            ebo->Delete();
+        }
+    }
+
+  private:
+    int gridSize;
+    const char *modelPath;
+    Mesh mesh;
+    double loadSerialTime = 0.0, loadParallelTime = 0.0;
+    long long meshFileBytes = 0;
+    unique_ptr<VertexArrayObject> vao;
+    unique_ptr<VertexBufferObject> vbo;
+    unique_ptr<ElementBufferObject> ebo;
+};
+
+// Draws a loaded glTF model instead of the quad. Its geometry is uploaded
+// straight from the mapped file while the embedded images decode on a
+// background thread.
+class GlbScene : public BenchScene {
+  public:
+    GlbScene(int gridSize, const char *modelPath)
+        : gridSize(gridSize), modelPath(modelPath) {}
+
+    bool Setup(Bench &bench) override {
+        TRACE_SCOPE("load model");
+        const char *path = modelPath;
+        if (path == NULL) {
+            path = "bench_grid.glb";
+            if (!writeGridGlb(path, gridSize,
+                              "../src/resources/texture.png")) {
+                LOG_ERROR("Failed to write %s", path);
+                return false;
+            }
+        }
+
+        Clock::time_point start = Clock::now();
+        model.reset(new GlbModel(path, textureDecoder));
+        loadTime = millisecondsSince(start);
+        textureDecoder.Finish();
+        texturesReadyTime = millisecondsSince(start);
+        peakRss = peakRssMegabytes();
+        if (!model->IsLoaded()) {
+            LOG_ERROR("Failed to load %s", path);
+            return false;
+        }
+        glbFileBytes = fileBytes(path);
+        bench.drawIndexCount = (GLsizei)(model->TriangleCount() * 3);
+        return true;
+    }
+
+    void DrawQuad(Bench &, int) override { model->Draw(); }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        counters.Number("glb_file_megabytes", glbFileBytes / 1.0e6);
+        counters.Number("glb_primitives", model->PrimitiveCount());
+        counters.Number("glb_triangles", model->TriangleCount());
+        counters.Number("glb_load_ms", loadTime);
+        counters.Number("glb_textures_ready_ms", texturesReadyTime);
+        counters.Number("glb_direct_upload_megabytes",
+                        model->DirectUploadBytes() / 1.0e6);
+        counters.Number("glb_converted_upload_megabytes",
+                        model->ConvertedUploadBytes() / 1.0e6);
+        counters.Number("glb_peak_rss_megabytes", peakRss);
+    }
+
+    void Delete() override {
+        if (model) {
+            model->Delete();
+        }
+        textureDecoder.Delete();
+    }
+
+  private:
+    int gridSize;
+    const char *modelPath;
+    TextureDecoder textureDecoder;
+    unique_ptr<GlbModel> model;
+    double loadTime = 0.0, texturesReadyTime = 0.0;
+    double peakRss = 0.0;
+    long long glbFileBytes = 0;
+};
+
+// Bakes the demo's assets and a grid mesh into a pack once, untimed, then
+// loads them from the source files and from the pack every frame,
+// alternating which goes first so neither always runs after the other has
+// warmed the caches.
+class StartupScene : public BenchScene {
+  public:
+    explicit StartupScene(int gridSize) : gridSize(gridSize) {}
+
+    bool Setup(Bench &) override {
+        TRACE_SCOPE("bake assets");
+        if (!writeGridObj(MESH_PATH, gridSize)) {
+            LOG_ERROR("Failed to write %s", MESH_PATH);
+            return false;
+        }
+        packBytes = bakeStartupPack(PACK_PATH, MESH_PATH);
+        if (packBytes == 0) {
+            LOG_ERROR("Failed to bake %s", PACK_PATH);
+            return false;
+        }
+        for (const char *path :
+             {"../src/shaders/vertexShader.glsl",
+              "../src/shaders/fragmentShader.glsl",
+              "../src/resources/texture.png", MESH_PATH}) {
+            sourceBytes += fileBytes(path);
+        }
+        return true;
+    }
+
+    void Prepare(Bench &, Frame &frame) override {
+        TRACE_SCOPE("startup loads");
+        for (int pass = 0; pass < 2; pass++) {
+            bool fromPack = (pass == 0) == (frame.index % 2 == 0);
+            double time = timeMilliseconds([&]() {
+                if (fromPack) {
+                    loadPackedAssets(PACK_PATH);
+                } else {
+                    loadSourceAssets(MESH_PATH);
+                }
+            });
+            if (frame.measured) {
+                (fromPack ? packTimes : sourceTimes).push_back(time);
+            }
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("startup_source", sourceTimes);
+        timings.Samples("startup_pack", packTimes);
+    }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        counters.Number("startup_source_megabytes", sourceBytes / 1.0e6);
+        counters.Number("startup_pack_megabytes", packBytes / 1.0e6);
+        counters.Number("startup_speedup_p50",
+                        summarise(sourceTimes).p50 / summarise(packTimes).p50);
+    }
+
+  private:
+    static constexpr const char *MESH_PATH = "bench_startup.obj";
+    static constexpr const char *PACK_PATH = "bench_assets.pack";
+
+    int gridSize;
+    size_t packBytes = 0;
+    long long sourceBytes = 0;
+    vector<double> sourceTimes, packTimes;
+};
+
+} // namespace
+
+BenchScene *CreateAssetsScene(const Options &) { return new AssetsScene(); }
+
+BenchScene *CreateObjScene(const Options &options) {
+    return new ObjScene(objectsOr(options, OBJ_GRID_SIZE), options.modelPath);
+}
+
+BenchScene *CreateGlbScene(const Options &options) {
+    return new GlbScene(objectsOr(options, GLB_GRID_SIZE), options.modelPath);
+}
+
+BenchScene *CreateStartupScene(const Options &options) {
+    return new StartupScene(objectsOr(options, STARTUP_GRID_SIZE));
+}
@@ -0,0 +1,115 @@
+#include "Bench.h"
+#include "../classes/Mesh.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/resource.h>
+
+using namespace std;
+
+double millisecondsSince(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+Stats summarise(vector<double> samples) {
+    Stats stats = {0, 0, 0, 0, 0, 0};
+    if (samples.empty()) {
+        return stats;
+    }
+
+    sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+
+    // Nearest-rank percentiles.
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)(p / 100.0 * samples.size() + 0.5);
+        return samples[min(max(rank, (size_t)1), samples.size()) - 1];
+    };
+
+    stats.mean = sum / samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.p50 = percentile(50);
+    stats.p95 = percentile(95);
+    stats.p99 = percentile(99);
+    return stats;
+}
+
+JsonObject::JsonObject(ostream &out) : out(out) {}
+
+ostream &JsonObject::Member(const char *name) {
+    out << separator << "    \"" << name << "\": ";
+    separator = ",\n";
+    return out;
+}
+
+void JsonObject::Samples(const char *name, const vector<double> &samples) {
+    Stats stats = summarise(samples);
+    Member(name) << "{\"mean\": " << stats.mean << ", \"min\": " << stats.min
+                 << ", \"max\": " << stats.max << ", \"p50\": " << stats.p50
+                 << ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99
+                 << "}";
+}
+
+void JsonObject::String(const char *name, const char *value) {
+    Member(name) << "\"" << value << "\"";
+}
+
+void JsonObject::Bool(const char *name, bool value) {
+    Member(name) << (value ? "true" : "false");
+}
+
+float randomBetween(float low, float high) {
+    return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+mat4 cameraMatrix(float yaw) {
+    float aspect = (float)FRAMEBUFFER_WIDTH / FRAMEBUFFER_HEIGHT;
+    mat4 projection = mat4::Perspective(1.0472f, aspect, 0.1f, 1000.0f);
+    return projection *
+           mat4::Rotation(quat::AxisAngle(vec3(0.0f, 1.0f, 0.0f), -yaw));
+}
+
+void linkMeshAttribs(VertexArrayObject &vao, VertexBufferObject &vbo) {
+    GLsizei stride = Mesh::VERTEX_FLOATS * sizeof(float);
+    vao.LinkAttrib(vbo, 0, 3, GL_FLOAT, stride, (void *)0);
+    vao.LinkAttrib(vbo, 1, 3, GL_FLOAT, stride, (void *)(3 * sizeof(float)));
+    vao.LinkAttrib(vbo, 2, 2, GL_FLOAT, stride, (void *)(6 * sizeof(float)));
+}
+
+long long fileBytes(const char *path) {
+    ifstream file(path, ios::binary | ios::ate);
+    return (long long)file.tellg();
+}
+
+double peakRssMegabytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    // Linux reports kilobytes.
+    return usage.ru_maxrss / 1024.0;
+}
+
+void PerViewBlock::Init(const Shader &shader) {
+    layout = shader.getUniformBlockLayout("PerView");
+    data.assign(layout.size, 0);
+}
+
+void PerViewBlock::Push(UniformRing &ring, const mat4 &viewProjection) {
+    memcpy(data.data() + layout.members["viewProj"].offset, viewProjection.m,
+           min(sizeof(viewProjection.m), data.size()));
+    offset = ring.Push(data.data(), data.size());
+}
+
+void PerViewBlock::Bind(UniformRing &ring) const {
+    ring.BindRange(PER_VIEW_BINDING, offset, data.size());
+}
+
+void BenchScene::DrawQuad(Bench &bench, int) {
+    glDrawElements(GL_TRIANGLES, bench.drawIndexCount, GL_UNSIGNED_INT, 0);
+}
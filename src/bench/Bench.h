@@ -0,0 +1,246 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "../classes/FrameBufferObject.h"
+#include "../classes/JobSystem.h"
+#include "../classes/Shader.h"
+#include "../classes/Texture.h"
+#include "../classes/UniformRing.h"
+#include "../classes/VectorMath.h"
+#include "../classes/VertexArrayObject.h"
+#include "../classes/VertexBufferObject.h"
+#include "../glad/glad.h"
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Shared parts of the frame benchmark: the options, the state the harness
+// in bench.cpp shares with the scene it runs, the scene interface and the
+// timing and report helpers. Each scene lives in src/bench, grouped by
+// topic, behind a Create...Scene function.
+
+const int FRAMEBUFFER_WIDTH = 800;
+const int FRAMEBUFFER_HEIGHT = 600;
+
+// Uniform block bindings of the per-draw and per-view constants.
+const unsigned int PER_DRAW_BINDING = 0;
+const unsigned int PER_VIEW_BINDING = 1;
+
+struct Options {
+    std::string scene = "quad";
+    int frames = 300;
+    int warmup = 30;
+    const char *outputPath = NULL;
+    bool glDebug = false;
+    // Count GL calls through the recording dispatch.
+    bool countCalls = false;
+    // Run against the mock dispatch instead of a GL context.
+    bool mock = false;
+    // Overrides the scene's object count when positive.
+    int objects = 0;
+    // Model file loaded by the obj or glb scene instead of the generated
+    // grid.
+    const char *modelPath = NULL;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point start);
+
+// Runs work and returns how long it took, in milliseconds.
+template <typename Work> double timeMilliseconds(Work &&work) {
+    Clock::time_point start = Clock::now();
+    work();
+    return millisecondsSince(start);
+}
+
+// Summary statistics of one series of per-frame samples.
+struct Stats {
+    double mean, min, max, p50, p95, p99;
+};
+
+Stats summarise(std::vector<double> samples);
+
+// Writes the members of one object of the JSON report, one per line, with
+// the commas between them. The caller writes the braces.
+class JsonObject {
+  public:
+    explicit JsonObject(std::ostream &out);
+
+    // Starts a member and returns the stream to write its value to.
+    std::ostream &Member(const char *name);
+
+    // The summary statistics of per-frame samples.
+    void Samples(const char *name, const std::vector<double> &samples);
+
+    template <typename T> void Number(const char *name, T value) {
+        Member(name) << value;
+    }
+
+    void String(const char *name, const char *value);
+    void Bool(const char *name, bool value);
+
+  private:
+    std::ostream &out;
+    const char *separator = "\n";
+};
+
+// Pseudo-random number in [low, high]. Scenes call srand(1) first so their
+// content is the same every run.
+float randomBetween(float low, float high);
+
+// Column-major view-projection matrix of a camera at the origin turned yaw
+// radians around the Y axis.
+mat4 cameraMatrix(float yaw);
+
+// Links the position, colour and texture coordinate attributes of
+// interleaved Mesh vertices.
+void linkMeshAttribs(VertexArrayObject &vao, VertexBufferObject &vbo);
+
+// Size of a file in bytes, or -1 if it cannot be opened.
+long long fileBytes(const char *path);
+
+// Peak resident set size of the process so far, in megabytes.
+double peakRssMegabytes();
+
+// The PerView block (the view-projection matrix) of a scene's shaders,
+// pushed into the uniform ring once a frame.
+struct PerViewBlock {
+    UniformBlockLayout layout;
+    std::vector<unsigned char> data;
+    GLintptr offset = 0;
+
+    // Reads the block's layout from shader.
+    void Init(const Shader &shader);
+
+    // Pushes this frame's matrix.
+    void Push(UniformRing &ring, const mat4 &viewProjection);
+
+    // Binds the pushed block to PER_VIEW_BINDING.
+    void Bind(UniformRing &ring) const;
+};
+
+// The state the harness shares with the scene it runs.
+struct Bench {
+    const Options &options;
+    JobSystem &jobs;
+    FrameBufferObject &offscreen;
+    // The demo's shader, texture and quad.
+    Shader &shader;
+    Texture &face;
+    VertexArrayObject &quadVAO;
+    UniformRing &uniformRing;
+    // What DrawQuad draws; a scene may swap in its own mesh in Setup.
+    VertexArrayObject *drawVAO;
+    GLsizei drawIndexCount;
+    // Draw calls and triangles of the measured frames. The harness counts
+    // the quads; scenes add their own draws.
+    long long drawCalls;
+    long long triangles;
+};
+
+// The frame being rendered.
+struct Frame {
+    int index;
+    // Past the warm-up, so its samples count.
+    bool measured;
+    // Quads to draw, drawsPerFrame unless the scene culls or streams them.
+    int draws;
+    // Time GLHandlePool::EndFrame took, set before the scene's EndFrame.
+    double poolEndFrameTime;
+};
+
+// A scripted benchmark scene. Every frame the harness clears the offscreen
+// framebuffer and draws the demo quad Frame::draws times, each with its
+// own scale in the PerDraw block; a scene adds its work through the hooks
+// below, which run in the order they are declared, and reports it in the
+// JSON.
+class BenchScene {
+  public:
+    // Constructor for a scene that draws the quad drawsPerFrame times a
+    // frame, shrinking each a little more when there are several.
+    explicit BenchScene(int drawsPerFrame = 1)
+        : drawsPerFrame(drawsPerFrame) {}
+
+    virtual ~BenchScene() = default;
+
+    BenchScene(const BenchScene &) = delete;
+    BenchScene &operator=(const BenchScene &) = delete;
+
+    const int drawsPerFrame;
+
+    // Most quads a frame draws, to size the uniform ring.
+    virtual int MaxDraws() const { return drawsPerFrame; }
+
+    // Builds the scene once, untimed. Returns false, having logged why, if
+    // it cannot run.
+    virtual bool Setup(Bench &) { return true; }
+
+    // Runs before each frame starts, outside the CPU frame time.
+    virtual void WaitForFrame() {}
+
+    // CPU work of the frame, before the GL submit.
+    virtual void Update(Bench &, Frame &) {}
+
+    // Work after the clear, inside the GL submit.
+    virtual void Prepare(Bench &, Frame &) {}
+
+    // Pushes the scene's own constants after the quads' PerDraw blocks.
+    virtual void PushConstants(Bench &, const Frame &) {}
+
+    // Draws quad number draw, with its PerDraw block bound.
+    virtual void DrawQuad(Bench &bench, int draw);
+
+    // Draws the scene's own geometry after the quads.
+    virtual void Draw(Bench &, const Frame &) {}
+
+    // Runs after GLHandlePool::EndFrame.
+    virtual void EndFrame(Bench &, const Frame &) {}
+
+    // Ends the frame. There is no swap in headless mode, so this flushes to
+    // keep the GPU up with the CPU.
+    virtual void Present() { glFlush(); }
+
+    // Runs once after the last frame.
+    virtual void Finish(Bench &) {}
+
+    // Adds the scene's timings and counters to the report.
+    virtual void WriteTimings(Bench &, JsonObject &) {}
+    virtual void WriteCounters(Bench &, JsonObject &) {}
+
+    // Deletes the scene's GL objects while the context is current.
+    virtual void Delete() {}
+};
+
+// The scenes, each with the object count from --objects where it takes
+// one. CullingScenes.cpp:
+BenchScene *CreateCullScene(const Options &options);
+BenchScene *CreateBvhScene(const Options &options);
+BenchScene *CreateOcclusionScene(const Options &options);
+// AssetScenes.cpp:
+BenchScene *CreateAssetsScene(const Options &options);
+BenchScene *CreateObjScene(const Options &options);
+BenchScene *CreateGlbScene(const Options &options);
+BenchScene *CreateStartupScene(const Options &options);
+// StreamingScenes.cpp:
+BenchScene *CreateStreamingScene(const Options &options);
+BenchScene *CreateVirtualScene(const Options &options);
+// MathScenes.cpp:
+BenchScene *CreateTransformsScene(const Options &options);
+BenchScene *CreateMathScene(const Options &options);
+// MemoryScenes.cpp:
+BenchScene *CreateHandlesScene(const Options &options);
+BenchScene *CreateUnloadScene(const Options &options);
+BenchScene *CreateArenaScene(const Options &options);
+// TimingScenes.cpp:
+BenchScene *CreatePacedScene(const Options &options);
+BenchScene *CreateSimScene(const Options &options);
+
+// The --objects count if given, otherwise the scene's default.
+inline int objectsOr(const Options &options, int defaultObjects) {
+    return options.objects > 0 ? options.objects : defaultObjects;
+}
+
+#endif
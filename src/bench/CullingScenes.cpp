@@ -0,0 +1,325 @@
+#include "../classes/Bvh.h"
+#include "../classes/FrustumCuller.h"
+#include "../classes/OcclusionCuller.h"
+#include "../classes/Trace.h"
+#include "Bench.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+namespace {
+
+// Boxes culled by the cull scene, and put in the BVH by the bvh scene.
+const int CULL_OBJECTS = 1000000;
+const int BVH_OBJECTS = 1000000;
+
+// Rays cast through the BVH each frame.
+const int BVH_RAYS_PER_FRAME = 4096;
+
+// Every this many BVH objects moves each frame.
+const int BVH_MOVING_STRIDE = 16;
+
+// Objects behind the occlusion scene's walls, and the resolution of the
+// software depth buffer they are tested against.
+const int OCCLUSION_OBJECTS = 4096;
+const int OCCLUSION_WIDTH = 256;
+const int OCCLUSION_HEIGHT = 128;
+
+// A random box in a 1000 unit cube around the camera.
+void randomBox(float min[3], float max[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        min[axis] = randomBetween(-500.0f, 500.0f);
+        max[axis] = min[axis] + randomBetween(0.5f, 4.0f);
+    }
+}
+
+// Appends a box as 8 vertices and 12 triangles.
+void appendBox(const float min[3], const float max[3],
+               vector<float> &positions, vector<unsigned int> &indices) {
+    unsigned int first = (unsigned int)positions.size() / 3;
+    for (int corner = 0; corner < 8; corner++) {
+        positions.push_back(corner & 1 ? max[0] : min[0]);
+        positions.push_back(corner & 2 ? max[1] : min[1]);
+        positions.push_back(corner & 4 ? max[2] : min[2]);
+    }
+
+    // Two triangles per face, as corner bit patterns.
+    const unsigned int faces[] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+                                  0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+                                  0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+    for (unsigned int corner : faces) {
+        indices.push_back(first + corner);
+    }
+}
+
+// Frustum culls random boxes against a rotating camera every frame, on one
+// thread and then on the job system.
+class CullScene : public BenchScene {
+  public:
+    explicit CullScene(int objects) : objects(objects) {}
+
+    bool Setup(Bench &) override {
+        srand(1);
+        for (int i = 0; i < objects; i++) {
+            float min[3], max[3];
+            randomBox(min, max);
+            culler.Add(min, max);
+        }
+        return true;
+    }
+
+    void Update(Bench &bench, Frame &frame) override {
+        TRACE_SCOPE("cull");
+        Frustum frustum =
+            Frustum::FromMatrix(cameraMatrix(frame.index * 0.01f));
+        double serialTime =
+            timeMilliseconds([&]() { culler.Cull(frustum, visible); });
+        double parallelTime = timeMilliseconds(
+            [&]() { culler.Cull(frustum, visible, &bench.jobs); });
+        if (frame.measured) {
+            serialTimes.push_back(serialTime);
+            parallelTimes.push_back(parallelTime);
+            visibleTotal += visible.size();
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("cull_serial", serialTimes);
+        timings.Samples("cull_parallel", parallelTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("cull_objects", objects);
+        counters.Number("cull_visible_per_frame",
+                        (double)visibleTotal / bench.options.frames);
+        counters.String("cull_kernel", FrustumCuller::KernelName());
+        counters.Number("cull_threads", bench.jobs.ThreadCount());
+    }
+
+  private:
+    int objects;
+    FrustumCuller culler;
+    vector<unsigned int> visible;
+    long long visibleTotal = 0;
+    vector<double> serialTimes, parallelTimes;
+};
+
+// Builds a BVH of random boxes on the job system, then every frame moves
+// some of them, refits it and runs a frustum query and a batch of rays.
+class BvhScene : public BenchScene {
+  public:
+    explicit BvhScene(int objects) : objects(objects) {}
+
+    bool Setup(Bench &bench) override {
+        srand(1);
+        for (int i = 0; i < objects; i++) {
+            float min[3], max[3];
+            randomBox(min, max);
+            bvh.Add(min, max);
+            boxes.insert(boxes.end(), min, min + 3);
+            boxes.insert(boxes.end(), max, max + 3);
+        }
+        TRACE_SCOPE("bvh build");
+        buildTime = timeMilliseconds([&]() { bvh.Build(&bench.jobs); });
+        return true;
+    }
+
+    void Update(Bench &, Frame &frame) override {
+        TRACE_SCOPE("bvh queries");
+        // Every BVH_MOVING_STRIDE-th box bobs up and down.
+        float offset = sinf(frame.index * 0.1f);
+        for (int i = 0; i < objects; i += BVH_MOVING_STRIDE) {
+            float min[3], max[3];
+            for (int axis = 0; axis < 3; axis++) {
+                min[axis] = boxes[i * 6 + axis];
+                max[axis] = boxes[i * 6 + 3 + axis];
+            }
+            min[1] += offset;
+            max[1] += offset;
+            bvh.Set(i, min, max);
+        }
+
+        double refitTime = timeMilliseconds([&]() { bvh.Refit(); });
+
+        Frustum frustum =
+            Frustum::FromMatrix(cameraMatrix(frame.index * 0.01f));
+        double frustumTime = timeMilliseconds([&]() {
+            visible.clear();
+            bvh.Query(frustum, visible);
+        });
+
+        // Rays from the origin, spread evenly over the sphere.
+        int hits = 0;
+        double rayTime = timeMilliseconds([&]() {
+            const float origin[3] = {0.0f, 0.0f, 0.0f};
+            for (int ray = 0; ray < BVH_RAYS_PER_FRAME; ray++) {
+                float z = 1.0f - 2.0f * (ray + 0.5f) / BVH_RAYS_PER_FRAME;
+                float r = sqrtf(1.0f - z * z);
+                // Golden angle.
+                float angle = ray * 2.3999632f + frame.index;
+                float direction[3] = {r * cosf(angle), r * sinf(angle), z};
+                unsigned int hitIndex;
+                float hitDistance;
+                hits += bvh.Raycast(origin, direction, 1000.0f, hitIndex,
+                                    hitDistance);
+            }
+        });
+
+        if (frame.measured) {
+            refitTimes.push_back(refitTime);
+            frustumTimes.push_back(frustumTime);
+            rayTimes.push_back(rayTime);
+            visibleTotal += visible.size();
+            rayHits += hits;
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("bvh_refit", refitTimes);
+        timings.Samples("bvh_frustum_query", frustumTimes);
+        timings.Samples("bvh_raycasts", rayTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        int frames = bench.options.frames;
+        double rayTime = 0.0;
+        for (double time : rayTimes) {
+            rayTime += time;
+        }
+        counters.Number("bvh_objects", objects);
+        counters.Number("bvh_build_ms", buildTime);
+        counters.Number("bvh_build_threads", bench.jobs.ThreadCount());
+        counters.Number("bvh_nodes", bvh.NodeCount());
+        counters.Number("bvh_bytes_per_node", sizeof(BvhNode));
+        counters.Number("bvh_memory_bytes", bvh.MemoryUsage());
+        counters.Number("bvh_visible_per_frame",
+                        (double)visibleTotal / frames);
+        counters.Number("bvh_ray_hit_rate",
+                        (double)rayHits / (frames * BVH_RAYS_PER_FRAME));
+        counters.Number("bvh_rays_per_second",
+                        frames * BVH_RAYS_PER_FRAME / (rayTime / 1000.0));
+    }
+
+  private:
+    int objects;
+    Bvh bvh;
+    // Where each box started, as min and max corners.
+    vector<float> boxes;
+    double buildTime = 0.0;
+    vector<unsigned int> visible;
+    long long visibleTotal = 0, rayHits = 0;
+    vector<double> refitTimes, frustumTimes, rayTimes;
+};
+
+// A ring of walls around the camera with gaps between them, and one small
+// box per quad scattered around and mostly behind the walls. Only the quads
+// whose box passes the frustum test and the software Hi-Z occlusion test
+// are drawn.
+class OcclusionScene : public BenchScene {
+  public:
+    OcclusionScene()
+        : BenchScene(OCCLUSION_OBJECTS),
+          culler(OCCLUSION_WIDTH, OCCLUSION_HEIGHT) {}
+
+    bool Setup(Bench &) override {
+        srand(1);
+        const int WALLS = 12;
+        for (int wall = 0; wall < WALLS; wall++) {
+            float angle = wall * 6.2831853f / WALLS;
+            float x = 20.0f * cosf(angle), z = 20.0f * sinf(angle);
+            float min[3] = {x - 4.0f, -4.0f, z - 4.0f};
+            float max[3] = {x + 4.0f, 4.0f, z + 4.0f};
+            appendBox(min, max, occluderPositions, occluderIndices);
+        }
+        for (int i = 0; i < drawsPerFrame; i++) {
+            float angle = randomBetween(0.0f, 6.2831853f);
+            float distance = randomBetween(25.0f, 100.0f);
+            float x = distance * cosf(angle), z = distance * sinf(angle);
+            float y = randomBetween(-3.0f, 3.0f);
+            float box[6] = {x - 0.5f, y - 0.5f, z - 0.5f,
+                            x + 0.5f, y + 0.5f, z + 0.5f};
+            occludeeBoxes.insert(occludeeBoxes.end(), box, box + 6);
+        }
+        return true;
+    }
+
+    void Update(Bench &bench, Frame &frame) override {
+        TRACE_SCOPE("occlusion cull");
+        mat4 viewProjection = cameraMatrix(frame.index * 0.01f);
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+        double rasterTime = timeMilliseconds([&]() {
+            culler.BeginFrame(viewProjection.m);
+            culler.AddOccluder(occluderPositions.data(),
+                               occluderPositions.size() / 3,
+                               occluderIndices.data(),
+                               occluderIndices.size());
+            culler.Rasterize(&bench.jobs);
+        });
+
+        int inFrustum = 0;
+        frame.draws = 0;
+        double testTime = timeMilliseconds([&]() {
+            for (int i = 0; i < drawsPerFrame; i++) {
+                const float *min = &occludeeBoxes[i * 6];
+                const float *max = min + 3;
+                bool outside = false;
+                for (const float *plane : frustum.planes) {
+                    float x = plane[0] > 0.0f ? max[0] : min[0];
+                    float y = plane[1] > 0.0f ? max[1] : min[1];
+                    float z = plane[2] > 0.0f ? max[2] : min[2];
+                    outside |= plane[0] * x + plane[1] * y + plane[2] * z +
+                                   plane[3] <
+                               0.0f;
+                }
+                if (outside) {
+                    continue;
+                }
+                inFrustum++;
+                frame.draws += culler.IsVisible(min, max);
+            }
+        });
+
+        if (frame.measured) {
+            rasterTimes.push_back(rasterTime);
+            testTimes.push_back(testTime);
+            inFrustumTotal += inFrustum;
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("occlusion_rasterize", rasterTimes);
+        timings.Samples("occlusion_test", testTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("occlusion_objects", drawsPerFrame);
+        counters.Number("occlusion_in_frustum_per_frame",
+                        (double)inFrustumTotal / bench.options.frames);
+        counters.Number("occluder_triangles", culler.TriangleCount());
+    }
+
+  private:
+    OcclusionCuller culler;
+    vector<float> occluderPositions;
+    vector<unsigned int> occluderIndices;
+    // Each quad's box, as min and max corners.
+    vector<float> occludeeBoxes;
+    long long inFrustumTotal = 0;
+    vector<double> rasterTimes, testTimes;
+};
+
+} // namespace
+
+BenchScene *CreateCullScene(const Options &options) {
+    return new CullScene(objectsOr(options, CULL_OBJECTS));
+}
+
+BenchScene *CreateBvhScene(const Options &options) {
+    return new BvhScene(objectsOr(options, BVH_OBJECTS));
+}
+
+BenchScene *CreateOcclusionScene(const Options &) {
+    return new OcclusionScene();
+}
@@ -0,0 +1,298 @@
+#include "../classes/InstanceBuffer.h"
+#include "../classes/Trace.h"
+#include "../classes/TransformSystem.h"
+#include "Bench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Root transforms of the transforms scene, 111100 transforms in all.
+const int TRANSFORM_ROOTS = 100;
+
+// Children of each transform above the leaves in the transforms scene.
+const int TRANSFORM_CHILDREN = 10;
+const int TRANSFORM_DEPTH = 4;
+
+// Every this many root transforms spins each frame, taking its subtree
+// with it; the rest stay put.
+const int TRANSFORM_MOVING_STRIDE = 8;
+
+// Points the math scene transforms each frame.
+const int MATH_POINTS = 1000000;
+
+// The math scene multiplies, inverts and slerps one matrix or quaternion
+// per this many points.
+const int MATH_POINTS_PER_MATRIX = 16;
+
+// Rows of root transforms in front of the camera, each with a few levels of
+// smaller children around it, updated on the job system and drawn as
+// textured quads in one instanced draw.
+class TransformsScene : public BenchScene {
+  public:
+    explicit TransformsScene(int roots) : BenchScene(0), roots(roots) {}
+
+    bool Setup(Bench &) override {
+        for (int root = 0; root < roots; root++) {
+            unsigned int handle = transforms.Create();
+            transforms.SetPosition(handle, (root % 10 - 4.5f) * 6.0f,
+                                   (root / 10 % 10 - 4.5f) * 6.0f, -80.0f);
+            rootHandles.push_back(handle);
+
+            vector<unsigned int> parents(1, handle);
+            for (int depth = 1; depth < TRANSFORM_DEPTH; depth++) {
+                vector<unsigned int> children;
+                for (unsigned int parent : parents) {
+                    for (int child = 0; child < TRANSFORM_CHILDREN; child++) {
+                        unsigned int childHandle = transforms.Create(parent);
+                        float angle = child * 6.2831853f / TRANSFORM_CHILDREN;
+                        transforms.SetPosition(childHandle, 2.0f * cosf(angle),
+                                               2.0f * sinf(angle), 0.0f);
+                        transforms.SetScale(childHandle, 0.35f, 0.35f, 0.35f);
+                        children.push_back(childHandle);
+                    }
+                }
+                parents.swap(children);
+            }
+        }
+
+        shader.reset(new Shader("../src/shaders/instancedVertexShader.glsl",
+                                "../src/shaders/fragmentShader.glsl"));
+        shader->bindUniformBlock("PerView", PER_VIEW_BINDING);
+        perView.Init(*shader);
+        instanceBuffer.reset(new InstanceBuffer(transforms.Count()));
+        return true;
+    }
+
+    void Update(Bench &bench, Frame &frame) override {
+        TRACE_SCOPE("update transforms");
+        float angle = frame.index * 0.05f;
+        for (size_t root = frame.index % TRANSFORM_MOVING_STRIDE;
+             root < rootHandles.size(); root += TRANSFORM_MOVING_STRIDE) {
+            transforms.SetRotation(rootHandles[root], 0.0f, 0.0f,
+                                   sinf(angle * 0.5f), cosf(angle * 0.5f));
+        }
+        updateTime =
+            timeMilliseconds([&]() { transforms.Update(&bench.jobs); });
+    }
+
+    void PushConstants(Bench &bench, const Frame &) override {
+        perView.Push(bench.uniformRing, cameraMatrix(0.0f));
+    }
+
+    void Draw(Bench &bench, const Frame &frame) override {
+        TRACE_SCOPE("draw instances");
+        double uploadTime = timeMilliseconds([&]() {
+            float *matrices = instanceBuffer->BeginFrame();
+            transforms.CopyWorldMatrices((TransformSystem::Matrix *)matrices,
+                                         &bench.jobs);
+            instanceBuffer->Unmap(transforms.Count());
+        });
+
+        shader->Activate();
+        perView.Bind(bench.uniformRing);
+        instanceBuffer->LinkAttrib(bench.quadVAO, 3);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0,
+                                transforms.Count());
+        instanceBuffer->EndFrame();
+
+        if (frame.measured) {
+            updateTimes.push_back(updateTime);
+            uploadTimes.push_back(uploadTime);
+            updatedTotal += transforms.LastUpdateCount();
+            bench.drawCalls++;
+            bench.triangles += 2 * (long long)transforms.Count();
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("transform_update", updateTimes);
+        timings.Samples("instance_upload", uploadTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("transforms", transforms.Count());
+        counters.Number("transforms_updated_per_frame",
+                        (double)updatedTotal / bench.options.frames);
+        counters.Number("instances_per_frame", transforms.Count());
+    }
+
+    void Delete() override {
+        if (instanceBuffer) {
+            instanceBuffer->Delete();
+            shader->Delete();
+        }
+    }
+
+  private:
+    int roots;
+    TransformSystem transforms;
+    vector<unsigned int> rootHandles;
+    unique_ptr<Shader> shader;
+    PerViewBlock perView;
+    unique_ptr<InstanceBuffer> instanceBuffer;
+    // This frame's update, recorded with the upload once it is drawn.
+    double updateTime = 0.0;
+    long long updatedTotal = 0;
+    vector<double> updateTimes, uploadTimes;
+};
+
+// Pushes random points, matrices and quaternions through the SIMD and
+// scalar versions of the math functions every frame, and checks they
+// agree.
+class MathScene : public BenchScene {
+  public:
+    explicit MathScene(int points)
+        : BenchScene(0), matrices(points / MATH_POINTS_PER_MATRIX),
+          inputPoints(points), simdPoints(points), scalarPoints(points),
+          matrixA(matrices), matrixB(matrices), simdMatrices(matrices),
+          scalarMatrices(matrices), rotationA(matrices), rotationB(matrices),
+          simdRotations(matrices), scalarRotations(matrices) {}
+
+    bool Setup(Bench &) override {
+        srand(1);
+        for (vec3 &point : inputPoints) {
+            point = vec3(randomBetween(-100.0f, 100.0f),
+                         randomBetween(-100.0f, 100.0f),
+                         randomBetween(-100.0f, 100.0f));
+        }
+        auto randomRotation = []() {
+            return normalize(
+                quat(randomBetween(-1.0f, 1.0f), randomBetween(-1.0f, 1.0f),
+                     randomBetween(-1.0f, 1.0f), randomBetween(-1.0f, 1.0f)));
+        };
+        auto randomTranslation = []() {
+            return vec3(randomBetween(-1.0f, 1.0f), randomBetween(-1.0f, 1.0f),
+                        randomBetween(-1.0f, 1.0f));
+        };
+        for (size_t i = 0; i < matrices; i++) {
+            rotationA[i] = randomRotation();
+            rotationB[i] = randomRotation();
+            matrixA[i] = mat4::Trs(randomTranslation(), rotationA[i],
+                                   vec3(randomBetween(0.5f, 2.5f)));
+            matrixB[i] = mat4::Trs(randomTranslation(), rotationB[i],
+                                   vec3(randomBetween(0.5f, 2.5f)));
+        }
+        return true;
+    }
+
+    void Update(Bench &, Frame &frame) override {
+        TRACE_SCOPE("math");
+        mat4 model =
+            mat4::Trs(vec3(1.0f, 2.0f, 3.0f),
+                      quat::AxisAngle(vec3(0.0f, 1.0f, 0.0f),
+                                      frame.index * 0.01f),
+                      vec3(2.0f));
+        float t = (frame.index % 100) / 100.0f;
+
+        // Runs the SIMD and scalar versions of a function, alternating
+        // which goes first so neither always finds the inputs in cache.
+        auto measure = [&](int index, const function<void()> &simd,
+                           const function<void()> &scalar) {
+            double simdTime = 0.0, scalarTime = 0.0;
+            for (int pass = 0; pass < 2; pass++) {
+                bool simdPass = (pass + frame.index) % 2 == 0;
+                (simdPass ? simdTime : scalarTime) =
+                    timeMilliseconds(simdPass ? simd : scalar);
+            }
+            if (frame.measured) {
+                simdTimes[index].push_back(simdTime);
+                scalarTimes[index].push_back(scalarTime);
+            }
+        };
+
+        measure(
+            0,
+            [&]() {
+                transformPoints(model, inputPoints.data(), simdPoints.data(),
+                                inputPoints.size());
+            },
+            [&]() {
+                transformPointsScalar(model, inputPoints.data(),
+                                      scalarPoints.data(),
+                                      inputPoints.size());
+            });
+        measure(
+            1,
+            [&]() {
+                for (size_t i = 0; i < matrices; i++) {
+                    simdMatrices[i] = mul(matrixA[i], matrixB[i]);
+                }
+            },
+            [&]() {
+                for (size_t i = 0; i < matrices; i++) {
+                    scalarMatrices[i] = mulScalar(matrixA[i], matrixB[i]);
+                }
+            });
+        measure(
+            2,
+            [&]() {
+                for (size_t i = 0; i < matrices; i++) {
+                    simdRotations[i] = slerp(rotationA[i], rotationB[i], t);
+                }
+            },
+            [&]() {
+                for (size_t i = 0; i < matrices; i++) {
+                    scalarRotations[i] =
+                        slerpScalar(rotationA[i], rotationB[i], t);
+                }
+            });
+
+        // Relative difference, so large coordinates do not dominate.
+        auto compare = [&](const float *a, const float *b, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                maxError = max(maxError,
+                               fabsf(a[i] - b[i]) / max(1.0f, fabsf(b[i])));
+            }
+        };
+        compare(&simdPoints[0].x, &scalarPoints[0].x, simdPoints.size() * 3);
+        compare(simdMatrices[0].m, scalarMatrices[0].m, matrices * 16);
+        compare(&simdRotations[0].x, &scalarRotations[0].x, matrices * 4);
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        for (int function = 0; function < FUNCTIONS; function++) {
+            string name = string("math_") + FUNCTION_NAMES[function];
+            timings.Samples((name + "_simd").c_str(), simdTimes[function]);
+            timings.Samples((name + "_scalar").c_str(),
+                            scalarTimes[function]);
+        }
+    }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        counters.Number("math_points", inputPoints.size());
+        counters.Number("math_matrices", matrices);
+        counters.String("math_kernel", vectorMathKernel());
+        counters.Number("math_max_relative_error", maxError);
+    }
+
+  private:
+    static constexpr int FUNCTIONS = 3;
+    static constexpr const char *FUNCTION_NAMES[FUNCTIONS] = {
+        "transform_points", "mul", "slerp"};
+
+    size_t matrices;
+    // Random inputs, and an output array for each of the SIMD and scalar
+    // versions so they can be compared.
+    vector<vec3> inputPoints, simdPoints, scalarPoints;
+    vector<mat4> matrixA, matrixB, simdMatrices, scalarMatrices;
+    vector<quat> rotationA, rotationB, simdRotations, scalarRotations;
+    float maxError = 0.0f;
+    vector<double> simdTimes[FUNCTIONS], scalarTimes[FUNCTIONS];
+};
+
+} // namespace
+
+BenchScene *CreateTransformsScene(const Options &) {
+    return new TransformsScene(TRANSFORM_ROOTS);
+}
+
+BenchScene *CreateMathScene(const Options &options) {
+    return new MathScene(objectsOr(options, MATH_POINTS));
+}
@@ -0,0 +1,405 @@
+#include "../classes/FrameArena.h"
+#include "../classes/GLHandlePool.h"
+#include "../classes/Trace.h"
+#include "Bench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+// Buffers the handles scene creates and deletes each frame.
+const int HANDLE_OBJECTS = 10000;
+
+// The unload scene loads a level of UNLOAD_OBJECTS buffers of
+// UNLOAD_BUFFER_BYTES every UNLOAD_LEVEL_FRAMES frames and unloads it
+// halfway through.
+const int UNLOAD_OBJECTS = 20000;
+const int UNLOAD_LEVEL_FRAMES = 30;
+const GLsizeiptr UNLOAD_BUFFER_BYTES = 256;
+
+// The arena scene culls ARENA_OBJECTS objects against a circle
+// ARENA_VIEW_RADIUS units across around a camera moving ARENA_SPEED units
+// per frame, in jobs of ARENA_GRAIN objects. Each thread's arena holds
+// ARENA_BYTES_PER_OBJECT bytes per object per frame, enough for the
+// quarter of them in view.
+const int ARENA_OBJECTS = 100000;
+const float ARENA_WORLD_SIZE = 1000.0f;
+const float ARENA_VIEW_RADIUS = 280.0f;
+const float ARENA_SPEED = 2.0f;
+const size_t ARENA_GRAIN = 8192;
+const size_t ARENA_BYTES_PER_OBJECT = 32;
+
+// An object of the arena scene, on the ground plane.
+struct ArenaObject {
+    float x, z;
+    uint32_t material;
+};
+
+// A draw of the arena scene: sort key (material, then distance) and
+// object.
+struct ArenaDraw {
+    uint64_t key;
+    uint32_t object;
+
+    bool operator<(const ArenaDraw &other) const { return key < other.key; }
+};
+
+// Draws of one job of the arena scene, sorted, and their staged uniforms.
+struct ArenaChunk {
+    const ArenaDraw *draws;
+    size_t count;
+    const float *uniforms;
+};
+
+// Everything the arena scene's jobs need, so the job lambda captures one
+// pointer and fits in std::function without allocating.
+struct ArenaFrame {
+    const ArenaObject *objects;
+    float cameraX;
+    ThreadFrameArenas *arenas;
+    ArenaChunk *chunks;
+};
+
+// Whether an object is in view, and its draw.
+bool arenaVisible(const ArenaObject &object, float cameraX, uint32_t index,
+                  ArenaDraw &draw) {
+    float dx = object.x - cameraX;
+    float distance = dx * dx + object.z * object.z;
+    if (distance > ARENA_VIEW_RADIUS * ARENA_VIEW_RADIUS) {
+        return false;
+    }
+    draw.key = ((uint64_t)object.material << 32) | (uint32_t)distance;
+    draw.object = index;
+    return true;
+}
+
+// Stages a translation matrix for an object.
+void arenaStageUniforms(const ArenaObject &object, float *out) {
+    const float matrix[16] = {1, 0, 0, 0, 0, 1, 0, 0,
+                              0, 0, 1, 0, object.x, 0, object.z, 1};
+    memcpy(out, matrix, sizeof(matrix));
+}
+
+// Sums a draw list so the two versions can be compared.
+template <typename Draws> uint64_t arenaChecksum(const Draws &draws) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < draws.size(); i++) {
+        sum = sum * 31 + (draws[i].key ^ draws[i].object);
+    }
+    return sum;
+}
+
+// Builds the frame's sorted draw list and uniform staging the usual way,
+// in vectors that grow on the heap.
+uint64_t arenaBuildOnHeap(JobSystem &jobs, const vector<ArenaObject> &objects,
+                          float cameraX) {
+    size_t chunkCount = (objects.size() + ARENA_GRAIN - 1) / ARENA_GRAIN;
+    vector<vector<ArenaDraw>> chunkDraws(chunkCount);
+    vector<vector<float>> chunkUniforms(chunkCount);
+    jobs.ParallelFor(objects.size(), ARENA_GRAIN, [&](size_t begin,
+                                                      size_t end) {
+        for (size_t first = begin; first < end; first += ARENA_GRAIN) {
+            size_t last = min(first + ARENA_GRAIN, end);
+            vector<ArenaDraw> &draws = chunkDraws[first / ARENA_GRAIN];
+            vector<float> &uniforms = chunkUniforms[first / ARENA_GRAIN];
+            for (size_t i = first; i < last; i++) {
+                ArenaDraw draw;
+                if (arenaVisible(objects[i], cameraX, (uint32_t)i, draw)) {
+                    draws.push_back(draw);
+                    uniforms.resize(uniforms.size() + 16);
+                    arenaStageUniforms(objects[i],
+                                       &uniforms[uniforms.size() - 16]);
+                }
+            }
+            sort(draws.begin(), draws.end());
+        }
+    });
+
+    vector<ArenaDraw> drawList;
+    for (const vector<ArenaDraw> &draws : chunkDraws) {
+        drawList.insert(drawList.end(), draws.begin(), draws.end());
+    }
+    return arenaChecksum(drawList);
+}
+
+// Builds the same lists in the calling and job threads' frame arenas.
+uint64_t arenaBuildInArenas(JobSystem &jobs,
+                            const vector<ArenaObject> &objects, float cameraX,
+                            ThreadFrameArenas &arenas) {
+    size_t chunkCount = (objects.size() + ARENA_GRAIN - 1) / ARENA_GRAIN;
+    ArenaFrame frame = {objects.data(), cameraX, &arenas,
+                        arenas.Local().Allocate<ArenaChunk>(chunkCount)};
+    ArenaFrame *shared = &frame;
+    jobs.ParallelFor(objects.size(), ARENA_GRAIN, [shared](size_t begin,
+                                                           size_t end) {
+        FrameArena &arena = shared->arenas->Local();
+        for (size_t first = begin; first < end; first += ARENA_GRAIN) {
+            size_t last = min(first + ARENA_GRAIN, end);
+            // Count first, so the arena holds only what is visible.
+            size_t visible = 0;
+            ArenaDraw draw;
+            for (size_t i = first; i < last; i++) {
+                visible += arenaVisible(shared->objects[i], shared->cameraX,
+                                        (uint32_t)i, draw);
+            }
+            FrameVector<ArenaDraw> draws{FrameAllocator<ArenaDraw>(arena)};
+            draws.reserve(visible);
+            for (size_t i = first; i < last; i++) {
+                if (arenaVisible(shared->objects[i], shared->cameraX,
+                                 (uint32_t)i, draw)) {
+                    draws.push_back(draw);
+                }
+            }
+            float *uniforms = arena.Allocate<float>(draws.size() * 16);
+            for (size_t d = 0; d < draws.size(); d++) {
+                arenaStageUniforms(shared->objects[draws[d].object],
+                                   uniforms + d * 16);
+            }
+            sort(draws.begin(), draws.end());
+            shared->chunks[first / ARENA_GRAIN] = {draws.data(), draws.size(),
+                                                   uniforms};
+        }
+    });
+
+    size_t total = 0;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        total += frame.chunks[chunk].count;
+    }
+    FrameVector<ArenaDraw> drawList{FrameAllocator<ArenaDraw>(arenas.Local())};
+    drawList.reserve(total);
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        drawList.insert(drawList.end(), frame.chunks[chunk].draws,
+                        frame.chunks[chunk].draws + frame.chunks[chunk].count);
+    }
+    return arenaChecksum(drawList);
+}
+
+// Creates, binds and deletes the same number of buffers through the handle
+// pool and with one glGen/glDelete call each, every frame. Handles kept
+// past the delete must read as stale.
+class HandlesScene : public BenchScene {
+  public:
+    explicit HandlesScene(int objects) : buffers(objects), names(objects) {}
+
+    void Prepare(Bench &, Frame &frame) override {
+        TRACE_SCOPE("handles");
+        GLHandlePool &pool = GLHandlePool::Get(GL_OBJECT_BUFFER);
+        size_t callsBefore = pool.GenerateCalls() + pool.DeleteCalls();
+        double poolTime = timeMilliseconds([&]() {
+            GLBuffer::Create(buffers.data(), buffers.size());
+            for (const GLBuffer &buffer : buffers) {
+                glBindBuffer(GL_ARRAY_BUFFER, buffer.Name());
+            }
+            kept.clear();
+            for (size_t i = 0; i < buffers.size(); i++) {
+                if (i % 100 == 0) {
+                    kept.push_back(buffers[i].Handle());
+                }
+                buffers[i].Reset();
+            }
+            pool.Flush();
+        });
+        size_t poolCalls =
+            pool.GenerateCalls() + pool.DeleteCalls() - callsBefore;
+        for (GLHandle handle : kept) {
+            stale++;
+            staleDetected += pool.IsValid(handle) ? 0 : 1;
+        }
+
+        double rawTime = timeMilliseconds([&]() {
+            for (GLuint &name : names) {
+                glGenBuffers(1, &name);
+                glBindBuffer(GL_ARRAY_BUFFER, name);
+            }
+            for (GLuint &name : names) {
+                glDeleteBuffers(1, &name);
+            }
+        });
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (frame.measured) {
+            poolTimes.push_back(poolTime);
+            rawTimes.push_back(rawTime);
+            poolCallsTotal += poolCalls;
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("handles_pooled", poolTimes);
+        timings.Samples("handles_individual", rawTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("handle_objects", buffers.size());
+        counters.Number("handle_pooled_gen_delete_calls",
+                        (double)poolCallsTotal / bench.options.frames);
+        counters.Number("handle_individual_gen_delete_calls",
+                        2 * buffers.size());
+        counters.Number("handle_stale_detected",
+                        (double)staleDetected / max(stale, 1LL));
+        counters.Number("handle_speedup_p50",
+                        summarise(rawTimes).p50 / summarise(poolTimes).p50);
+    }
+
+  private:
+    vector<GLBuffer> buffers;
+    vector<GLuint> names;
+    // One handle in a hundred, checked after its buffer is deleted.
+    vector<GLHandle> kept;
+    size_t poolCallsTotal = 0;
+    long long stale = 0, staleDetected = 0;
+    vector<double> poolTimes, rawTimes;
+};
+
+// Loads a level's buffers, then unloads them all in one frame: deleted
+// straight away on odd levels, through the deletion queue on even ones,
+// which spreads them over the next frames' GLHandlePool::EndFrame.
+class UnloadScene : public BenchScene {
+  public:
+    explicit UnloadScene(int objects) : levelBuffers(objects) {}
+
+    void Prepare(Bench &, Frame &frame) override {
+        TRACE_SCOPE("level");
+        int level = frame.index / UNLOAD_LEVEL_FRAMES;
+        int levelFrame = frame.index % UNLOAD_LEVEL_FRAMES;
+        if (levelFrame == 0) {
+            vector<unsigned char> contents(UNLOAD_BUFFER_BYTES, 0x5a);
+            GLBuffer::Create(levelBuffers.data(), levelBuffers.size());
+            for (const GLBuffer &buffer : levelBuffers) {
+                glBindBuffer(GL_ARRAY_BUFFER, buffer.Name());
+                glBufferData(GL_ARRAY_BUFFER, UNLOAD_BUFFER_BYTES,
+                             contents.data(), GL_STATIC_DRAW);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        } else if (levelFrame == UNLOAD_LEVEL_FRAMES / 2) {
+            bool immediate = level % 2 == 1;
+            double time = timeMilliseconds([&]() {
+                for (GLBuffer &buffer : levelBuffers) {
+                    buffer.Reset();
+                }
+                if (immediate) {
+                    GLHandlePool::Get(GL_OBJECT_BUFFER).Flush();
+                } else {
+                    unloadFrame = frame.index;
+                }
+            });
+            if (frame.measured) {
+                (immediate ? immediateTimes : deferredTimes).push_back(time);
+            }
+        }
+    }
+
+    void EndFrame(Bench &, const Frame &frame) override {
+        GLHandlePool &pool = GLHandlePool::Get(GL_OBJECT_BUFFER);
+        if (frame.measured) {
+            endFrameTimes.push_back(frame.poolEndFrameTime);
+        }
+        if (unloadFrame >= 0 && pool.RetiringDeletes() == 0) {
+            if (frame.measured) {
+                drainFrames.push_back(frame.index - unloadFrame);
+            }
+            unloadFrame = -1;
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("unload_immediate", immediateTimes);
+        timings.Samples("unload_deferred", deferredTimes);
+        timings.Samples("deletion_queue_end_frame", endFrameTimes);
+    }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        counters.Number("unload_objects", levelBuffers.size());
+        counters.Number("deletion_budget_per_frame",
+                        GLHandlePool::DEFAULT_DELETE_BUDGET);
+        counters.Number("unload_frames_to_delete", summarise(drainFrames).p50);
+    }
+
+  private:
+    vector<GLBuffer> levelBuffers;
+    // Frame of the last deferred unload, and the frames each one took to
+    // be deleted completely.
+    int unloadFrame = -1;
+    vector<double> drainFrames;
+    vector<double> immediateTimes, deferredTimes, endFrameTimes;
+};
+
+// Builds each frame's sorted draw list and uniform staging for the objects
+// in view, first in vectors on the heap and then in per-thread frame
+// arenas, and checks both give the same list.
+class ArenaScene : public BenchScene {
+  public:
+    explicit ArenaScene(int objects) : objects(objects) {}
+
+    bool Setup(Bench &bench) override {
+        srand(1);
+        for (ArenaObject &object : objects) {
+            object.x = randomBetween(0.0f, ARENA_WORLD_SIZE);
+            object.z =
+                randomBetween(-ARENA_WORLD_SIZE / 2, ARENA_WORLD_SIZE / 2);
+            object.material = (uint32_t)randomBetween(0.0f, 64.0f);
+        }
+        arenas.reset(new ThreadFrameArenas(
+            bench.jobs.ThreadCount(), objects.size() * ARENA_BYTES_PER_OBJECT));
+        return true;
+    }
+
+    void Prepare(Bench &bench, Frame &frame) override {
+        TRACE_SCOPE("frame lists");
+        float cameraX = fmodf(frame.index * ARENA_SPEED, ARENA_WORLD_SIZE);
+        uint64_t heapSum = 0, arenaSum = 0;
+        double heapTime = timeMilliseconds([&]() {
+            heapSum = arenaBuildOnHeap(bench.jobs, objects, cameraX);
+        });
+        double arenaTime = timeMilliseconds([&]() {
+            arenas->BeginFrame();
+            arenaSum =
+                arenaBuildInArenas(bench.jobs, objects, cameraX, *arenas);
+        });
+        if (frame.measured) {
+            heapTimes.push_back(heapTime);
+            arenaTimes.push_back(arenaTime);
+            mismatch = mismatch || heapSum != arenaSum;
+        }
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("frame_lists_heap", heapTimes);
+        timings.Samples("frame_lists_arena", arenaTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("arena_objects", objects.size());
+        counters.Number("arena_threads", bench.jobs.ThreadCount());
+        counters.Number("arena_peak_kilobytes", arenas->PeakUsed() / 1024.0);
+        counters.Number("arena_overflow_allocations",
+                        arenas->OverflowAllocations());
+        counters.Bool("arena_lists_match", !mismatch);
+    }
+
+  private:
+    vector<ArenaObject> objects;
+    // One arena per job thread.
+    unique_ptr<ThreadFrameArenas> arenas;
+    bool mismatch = false;
+    vector<double> heapTimes, arenaTimes;
+};
+
+} // namespace
+
+BenchScene *CreateHandlesScene(const Options &options) {
+    return new HandlesScene(objectsOr(options, HANDLE_OBJECTS));
+}
+
+BenchScene *CreateUnloadScene(const Options &options) {
+    return new UnloadScene(objectsOr(options, UNLOAD_OBJECTS));
+}
+
+BenchScene *CreateArenaScene(const Options &) {
+    return new ArenaScene(ARENA_OBJECTS);
+}
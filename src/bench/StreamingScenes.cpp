@@ -0,0 +1,357 @@
+#include "../classes/AssetPack.h"
+#include "../classes/AssetPackWriter.h"
+#include "../classes/ElementBufferObject.h"
+#include "../classes/Log.h"
+#include "../classes/StreamingManager.h"
+#include "../classes/Trace.h"
+#include "../classes/VirtualTexture.h"
+#include "Bench.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Textures the streaming scene flies past, three times the budget.
+const int STREAM_TEXTURES = 32;
+
+// The streaming scene's textures sit in a row STREAM_SPACING units apart
+// and the camera flies down it STREAM_SPEED units per frame, seeing
+// STREAM_VIEW_DISTANCE units ahead. Each texture is STREAM_TEXTURE_SIZE
+// pixels square and the budget holds about a third of them.
+const float STREAM_SPACING = 4.0f;
+const float STREAM_SPEED = 0.25f;
+const float STREAM_VIEW_DISTANCE = 40.0f;
+const int STREAM_TEXTURE_SIZE = 512;
+const size_t STREAM_BUDGET_BYTES = 16 << 20;
+
+// Pages along each side of the virtual scene's texture, 32K texels.
+const int VIRTUAL_PAGES = 256;
+
+// The virtual scene's page cache is VIRTUAL_CACHE_SLOTS pages square, about
+// three times the pages the screen needs, and its feedback pass renders at
+// 1 / VIRTUAL_FEEDBACK_DIVISOR of the resolution. The camera flies
+// VIRTUAL_SPEED units per frame over a plane VIRTUAL_PLANE_SIZE units
+// across.
+const int VIRTUAL_CACHE_SLOTS = 12;
+const int VIRTUAL_FEEDBACK_DIVISOR = 8;
+const unsigned int VIRTUAL_WORKERS = 2;
+const float VIRTUAL_SPEED = 1.5f;
+const float VIRTUAL_PLANE_SIZE = 1000.0f;
+
+// Bakes count procedural textures, stream0 and up, into a pack, and returns
+// its size, or 0 on failure.
+size_t bakeStreamingPack(const char *packPath, int count) {
+    AssetPackWriter writer;
+    vector<unsigned char> pixels(STREAM_TEXTURE_SIZE * STREAM_TEXTURE_SIZE * 4);
+    for (int texture = 0; texture < count; texture++) {
+        // Checkers of a different size and colour per texture.
+        int cell = 4 << (texture % 5);
+        for (int y = 0; y < STREAM_TEXTURE_SIZE; y++) {
+            for (int x = 0; x < STREAM_TEXTURE_SIZE; x++) {
+                unsigned char *pixel =
+                    &pixels[(y * STREAM_TEXTURE_SIZE + x) * 4];
+                bool odd = (x / cell + y / cell) % 2 != 0;
+                pixel[0] = odd ? (unsigned char)(texture * 37) : 255;
+                pixel[1] = odd ? (unsigned char)(texture * 91) : 255;
+                pixel[2] = odd ? (unsigned char)(texture * 53) : 255;
+                pixel[3] = 255;
+            }
+        }
+        string name = "stream" + to_string(texture);
+        if (!writer.AddTexture(name.c_str(), pixels.data(),
+                               STREAM_TEXTURE_SIZE, STREAM_TEXTURE_SIZE)) {
+            return 0;
+        }
+    }
+    return writer.Write(packPath) ? writer.Size() : 0;
+}
+
+// Writes a page of the virtual scene's texture: 512 texel fields of hashed
+// colours with dark lines every 64 texels, point sampled at each texel's
+// centre for the coarser levels.
+void virtualTile(int level, int pageX, int pageY, unsigned char *out) {
+    int scale = 1 << level;
+    for (int row = 0; row < VirtualTexture::SLOT_SIZE; row++) {
+        int y = (pageY * VirtualTexture::PAGE_SIZE -
+                 VirtualTexture::PAGE_BORDER + row) *
+                    scale +
+                scale / 2;
+        y = max(y, 0);
+        for (int column = 0; column < VirtualTexture::SLOT_SIZE; column++) {
+            int x = (pageX * VirtualTexture::PAGE_SIZE -
+                     VirtualTexture::PAGE_BORDER + column) *
+                        scale +
+                    scale / 2;
+            x = max(x, 0);
+            unsigned int field =
+                (unsigned int)(x >> 9) * 73856093u ^ (y >> 9) * 19349663u;
+            unsigned int shade = (x & 63) < 2 || (y & 63) < 2 ? 96 : 255;
+            unsigned char *texel = out + (row * VirtualTexture::SLOT_SIZE +
+                                          column) * 4;
+            texel[0] = (unsigned char)((field & 255) * shade / 255);
+            texel[1] = (unsigned char)((field >> 8 & 255) * shade / 255);
+            texel[2] = (unsigned char)((field >> 16 & 255) * shade / 255);
+            texel[3] = 255;
+        }
+    }
+}
+
+// Flies down a row of textures baked into a pack, requesting the ones ahead
+// of the camera with their projected size, nearest first, and letting the
+// manager upload and evict them within its budget. Each visible texture is
+// drawn on one quad.
+class StreamingScene : public BenchScene {
+  public:
+    explicit StreamingScene(int textures) : BenchScene(0), textures(textures) {}
+
+    int MaxDraws() const override { return textures; }
+
+    bool Setup(Bench &) override {
+        TRACE_SCOPE("bake streamed textures");
+        if (bakeStreamingPack(PACK_PATH, textures) == 0) {
+            LOG_ERROR("Failed to bake %s", PACK_PATH);
+            return false;
+        }
+        pack.reset(new AssetPack(PACK_PATH));
+        if (!pack->IsOpen()) {
+            LOG_ERROR("Failed to open %s", PACK_PATH);
+            return false;
+        }
+        streaming.reset(new StreamingManager(*pack, STREAM_BUDGET_BYTES));
+        for (int texture = 0; texture < textures; texture++) {
+            string name = "stream" + to_string(texture);
+            assets.push_back(streaming->AddTexture(name.c_str()));
+        }
+        return true;
+    }
+
+    void Prepare(Bench &, Frame &frame) override {
+        TRACE_SCOPE("streaming");
+        float track = STREAM_SPACING * textures;
+        float camera = fmodf(frame.index * STREAM_SPEED, track);
+        float focal = FRAMEBUFFER_HEIGHT / (2.0f * tanf(0.3926991f));
+        visible.clear();
+        for (int texture = 0; texture < textures; texture++) {
+            float distance =
+                fmodf(texture * STREAM_SPACING - camera + track, track);
+            if (distance < 1.0f || distance > STREAM_VIEW_DISTANCE) {
+                continue;
+            }
+            streaming->Request(assets[texture], focal / distance);
+            visible.push_back(assets[texture]);
+        }
+
+        double updateTime = timeMilliseconds([&]() { streaming->Update(); });
+        frame.draws = (int)visible.size();
+
+        if (frame.measured) {
+            updateTimes.push_back(updateTime);
+            peakResident = max(peakResident, streaming->ResidentBytes());
+            for (unsigned int asset : visible) {
+                int resident = streaming->ResidentMip(asset);
+                visibleTotal++;
+                if (resident < 0) {
+                    missingTotal++;
+                } else {
+                    mipDeficit +=
+                        max(resident - streaming->WantedMip(asset), 0);
+                }
+            }
+        }
+    }
+
+    void DrawQuad(Bench &bench, int draw) override {
+        // The demo texture stands in until a mip arrives.
+        GLuint texture = streaming->TextureID(visible[draw]);
+        glBindTexture(GL_TEXTURE_2D, texture != 0 ? texture : bench.face.ID());
+        BenchScene::DrawQuad(bench, draw);
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("streaming_update", updateTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("stream_textures", textures);
+        counters.Number("stream_budget_megabytes",
+                        streaming->BudgetBytes() / 1.0e6);
+        counters.Number("stream_peak_resident_megabytes",
+                        peakResident / 1.0e6);
+        counters.Number("stream_uploaded_megabytes",
+                        streaming->UploadedBytes() / 1.0e6);
+        counters.Number("stream_evicted_megabytes",
+                        streaming->EvictedBytes() / 1.0e6);
+        counters.Number("stream_visible_per_frame",
+                        (double)visibleTotal / bench.options.frames);
+        counters.Number("stream_visible_without_texture",
+                        (double)missingTotal / max(visibleTotal, 1LL));
+        counters.Number("stream_mean_mip_deficit",
+                        (double)mipDeficit /
+                            max(visibleTotal - missingTotal, 1LL));
+    }
+
+    void Delete() override {
+        if (streaming) {
+            streaming->Delete();
+        }
+    }
+
+  private:
+    static constexpr const char *PACK_PATH = "bench_stream.pack";
+
+    int textures;
+    unique_ptr<AssetPack> pack;
+    unique_ptr<StreamingManager> streaming;
+    vector<unsigned int> assets;
+    // Textures in view this frame, nearest first.
+    vector<unsigned int> visible;
+    long long visibleTotal = 0, missingTotal = 0;
+    long long mipDeficit = 0;
+    size_t peakResident = 0;
+    vector<double> updateTimes;
+};
+
+// Flies low over a ground plane textured from a virtual texture with a page
+// cache sized for the screen. Last frame's feedback drives the uploads,
+// then each frame renders its own feedback at low resolution before the
+// plane.
+class VirtualScene : public BenchScene {
+  public:
+    VirtualScene() : BenchScene(0) {}
+
+    bool Setup(Bench &) override {
+        shader.reset(
+            new Shader("../src/shaders/virtualTextureVertexShader.glsl",
+                       "../src/shaders/virtualTextureFragmentShader.glsl"));
+        feedbackShader.reset(
+            new Shader("../src/shaders/virtualTextureVertexShader.glsl",
+                       "../src/shaders/virtualTextureFeedbackShader.glsl"));
+        shader->bindUniformBlock("PerView", PER_VIEW_BINDING);
+        feedbackShader->bindUniformBlock("PerView", PER_VIEW_BINDING);
+        perView.Init(*shader);
+        texture.reset(new VirtualTexture(
+            VIRTUAL_PAGES, VIRTUAL_CACHE_SLOTS, virtualTile,
+            FRAMEBUFFER_WIDTH / VIRTUAL_FEEDBACK_DIVISOR,
+            FRAMEBUFFER_HEIGHT / VIRTUAL_FEEDBACK_DIVISOR, VIRTUAL_WORKERS));
+
+        float half = VIRTUAL_PLANE_SIZE / 2.0f;
+        const float planeVertices[] = {
+            -half, 0.0f, half,  1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+            half,  0.0f, half,  1.0f, 1.0f, 1.0f, 1.0f, 0.0f,
+            half,  0.0f, -half, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+            -half, 0.0f, -half, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f};
+        const GLuint planeIndices[] = {0, 1, 2, 0, 2, 3};
+        planeVAO.reset(new VertexArrayObject());
+        planeVAO->Bind();
+        planeVBO.reset(
+            new VertexBufferObject(planeVertices, sizeof(planeVertices)));
+        planeEBO.reset(
+            new ElementBufferObject(planeIndices, sizeof(planeIndices)));
+        linkMeshAttribs(*planeVAO, *planeVBO);
+        planeVAO->Unbind();
+        return true;
+    }
+
+    // Looks down at the plane as it flies over it.
+    void PushConstants(Bench &bench, const Frame &frame) override {
+        float x =
+            fmodf(frame.index * VIRTUAL_SPEED, VIRTUAL_PLANE_SIZE * 0.8f) -
+            VIRTUAL_PLANE_SIZE * 0.4f;
+        vec3 eye(x, 10.0f, VIRTUAL_PLANE_SIZE * 0.3f);
+        vec3 target(x + 20.0f, 0.0f, eye.z - 40.0f);
+        mat4 viewProjection =
+            mat4::Perspective(1.0472f,
+                              (float)FRAMEBUFFER_WIDTH / FRAMEBUFFER_HEIGHT,
+                              0.1f, 2000.0f) *
+            mat4::LookAt(eye, target, vec3(0.0f, 1.0f, 0.0f));
+        perView.Push(bench.uniformRing, viewProjection);
+    }
+
+    void Draw(Bench &bench, const Frame &frame) override {
+        TRACE_SCOPE("virtual texture");
+        double updateTime = timeMilliseconds([&]() { texture->Update(); });
+
+        feedbackShader->Activate();
+        perView.Bind(bench.uniformRing);
+        texture->Bind(*feedbackShader, 2, 3,
+                      -log2f((float)VIRTUAL_FEEDBACK_DIVISOR));
+        texture->BeginFeedback();
+        planeVAO->Bind();
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        texture->EndFeedback();
+
+        bench.offscreen.Bind();
+        shader->Activate();
+        texture->Bind(*shader, 2, 3);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+        if (frame.measured) {
+            updateTimes.push_back(updateTime);
+            bench.drawCalls += 2;
+            bench.triangles += 4;
+            if (texture->FeedbackReadbacks() != readbacks) {
+                requested += texture->RequestedPages();
+                missing += texture->MissingPages();
+            }
+        }
+        readbacks = texture->FeedbackReadbacks();
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("virtual_texture_update", updateTimes);
+    }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        counters.Number("virtual_megabytes", texture->VirtualBytes() / 1.0e6);
+        counters.Number("virtual_cache_megabytes",
+                        texture->CacheBytes() / 1.0e6);
+        counters.Number("virtual_page_table_megabytes",
+                        texture->PageTableBytes() / 1.0e6);
+        counters.Number("virtual_resident_pages", texture->ResidentPages());
+        counters.Number("virtual_uploaded_pages", texture->UploadedPages());
+        counters.Number("virtual_evicted_pages", texture->EvictedPages());
+        counters.Number("virtual_feedback_readbacks",
+                        texture->FeedbackReadbacks());
+        counters.Number("virtual_dropped_feedbacks",
+                        texture->DroppedFeedbacks());
+        counters.Number("virtual_requested_pages_mean",
+                        (double)requested /
+                            max(texture->FeedbackReadbacks(), (size_t)1));
+        counters.Number("virtual_missing_fraction",
+                        (double)missing / max(requested, 1LL));
+    }
+
+    void Delete() override {
+        if (texture) {
+            texture->Delete();
+            shader->Delete();
+            feedbackShader->Delete();
+            planeVAO->Delete();
+            planeVBO->Delete();
+            planeEBO->Delete();
+        }
+    }
+
+  private:
+    unique_ptr<VirtualTexture> texture;
+    unique_ptr<Shader> shader, feedbackShader;
+    PerViewBlock perView;
+    unique_ptr<VertexArrayObject> planeVAO;
+    unique_ptr<VertexBufferObject> planeVBO;
+    unique_ptr<ElementBufferObject> planeEBO;
+    long long requested = 0, missing = 0;
+    size_t readbacks = 0;
+    vector<double> updateTimes;
+};
+
+} // namespace
+
+BenchScene *CreateStreamingScene(const Options &options) {
+    return new StreamingScene(objectsOr(options, STREAM_TEXTURES));
+}
+
+BenchScene *CreateVirtualScene(const Options &) { return new VirtualScene(); }
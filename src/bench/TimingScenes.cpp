@@ -0,0 +1,216 @@
+#include "../classes/FixedTimestep.h"
+#include "../classes/FramePacer.h"
+#include "../classes/Trace.h"
+#include "Bench.h"
+#include <cstdlib>
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+// Frame rate the paced scene is capped at.
+const int PACED_FPS = 60;
+
+// The sim scene steps SIM_PARTICLES particles SIM_RATE times a second in a
+// box SIM_BOX_SIZE units across, under SIM_GRAVITY.
+const int SIM_PARTICLES = 20000;
+const double SIM_RATE = 60.0;
+const float SIM_BOX_SIZE = 100.0f;
+const float SIM_GRAVITY = -9.8f;
+
+// Particles of the sim scene, as x, y pairs.
+struct SimState {
+    vector<float> positions;
+    vector<float> velocities;
+};
+
+// Advances the particles one step, bouncing off the walls of the box.
+void simStep(SimState &state, double seconds) {
+    float dt = (float)seconds;
+    for (size_t i = 0; i < state.positions.size(); i++) {
+        if (i % 2 == 1) {
+            state.velocities[i] += SIM_GRAVITY * dt;
+        }
+        float &position = state.positions[i];
+        float &velocity = state.velocities[i];
+        position += velocity * dt;
+        if (position < 0.0f) {
+            position = -position;
+            velocity = -velocity;
+        } else if (position > SIM_BOX_SIZE) {
+            position = 2.0f * SIM_BOX_SIZE - position;
+            velocity = -velocity;
+        }
+    }
+}
+
+// The demo scene capped by the frame pacer. It waits for the pacer before
+// each frame, outside the CPU frame time; its input sample is the start of
+// the frame.
+class PacedScene : public BenchScene {
+  public:
+    explicit PacedScene(int fps) : fps(fps) {}
+
+    bool Setup(Bench &) override {
+        FramePacer::Settings pacing;
+        pacing.vsync = VSYNC_OFF;
+        pacing.targetFps = fps;
+        pacer.reset(new FramePacer(pacing));
+        return true;
+    }
+
+    void WaitForFrame() override {
+        pacer->BeginFrame();
+        pacer->InputSampled();
+    }
+
+    void Present() override {
+        pacer->EndFrame();
+        glFlush();
+        pacer->Presented();
+    }
+
+    void WriteCounters(Bench &, JsonObject &counters) override {
+        FramePacer::Stats pacing = pacer->GetStats();
+        counters.Number("paced_fps", fps);
+        counters.Number("paced_frame_mean_ms", pacing.frameMean);
+        counters.Number("paced_frame_jitter_ms", pacing.frameJitter);
+        counters.Number("paced_frame_p99_ms", pacing.frameP99);
+        counters.Number("paced_input_to_present_ms", pacing.latencyMean);
+        counters.Number("paced_input_to_present_p99_ms", pacing.latencyP99);
+        counters.Number("paced_wait_mean_ms", pacing.waitMean);
+    }
+
+    void Delete() override {
+        if (pacer) {
+            pacer->Delete();
+        }
+    }
+
+  private:
+    int fps;
+    unique_ptr<FramePacer> pacer;
+};
+
+// Particles stepped at a fixed rate and published as snapshots, which each
+// frame interpolates a step behind. The steps run inline on the render
+// thread for the first half of the measured frames and on their own thread
+// for the second.
+class SimScene : public BenchScene {
+  public:
+    explicit SimScene(int particles) : particles(particles) {}
+
+    bool Setup(Bench &) override {
+        srand(1);
+        for (int i = 0; i < particles * 2; i++) {
+            state.positions.push_back(randomBetween(0.0f, SIM_BOX_SIZE));
+            state.velocities.push_back(randomBetween(-20.0f, 20.0f));
+        }
+        snapshots.reset(new StateSnapshots<SimState>(state));
+        simulation.reset(new FixedTimestep(
+            1.0 / SIM_RATE, [this](unsigned long long step, double seconds) {
+                simStep(state, seconds);
+                snapshots->Publish(state, step);
+            }));
+        previous = state;
+        current = state;
+        rendered.resize(state.positions.size());
+        return true;
+    }
+
+    void Prepare(Bench &bench, Frame &frame) override {
+        TRACE_SCOPE("simulation");
+        const Options &options = bench.options;
+        if (frame.index == options.warmup) {
+            measureStart = Clock::now();
+            firstStep = simulation->GetStats().steps;
+        }
+        if (frame.index == options.warmup + options.frames / 2) {
+            simulation->Start();
+        }
+        float alpha = 0.0f;
+        unsigned long long step = 0;
+        double simTime = timeMilliseconds([&]() {
+            double now = FixedTimestep::Now();
+            if (!simulation->Running()) {
+                simulation->Advance(now);
+            }
+            step = snapshots->Read(previous, current);
+            alpha = simulation->Alpha(now, step);
+            for (size_t i = 0; i < rendered.size(); i++) {
+                rendered[i] =
+                    previous.positions[i] +
+                    (current.positions[i] - previous.positions[i]) * alpha;
+            }
+        });
+        double time = step - 1.0 + alpha;
+        if (frame.measured) {
+            if (simulation->Running()) {
+                threadedTimes.push_back(simTime);
+            } else {
+                inlineTimes.push_back(simTime);
+            }
+            reversals += time < renderedTime;
+        }
+        renderedTime = time;
+    }
+
+    // Stops the thread and works out the steps it ran per second of
+    // measured frames.
+    void Finish(Bench &) override {
+        measuredSeconds = millisecondsSince(measureStart) / 1000.0;
+        simulation->Stop();
+        stats = simulation->GetStats();
+        stepRate = (stats.steps - firstStep) / measuredSeconds;
+    }
+
+    void WriteTimings(Bench &, JsonObject &timings) override {
+        timings.Samples("sim_inline", inlineTimes);
+        timings.Samples("sim_threaded", threadedTimes);
+    }
+
+    void WriteCounters(Bench &bench, JsonObject &counters) override {
+        counters.Number("sim_particles", particles);
+        counters.Number("sim_rate_hz", SIM_RATE);
+        counters.Number("sim_steps_per_second", stepRate);
+        counters.Number("sim_frames_per_step",
+                        bench.options.frames / measuredSeconds / stepRate);
+        counters.Number("sim_step_mean_ms", stats.stepMean);
+        counters.Number("sim_step_max_ms", stats.stepMax);
+        counters.Number("sim_dropped_steps", stats.droppedSteps);
+        counters.Number("sim_interpolation_reversals", reversals);
+    }
+
+  private:
+    int particles;
+    // Stepped by the simulation only.
+    SimState state;
+    unique_ptr<StateSnapshots<SimState>> snapshots;
+    unique_ptr<FixedTimestep> simulation;
+    // The last two snapshots, and the positions blended between them.
+    SimState previous, current;
+    vector<float> rendered;
+    // Render thread time spent on the simulation per frame, stepping it
+    // inline and with its own thread.
+    vector<double> inlineTimes, threadedTimes;
+    // Frames whose interpolated simulation time went back, and the time
+    // of the last one.
+    long long reversals = 0;
+    double renderedTime = 0.0;
+    // Start and first step of the measured frames.
+    Clock::time_point measureStart = Clock::now();
+    unsigned long long firstStep = 0;
+    double measuredSeconds = 0.0, stepRate = 0.0;
+    FixedTimestep::Stats stats = {0, 0, 0.0, 0.0};
+};
+
+} // namespace
+
+BenchScene *CreatePacedScene(const Options &) {
+    return new PacedScene(PACED_FPS);
+}
+
+BenchScene *CreateSimScene(const Options &options) {
+    return new SimScene(objectsOr(options, SIM_PARTICLES));
+}
@@ -0,0 +1,216 @@
+#include "AssetPack.h"
+#include "Log.h"
+#include "Trace.h"
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Whether every index of a mesh whose blocks are in the file names one of
+// its vertices.
+template <typename Index>
+bool IndicesInRange(const char *data, const AssetPackMesh &mesh) {
+    const Index *indices = (const Index *)(data + mesh.indexOffset);
+    for (uint32_t i = 0; i < mesh.indexCount; i++) {
+        if (indices[i] >= mesh.vertexCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void BakedMesh::Draw() {
+    vao.Bind();
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+}
+
+void BakedMesh::Delete() {
+    vao.Delete();
+    vbo.Delete();
+    ebo.Delete();
+}
+
+AssetPack::AssetPack(const char *path) : file(path) {
+    TRACE_SCOPE("AssetPack::AssetPack");
+    if (file.IsOpen() && !Validate(path)) {
+        entries = nullptr;
+        entryCount = 0;
+    }
+}
+
+bool AssetPack::Validate(const char *path) {
+    const char *data = file.Data();
+    AssetPackHeader header;
+    if (file.Size() < sizeof(header)) {
+        LOG_ERROR("%s is not an asset pack", path);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0) {
+        LOG_ERROR("%s is not an asset pack", path);
+        return false;
+    }
+    if (header.version != ASSET_PACK_VERSION) {
+        LOG_ERROR("%s is asset pack version %u, expected %u; rebake it", path,
+                  header.version, ASSET_PACK_VERSION);
+        return false;
+    }
+    if (header.fileSize != file.Size() ||
+        header.entryOffset % ASSET_PACK_ALIGNMENT != 0 ||
+        !InFile(header.entryOffset,
+                (uint64_t)header.entryCount * sizeof(AssetPackEntry))) {
+        LOG_ERROR("%s is truncated or corrupt", path);
+        return false;
+    }
+    entries = (const AssetPackEntry *)(data + header.entryOffset);
+    entryCount = header.entryCount;
+
+    // Everything an entry points at is checked once here, so the loaders
+    // can read straight from the mapping.
+    for (size_t i = 0; i < entryCount; i++) {
+        const AssetPackEntry &entry = entries[i];
+        bool valid = entry.name[sizeof(entry.name) - 1] == '\0' &&
+                     entry.offset % ASSET_PACK_ALIGNMENT == 0 &&
+                     InFile(entry.offset, entry.size);
+        if (valid && entry.type == ASSET_PACK_MESH) {
+            const AssetPackMesh *mesh =
+                (const AssetPackMesh *)(data + entry.offset);
+            valid = entry.size >= sizeof(*mesh) && mesh->vertexStride >= 16 &&
+                    (mesh->indexType == GL_UNSIGNED_SHORT ||
+                     mesh->indexType == GL_UNSIGNED_INT) &&
+                    (mesh->texCoordType == GL_UNSIGNED_SHORT ||
+                     mesh->texCoordType == GL_HALF_FLOAT) &&
+                    mesh->vertexOffset % ASSET_PACK_ALIGNMENT == 0 &&
+                    mesh->indexOffset % ASSET_PACK_ALIGNMENT == 0 &&
+                    InFile(mesh->vertexOffset, mesh->vertexSize) &&
+                    InFile(mesh->indexOffset, mesh->indexSize) &&
+                    mesh->vertexSize ==
+                        (uint64_t)mesh->vertexCount * mesh->vertexStride &&
+                    mesh->indexSize ==
+                        (uint64_t)mesh->indexCount *
+                            (mesh->indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+            if (valid) {
+                valid = mesh->indexType == GL_UNSIGNED_SHORT
+                            ? IndicesInRange<uint16_t>(data, *mesh)
+                            : IndicesInRange<uint32_t>(data, *mesh);
+            }
+        } else if (valid && entry.type == ASSET_PACK_TEXTURE) {
+            const AssetPackTexture *texture =
+                (const AssetPackTexture *)(data + entry.offset);
+            valid = entry.size >= sizeof(*texture) &&
+                    texture->mipCount <= ASSET_PACK_MAX_MIPS;
+            uint64_t width = texture->width, height = texture->height;
+            for (uint32_t level = 0; valid && level < texture->mipCount;
+                 level++) {
+                valid = texture->mipSize[level] == width * height * 4 &&
+                        InFile(texture->mipOffset[level],
+                               texture->mipSize[level]);
+                width = width > 1 ? width / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+        }
+        if (!valid) {
+            LOG_ERROR("%s: entry %zu is corrupt", path, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AssetPack::InFile(uint64_t offset, uint64_t size) const {
+    return offset <= file.Size() && size <= file.Size() - offset;
+}
+
+bool AssetPack::IsOpen() const { return entries != nullptr; }
+
+size_t AssetPack::EntryCount() const { return entryCount; }
+
+const AssetPackEntry &AssetPack::Entry(size_t index) const {
+    return entries[index];
+}
+
+const char *AssetPack::Data() const { return file.Data(); }
+
+const AssetPackEntry *AssetPack::Find(const char *name,
+                                      AssetPackType type) const {
+    for (size_t i = 0; i < entryCount; i++) {
+        if (entries[i].type == type && strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+BakedMesh AssetPack::LoadMesh(const char *name) const {
+    TRACE_SCOPE("AssetPack::LoadMesh");
+    const AssetPackEntry *entry = Find(name, ASSET_PACK_MESH);
+    if (entry == nullptr) {
+        LOG_ERROR("Asset pack has no mesh '%s'", name);
+    }
+    const AssetPackMesh *mesh =
+        entry != nullptr ? (const AssetPackMesh *)(file.Data() + entry->offset)
+                         : nullptr;
+    const char *vertices =
+        mesh != nullptr ? file.Data() + mesh->vertexOffset : nullptr;
+    const char *indices =
+        mesh != nullptr ? file.Data() + mesh->indexOffset : nullptr;
+
+    VertexArrayObject vao;
+    vao.Bind();
+    VertexBufferObject vbo((const void *)vertices,
+                           mesh != nullptr ? mesh->vertexSize : 0);
+    ElementBufferObject ebo((const void *)indices,
+                            mesh != nullptr ? mesh->indexSize : 0);
+    if (mesh != nullptr) {
+        GLsizeiptr stride = mesh->vertexStride;
+        vao.LinkAttrib(vbo, 0, 3, GL_HALF_FLOAT, stride, (void *)0);
+        vao.LinkAttrib(vbo, 1, 4, GL_UNSIGNED_BYTE, stride, (void *)8,
+                       GL_TRUE);
+        vao.LinkAttrib(vbo, 2, 2, mesh->texCoordType, stride, (void *)12,
+                       mesh->texCoordType == GL_UNSIGNED_SHORT ? GL_TRUE
+                                                               : GL_FALSE);
+    }
+    vao.Unbind();
+
+    return {std::move(vao), std::move(vbo), std::move(ebo),
+            mesh != nullptr ? (GLenum)mesh->indexType : GL_UNSIGNED_INT,
+            mesh != nullptr ? (GLsizei)mesh->indexCount : 0};
+}
+
+Texture AssetPack::LoadTexture(const char *name, GLenum slot) const {
+    TRACE_SCOPE("AssetPack::LoadTexture");
+    const AssetPackEntry *entry = Find(name, ASSET_PACK_TEXTURE);
+    if (entry == nullptr) {
+        LOG_ERROR("Asset pack has no texture '%s'", name);
+        return Texture(nullptr, 0, 0, 0, GL_TEXTURE_2D, slot, GL_RGBA,
+                       GL_UNSIGNED_BYTE);
+    }
+    const AssetPackTexture *texture =
+        (const AssetPackTexture *)(file.Data() + entry->offset);
+    const unsigned char *mips[ASSET_PACK_MAX_MIPS];
+    for (uint32_t level = 0; level < texture->mipCount; level++) {
+        mips[level] =
+            (const unsigned char *)file.Data() + texture->mipOffset[level];
+    }
+    return Texture(mips, (int)texture->mipCount, (int)texture->width,
+                   (int)texture->height, GL_TEXTURE_2D, slot, GL_RGBA,
+                   GL_UNSIGNED_BYTE);
+}
+
+Shader AssetPack::LoadShader(const char *vertexName,
+                             const char *fragmentName) const {
+    TRACE_SCOPE("AssetPack::LoadShader");
+    const AssetPackEntry *vertex = Find(vertexName, ASSET_PACK_SHADER);
+    const AssetPackEntry *fragment = Find(fragmentName, ASSET_PACK_SHADER);
+    if (vertex == nullptr || fragment == nullptr) {
+        LOG_ERROR("Asset pack has no shader '%s'",
+                  vertex == nullptr ? vertexName : fragmentName);
+    }
+    // Sources are passed with their lengths; they are not null terminated.
+    return Shader(vertex != nullptr ? file.Data() + vertex->offset : "",
+                  vertex != nullptr ? (GLint)vertex->size : 0,
+                  fragment != nullptr ? file.Data() + fragment->offset : "",
+                  fragment != nullptr ? (GLint)fragment->size : 0);
+}
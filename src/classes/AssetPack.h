@@ -0,0 +1,143 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include "ElementBufferObject.h"
+#include "MappedFile.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "VertexArrayObject.h"
+#include "VertexBufferObject.h"
+#include "../glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+
+// Baked asset pack: meshes, textures and shader sources preprocessed by the
+// baker tool (AssetPackWriter) into the form the GPU wants, so loading is a
+// memory map and a few uploads straight from the mapping.
+//
+// Layout, little endian, every block starting on an ASSET_PACK_ALIGNMENT
+// boundary:
+//   AssetPackHeader
+//   blobs, each found through its entry
+//   AssetPackEntry table, at AssetPackHeader::entryOffset
+// A mesh entry points at an AssetPackMesh, a texture entry at an
+// AssetPackTexture, and a shader entry at the source text itself. All
+// offsets are from the start of the file.
+
+const char ASSET_PACK_MAGIC[8] = {'L', 'G', 'L', 'P', 'A', 'C', 'K', '\0'};
+const uint32_t ASSET_PACK_VERSION = 1;
+const size_t ASSET_PACK_ALIGNMENT = 64;
+const int ASSET_PACK_MAX_MIPS = 16;
+
+enum AssetPackType : uint32_t {
+    ASSET_PACK_MESH = 1,
+    ASSET_PACK_TEXTURE = 2,
+    ASSET_PACK_SHADER = 3,
+};
+
+struct AssetPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t entryOffset;
+    uint64_t fileSize;
+    uint8_t reserved[32];
+};
+
+struct AssetPackEntry {
+    // Null terminated.
+    char name[40];
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Vertices are 16 bytes, in the locations of the demo's vertex shader:
+//   0  position, 3 half floats (and one of padding)
+//   8  colour, 4 normalized unsigned bytes
+//   12 texture coordinate, 2 normalized unsigned shorts, or half floats if
+//      the mesh has coordinates outside [0, 1]
+struct AssetPackMesh {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;
+    // GL_UNSIGNED_SHORT when every index fits, else GL_UNSIGNED_INT.
+    uint32_t indexType;
+    // GL_UNSIGNED_SHORT or GL_HALF_FLOAT.
+    uint32_t texCoordType;
+    uint32_t reserved;
+    uint64_t vertexOffset;
+    uint64_t vertexSize;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+};
+
+// RGBA8 pixels with the full mip chain down to 1x1, rows in the order
+// Texture uploads them (bottom first).
+struct AssetPackTexture {
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t reserved;
+    uint64_t mipOffset[ASSET_PACK_MAX_MIPS];
+    uint64_t mipSize[ASSET_PACK_MAX_MIPS];
+};
+
+static_assert(sizeof(AssetPackHeader) == ASSET_PACK_ALIGNMENT,
+              "Header must fill one aligned block");
+static_assert(sizeof(AssetPackEntry) == ASSET_PACK_ALIGNMENT,
+              "Entries must fill one aligned block each");
+
+// A mesh uploaded from an asset pack.
+struct BakedMesh {
+    VertexArrayObject vao;
+    VertexBufferObject vbo;
+    ElementBufferObject ebo;
+    GLenum indexType;
+    GLsizei indexCount;
+
+    // Draws every triangle. Leaves the VAO bound.
+    void Draw();
+
+    // Deletes the VAO and buffers.
+    void Delete();
+};
+
+class AssetPack {
+  public:
+    // Constructor that maps and validates the pack at path. Check IsOpen
+    // before loading from it.
+    AssetPack(const char *path);
+
+    bool IsOpen() const;
+
+    size_t EntryCount() const;
+    const AssetPackEntry &Entry(size_t index) const;
+
+    // Entry called name of the given type, or nullptr.
+    const AssetPackEntry *Find(const char *name, AssetPackType type) const;
+
+    // Start of the mapping; every offset in the pack is relative to it.
+    const char *Data() const;
+
+    // Uploads a mesh. A missing mesh is logged and comes back empty.
+    BakedMesh LoadMesh(const char *name) const;
+
+    // Uploads a texture and its mips. A missing texture is logged and
+    // comes back without storage.
+    Texture LoadTexture(const char *name, GLenum slot) const;
+
+    // Builds a shader program from two shader entries.
+    Shader LoadShader(const char *vertexName, const char *fragmentName) const;
+
+  private:
+    MappedFile file;
+    const AssetPackEntry *entries = nullptr;
+    size_t entryCount = 0;
+
+    bool Validate(const char *path);
+    bool InFile(uint64_t offset, uint64_t size) const;
+};
+
+#endif
@@ -0,0 +1,303 @@
+#include "AssetPackWriter.h"
+#include "Log.h"
+#include "ObjLoader.h"
+#include "../stb/stb_image.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+size_t AlignUp(size_t offset) {
+    return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(ASSET_PACK_ALIGNMENT - 1);
+}
+
+// IEEE half float nearest to value, ties to even.
+uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {
+        // Infinity stays infinity, NaN stays NaN.
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    }
+    if (magnitude >= 0x477ff000) {
+        // Rounds past the largest half, 65504.
+        return sign | 0x7c00;
+    }
+    if (magnitude < 0x38800000) {
+        // Below the smallest normal half, 2^-14: count in units of 2^-24.
+        float scaled;
+        memcpy(&scaled, &magnitude, sizeof(scaled));
+        return sign | (uint16_t)lrintf(scaled * 16777216.0f);
+    }
+    // Rebias the exponent from 127 to 15 and round the mantissa to 10 bits.
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0)) {
+        half++;
+    }
+    return sign | (uint16_t)half;
+}
+
+// Normalized unsigned value of x in [0, 1] with the given maximum.
+uint32_t Unorm(float x, uint32_t maximum) {
+    x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+    return (uint32_t)lrintf(x * maximum);
+}
+
+bool ReadFile(const char *path, std::string &contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+} // namespace
+
+AssetPackWriter::AssetPackWriter() : data(sizeof(AssetPackHeader), '\0') {}
+
+size_t AssetPackWriter::Append(const void *bytes, size_t size) {
+    size_t offset = AlignUp(data.size());
+    data.resize(offset);
+    data.append((const char *)bytes, size);
+    return offset;
+}
+
+bool AssetPackWriter::CanAdd(const char *name, AssetPackType type) const {
+    if (strlen(name) >= sizeof(AssetPackEntry::name)) {
+        LOG_ERROR("Asset name '%s' is longer than %zu characters", name,
+                  sizeof(AssetPackEntry::name) - 1);
+        return false;
+    }
+    for (const AssetPackEntry &other : entries) {
+        if (other.type == (uint32_t)type && strcmp(other.name, name) == 0) {
+            LOG_ERROR("Asset '%s' was added twice", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetPackWriter::AddEntry(const char *name, AssetPackType type,
+                               size_t offset, size_t size) {
+    AssetPackEntry entry = {};
+    strcpy(entry.name, name);
+    entry.type = type;
+    entry.offset = offset;
+    entry.size = size;
+    entries.push_back(entry);
+}
+
+bool AssetPackWriter::AddMesh(const char *name, const Mesh &mesh) {
+    if (!CanAdd(name, ASSET_PACK_MESH)) {
+        return false;
+    }
+    const size_t STRIDE = 16;
+    size_t vertexCount = mesh.VertexCount();
+
+    AssetPackMesh header = {};
+    header.vertexCount = (uint32_t)vertexCount;
+    header.indexCount = (uint32_t)mesh.indices.size();
+    header.vertexStride = STRIDE;
+    header.indexType =
+        vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    header.texCoordType = GL_UNSIGNED_SHORT;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float *vertex = &mesh.vertices[i * Mesh::VERTEX_FLOATS];
+        for (int c = 6; c < 8; c++) {
+            if (!(vertex[c] >= 0.0f && vertex[c] <= 1.0f)) {
+                header.texCoordType = GL_HALF_FLOAT;
+            }
+        }
+    }
+
+    std::vector<unsigned char> vertices(vertexCount * STRIDE);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float *vertex = &mesh.vertices[i * Mesh::VERTEX_FLOATS];
+        unsigned char *out = &vertices[i * STRIDE];
+        uint16_t position[4] = {FloatToHalf(vertex[0]),
+                                FloatToHalf(vertex[1]),
+                                FloatToHalf(vertex[2]), 0};
+        uint8_t colour[4] = {(uint8_t)Unorm(vertex[3], 255),
+                             (uint8_t)Unorm(vertex[4], 255),
+                             (uint8_t)Unorm(vertex[5], 255), 255};
+        uint16_t texCoord[2];
+        for (int c = 0; c < 2; c++) {
+            texCoord[c] = header.texCoordType == GL_UNSIGNED_SHORT
+                              ? (uint16_t)Unorm(vertex[6 + c], 65535)
+                              : FloatToHalf(vertex[6 + c]);
+        }
+        memcpy(out, position, sizeof(position));
+        memcpy(out + 8, colour, sizeof(colour));
+        memcpy(out + 12, texCoord, sizeof(texCoord));
+    }
+
+    std::vector<uint16_t> shortIndices;
+    const void *indices = mesh.indices.data();
+    header.indexSize = mesh.indices.size() * sizeof(unsigned int);
+    if (header.indexType == GL_UNSIGNED_SHORT) {
+        shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+        indices = shortIndices.data();
+        header.indexSize = shortIndices.size() * sizeof(uint16_t);
+    }
+    header.vertexSize = vertices.size();
+
+    // The header goes first; its offsets are patched once the data is in.
+    size_t offset = Append(&header, sizeof(header));
+    header.vertexOffset = Append(vertices.data(), vertices.size());
+    header.indexOffset = Append(indices, header.indexSize);
+    memcpy(&data[offset], &header, sizeof(header));
+    AddEntry(name, ASSET_PACK_MESH, offset, data.size() - offset);
+    return true;
+}
+
+bool AssetPackWriter::AddTexture(const char *name,
+                                 const unsigned char *pixels, int width,
+                                 int height) {
+    if (!CanAdd(name, ASSET_PACK_TEXTURE)) {
+        return false;
+    }
+    const int MAX_SIZE = 1 << (ASSET_PACK_MAX_MIPS - 1);
+    if (width <= 0 || height <= 0 || width > MAX_SIZE || height > MAX_SIZE) {
+        LOG_ERROR("Texture '%s' is %dx%d, which has no mip chain of at most "
+                  "%d levels",
+                  name, width, height, ASSET_PACK_MAX_MIPS);
+        return false;
+    }
+
+    AssetPackTexture header = {};
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    size_t offset = Append(&header, sizeof(header));
+
+    std::vector<unsigned char> level(pixels,
+                                     pixels + (size_t)width * height * 4);
+    while (true) {
+        header.mipOffset[header.mipCount] = Append(level.data(), level.size());
+        header.mipSize[header.mipCount] = level.size();
+        header.mipCount++;
+        if (width == 1 && height == 1) {
+            break;
+        }
+
+        // Averages 2x2 blocks. On an odd side the last block also takes
+        // the leftover row or column, so it is 3 texels across there.
+        int nextWidth = width > 1 ? width / 2 : 1;
+        int nextHeight = height > 1 ? height / 2 : 1;
+        std::vector<unsigned char> next((size_t)nextWidth * nextHeight * 4);
+        for (int y = 0; y < nextHeight; y++) {
+            int y0 = height > 1 ? 2 * y : 0;
+            int y1 = height > 1 ? 2 * y + 1 : 0;
+            if (y == nextHeight - 1 && height > 1 && height % 2 == 1) {
+                y1++;
+            }
+            for (int x = 0; x < nextWidth; x++) {
+                int x0 = width > 1 ? 2 * x : 0;
+                int x1 = width > 1 ? 2 * x + 1 : 0;
+                if (x == nextWidth - 1 && width > 1 && width % 2 == 1) {
+                    x1++;
+                }
+                int texels = (y1 - y0 + 1) * (x1 - x0 + 1);
+                for (int c = 0; c < 4; c++) {
+                    int sum = 0;
+                    for (int sy = y0; sy <= y1; sy++) {
+                        for (int sx = x0; sx <= x1; sx++) {
+                            sum += level[((size_t)sy * width + sx) * 4 + c];
+                        }
+                    }
+                    next[((size_t)y * nextWidth + x) * 4 + c] =
+                        (unsigned char)((sum + texels / 2) / texels);
+                }
+            }
+        }
+        level.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    memcpy(&data[offset], &header, sizeof(header));
+    AddEntry(name, ASSET_PACK_TEXTURE, offset, data.size() - offset);
+    return true;
+}
+
+bool AssetPackWriter::AddShader(const char *name, const char *source,
+                                size_t size) {
+    if (!CanAdd(name, ASSET_PACK_SHADER)) {
+        return false;
+    }
+    size_t offset = Append(source, size);
+    AddEntry(name, ASSET_PACK_SHADER, offset, size);
+    return true;
+}
+
+bool AssetPackWriter::AddMeshFile(const char *name, const char *path,
+                                  JobSystem *jobs) {
+    Mesh mesh;
+    return ObjLoader::Load(path, mesh, jobs) && AddMesh(name, mesh);
+}
+
+bool AssetPackWriter::AddTextureFile(const char *name, const char *path) {
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *pixels = stbi_load(path, &width, &height, &channels, 4);
+    if (pixels == nullptr) {
+        LOG_ERROR("Failed to decode %s: %s", path, stbi_failure_reason());
+        return false;
+    }
+    bool added = AddTexture(name, pixels, width, height);
+    stbi_image_free(pixels);
+    return added;
+}
+
+bool AssetPackWriter::AddShaderFile(const char *name, const char *path) {
+    std::string source;
+    if (!ReadFile(path, source)) {
+        LOG_ERROR("Failed to read %s", path);
+        return false;
+    }
+    return AddShader(name, source.data(), source.size());
+}
+
+bool AssetPackWriter::Write(const char *path) const {
+    std::string pack = data;
+    size_t entryOffset = AlignUp(pack.size());
+    pack.resize(entryOffset);
+    pack.append((const char *)entries.data(),
+                entries.size() * sizeof(AssetPackEntry));
+
+    AssetPackHeader header = {};
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t)entries.size();
+    header.entryOffset = entryOffset;
+    header.fileSize = pack.size();
+    memcpy(&pack[0], &header, sizeof(header));
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open %s for writing", path);
+        return false;
+    }
+    bool written = fwrite(pack.data(), 1, pack.size(), file) == pack.size();
+    if (fclose(file) != 0 || !written) {
+        LOG_ERROR("Failed to write %s", path);
+        return false;
+    }
+    return true;
+}
+
+size_t AssetPackWriter::EntryCount() const { return entries.size(); }
+
+size_t AssetPackWriter::Size() const {
+    return AlignUp(data.size()) + entries.size() * sizeof(AssetPackEntry);
+}
@@ -0,0 +1,56 @@
+#ifndef ASSET_PACK_WRITER_H
+#define ASSET_PACK_WRITER_H
+
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Bakes source assets into an AssetPack file. Used by the baker tool; needs
+// no GL context.
+class AssetPackWriter {
+  public:
+    AssetPackWriter();
+
+    // Quantizes a mesh to the 16 byte AssetPackMesh vertex layout.
+    bool AddMesh(const char *name, const Mesh &mesh);
+
+    // Adds RGBA8 pixels and builds their mip chain with a box filter.
+    bool AddTexture(const char *name, const unsigned char *pixels, int width,
+                    int height);
+
+    bool AddShader(const char *name, const char *source, size_t size);
+
+    // Load a source file and add it. Textures are flipped like Texture
+    // does. Return false and log the reason on failure.
+    bool AddMeshFile(const char *name, const char *path,
+                     JobSystem *jobs = nullptr);
+    bool AddTextureFile(const char *name, const char *path);
+    bool AddShaderFile(const char *name, const char *path);
+
+    // Writes the pack.
+    bool Write(const char *path) const;
+
+    size_t EntryCount() const;
+
+    // Bytes Write will produce.
+    size_t Size() const;
+
+  private:
+    // Header and blobs so far; the entry table is appended by Write.
+    std::string data;
+    std::vector<AssetPackEntry> entries;
+
+    // Appends size bytes on the next aligned offset and returns it.
+    size_t Append(const void *bytes, size_t size);
+
+    // Whether name is short enough and not taken by another asset of type.
+    bool CanAdd(const char *name, AssetPackType type) const;
+
+    void AddEntry(const char *name, AssetPackType type, size_t offset,
+                  size_t size);
+};
+
+#endif
@@ -0,0 +1,573 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace {
+
+// Centroid bins per axis when evaluating split candidates. Nodes with fewer
+// primitives use one bin per primitive.
+const int BIN_COUNT = 16;
+
+// Leaves never hold more primitives than this, whatever the SAH says.
+const uint32_t MAX_LEAF_SIZE = 16;
+
+// SAH cost of visiting a node, relative to testing one primitive.
+const float TRAVERSAL_COST = 1.0f;
+
+// Nodes with more primitives than this are binned in parallel; smaller ones
+// are built serially as independent jobs.
+const uint32_t PARALLEL_THRESHOLD = 64 * 1024;
+
+// Primitives per job when binning a large node.
+const size_t BIN_GRAIN = 16 * 1024;
+
+const float INF = std::numeric_limits<float>::infinity();
+
+// A primitive being sorted into the tree. Build partitions these in place,
+// so every subtree's primitives end up contiguous.
+struct Primitive {
+    Aabb box;
+    uint32_t object;
+
+    float Centroid(int axis) const {
+        return 0.5f * (box.min[axis] + box.max[axis]);
+    }
+};
+
+// Bounds of a set of primitives and of their centroids.
+struct Bounds {
+    Aabb boxes;
+    Aabb centroids;
+    uint32_t count;
+
+    static Bounds Empty() { return {Aabb::Empty(), Aabb::Empty(), 0}; }
+
+    void Add(const Primitive &primitive) {
+        boxes.Grow(primitive.box);
+        float centroid[3] = {primitive.Centroid(0), primitive.Centroid(1),
+                             primitive.Centroid(2)};
+        centroids.Grow(centroid);
+        count++;
+    }
+
+    void Merge(const Bounds &other) {
+        boxes.Grow(other.boxes);
+        centroids.Grow(other.centroids);
+        count += other.count;
+    }
+};
+
+struct Bins {
+    int count;
+    Bounds axes[3][BIN_COUNT];
+
+    static Bins Empty(int count) {
+        Bins bins;
+        bins.count = count;
+        for (auto &axis : bins.axes) {
+            std::fill(axis, axis + count, Bounds::Empty());
+        }
+        return bins;
+    }
+
+    void Merge(const Bins &other) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int i = 0; i < count; i++) {
+                axes[axis][i].Merge(other.axes[axis][i]);
+            }
+        }
+    }
+};
+
+// A node waiting to be split, with the centroid bounds of its primitives.
+struct Task {
+    uint32_t node;
+    Aabb centroids;
+};
+
+struct Builder {
+    Primitive *primitives;
+    BvhNode *nodes;
+    std::atomic<uint32_t> nodeCount{0};
+
+    // Runs work(begin, end, partial) over [first, first + count), in
+    // parallel chunks if jobs is given, and merges the partial results.
+    template <typename Result, typename Work>
+    Result Reduce(uint32_t first, uint32_t count, JobSystem *jobs,
+                  const Result &initial, const Work &work) const {
+        if (jobs == nullptr || count <= PARALLEL_THRESHOLD) {
+            Result result = initial;
+            work(first, first + count, result);
+            return result;
+        }
+
+        std::vector<Result> partials((count + BIN_GRAIN - 1) / BIN_GRAIN,
+                                     initial);
+        jobs->ParallelFor(count, BIN_GRAIN, [&](size_t begin, size_t end) {
+            work(first + (uint32_t)begin, first + (uint32_t)end,
+                 partials[begin / BIN_GRAIN]);
+        });
+
+        Result result = initial;
+        for (const Result &partial : partials) {
+            result.Merge(partial);
+        }
+        return result;
+    }
+
+    Bounds Measure(uint32_t first, uint32_t count, JobSystem *jobs) const {
+        return Reduce(first, count, jobs, Bounds::Empty(),
+                      [this](uint32_t begin, uint32_t end, Bounds &out) {
+                          for (uint32_t i = begin; i < end; i++) {
+                              out.Add(primitives[i]);
+                          }
+                      });
+    }
+
+    Bins Histogram(uint32_t first, uint32_t count, const Aabb &centroids,
+                   JobSystem *jobs) const {
+        int binCount = (int)std::min<uint32_t>(count, BIN_COUNT);
+        float scale[3];
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = centroids.max[axis] - centroids.min[axis];
+            scale[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+        }
+
+        return Reduce(first, count, jobs, Bins::Empty(binCount),
+                      [&](uint32_t begin, uint32_t end, Bins &out) {
+                          for (uint32_t i = begin; i < end; i++) {
+                              const Primitive &primitive = primitives[i];
+                              for (int axis = 0; axis < 3; axis++) {
+                                  int bin = BinIndex(primitive.Centroid(axis),
+                                                     centroids.min[axis],
+                                                     scale[axis], binCount);
+                                  out.axes[axis][bin].Add(primitive);
+                              }
+                          }
+                      });
+    }
+
+    static int BinIndex(float centroid, float min, float scale,
+                        int binCount) {
+        int bin = (int)((centroid - min) * scale);
+        return std::min(std::max(bin, 0), binCount - 1);
+    }
+
+    // Builds the subtree under root, whose bounds, offset and count are set.
+    // With jobs, children at or below PARALLEL_THRESHOLD are appended to
+    // deferred instead of being built.
+    void BuildSubtree(const Task &root, JobSystem *jobs,
+                      std::vector<Task> *deferred) {
+        std::vector<Task> stack(1, root);
+        while (!stack.empty()) {
+            Task task = stack.back();
+            stack.pop_back();
+
+            Bounds children[2];
+            uint32_t leftCount = Split(task, jobs, children);
+            if (leftCount == 0) {
+                continue;
+            }
+
+            BvhNode &node = nodes[task.node];
+            uint32_t left = nodeCount.fetch_add(2, std::memory_order_relaxed);
+            uint32_t first = node.offset;
+            for (uint32_t i = 0; i < 2; i++) {
+                BvhNode &child = nodes[left + i];
+                std::copy(children[i].boxes.min, children[i].boxes.min + 3,
+                          child.min);
+                std::copy(children[i].boxes.max, children[i].boxes.max + 3,
+                          child.max);
+                child.offset = i == 0 ? first : first + leftCount;
+                child.count = children[i].count;
+
+                Task childTask = {left + i, children[i].centroids};
+                if (deferred != nullptr && child.count <= PARALLEL_THRESHOLD) {
+                    deferred->push_back(childTask);
+                } else {
+                    stack.push_back(childTask);
+                }
+            }
+            node.offset = left;
+            node.count = 0;
+        }
+    }
+
+    // Partitions a node's primitives and returns the size of the left
+    // half with the bounds of both halves, or 0 if the node should stay a
+    // leaf.
+    uint32_t Split(const Task &task, JobSystem *jobs, Bounds children[2]) {
+        const BvhNode &node = nodes[task.node];
+        uint32_t first = node.offset;
+        uint32_t count = node.count;
+        if (count == 1) {
+            return 0;
+        }
+
+        const Aabb &centroids = task.centroids;
+        bool degenerate = true;
+        for (int axis = 0; axis < 3; axis++) {
+            degenerate &= centroids.max[axis] <= centroids.min[axis];
+        }
+        if (degenerate) {
+            // Every centroid is the same point, so no plane separates them.
+            return count > MAX_LEAF_SIZE ? SplitMiddle(first, count, children)
+                                         : 0;
+        }
+
+        Bins bins = Histogram(first, count, centroids, jobs);
+
+        // Sweep each axis from both ends to cost every plane between bins.
+        float bestCost = INF;
+        int bestAxis = -1, bestBin = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            const Bounds *axisBins = bins.axes[axis];
+            float rightCost[BIN_COUNT];
+            Bounds side = Bounds::Empty();
+            for (int i = bins.count - 1; i > 0; i--) {
+                side.Merge(axisBins[i]);
+                rightCost[i] = side.boxes.SurfaceArea() * side.count;
+            }
+
+            side = Bounds::Empty();
+            for (int i = 0; i < bins.count - 1; i++) {
+                side.Merge(axisBins[i]);
+                if (side.count == 0 || side.count == count) {
+                    continue;
+                }
+                float cost =
+                    side.boxes.SurfaceArea() * side.count + rightCost[i + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = i;
+                }
+            }
+        }
+
+        float area = Aabb{{node.min[0], node.min[1], node.min[2]},
+                          {node.max[0], node.max[1], node.max[2]}}
+                         .SurfaceArea();
+        if (bestAxis < 0 || (count <= MAX_LEAF_SIZE &&
+                             TRAVERSAL_COST * area + bestCost >= area * count)) {
+            return count > MAX_LEAF_SIZE ? SplitMiddle(first, count, children)
+                                         : 0;
+        }
+
+        // The bins on each side of the plane already hold the exact bounds
+        // of both halves.
+        children[0] = children[1] = Bounds::Empty();
+        for (int i = 0; i < bins.count; i++) {
+            children[i <= bestBin ? 0 : 1].Merge(bins.axes[bestAxis][i]);
+        }
+
+        float min = centroids.min[bestAxis];
+        float scale = bins.count / (centroids.max[bestAxis] - min);
+        std::partition(primitives + first, primitives + first + count,
+                       [&](const Primitive &primitive) {
+                           return BinIndex(primitive.Centroid(bestAxis), min,
+                                           scale, bins.count) <= bestBin;
+                       });
+        return children[0].count;
+    }
+
+    // Splits in the middle of the primitive list, for primitives that
+    // cannot be told apart.
+    uint32_t SplitMiddle(uint32_t first, uint32_t count, Bounds children[2]) {
+        uint32_t leftCount = count / 2;
+        children[0] = Measure(first, leftCount, nullptr);
+        children[1] = Measure(first + leftCount, count - leftCount, nullptr);
+        return leftCount;
+    }
+};
+
+// Copies the subtree under buildIndex into out in depth first order.
+void Flatten(const BvhNode *built, uint32_t buildIndex,
+             std::vector<BvhNode> &out) {
+    size_t index = out.size();
+    out.push_back(built[buildIndex]);
+    if (built[buildIndex].count > 0) {
+        return;
+    }
+
+    uint32_t left = built[buildIndex].offset;
+    Flatten(built, left, out);
+    Flatten(built, left + 1, out);
+    out[index].offset = (uint32_t)out.size();
+}
+
+// Index of the first node after the subtree rooted at index.
+inline uint32_t SubtreeEnd(const BvhNode &node, uint32_t index) {
+    return node.count > 0 ? index + 1 : node.offset;
+}
+
+// Distance along the ray to the box, or INF if it misses within
+// maxDistance.
+inline float IntersectRay(const float min[3], const float max[3],
+                          const float origin[3], const float inverse[3],
+                          float maxDistance) {
+    float enter = 0.0f, exit = maxDistance;
+    for (int axis = 0; axis < 3; axis++) {
+        float t1 = (min[axis] - origin[axis]) * inverse[axis];
+        float t2 = (max[axis] - origin[axis]) * inverse[axis];
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+    return enter <= exit ? enter : INF;
+}
+
+enum Containment { Outside, Intersecting, Inside };
+
+inline Containment Classify(const Frustum &frustum, const float min[3],
+                            const float max[3]) {
+    Containment result = Inside;
+    for (const float *plane : frustum.planes) {
+        // The corners furthest along and against the plane normal.
+        float furthest = plane[3], nearest = plane[3];
+        for (int axis = 0; axis < 3; axis++) {
+            bool positive = plane[axis] > 0.0f;
+            furthest += plane[axis] * (positive ? max[axis] : min[axis]);
+            nearest += plane[axis] * (positive ? min[axis] : max[axis]);
+        }
+        if (furthest < 0.0f) {
+            return Outside;
+        }
+        if (nearest < 0.0f) {
+            result = Intersecting;
+        }
+    }
+    return result;
+}
+
+inline bool Overlaps(const Aabb &box, const float min[3], const float max[3]) {
+    return box.min[0] <= max[0] && box.max[0] >= min[0] &&
+           box.min[1] <= max[1] && box.max[1] >= min[1] &&
+           box.min[2] <= max[2] && box.max[2] >= min[2];
+}
+
+} // namespace
+
+Aabb Aabb::Empty() { return {{INF, INF, INF}, {-INF, -INF, -INF}}; }
+
+void Aabb::Grow(const float point[3]) {
+    for (int axis = 0; axis < 3; axis++) {
+        min[axis] = std::min(min[axis], point[axis]);
+        max[axis] = std::max(max[axis], point[axis]);
+    }
+}
+
+void Aabb::Grow(const Aabb &box) {
+    for (int axis = 0; axis < 3; axis++) {
+        min[axis] = std::min(min[axis], box.min[axis]);
+        max[axis] = std::max(max[axis], box.max[axis]);
+    }
+}
+
+float Aabb::SurfaceArea() const {
+    float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+    if (x < 0.0f || y < 0.0f || z < 0.0f) {
+        return 0.0f;
+    }
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+unsigned int Bvh::Add(const float min[3], const float max[3]) {
+    uint32_t index = (uint32_t)boxes.size();
+    boxes.push_back(Aabb());
+    objects.push_back(index);
+    slots.push_back(index);
+    Set(index, min, max);
+    return index;
+}
+
+void Bvh::Set(unsigned int index, const float min[3], const float max[3]) {
+    Aabb &box = boxes[slots[index]];
+    std::copy(min, min + 3, box.min);
+    std::copy(max, max + 3, box.max);
+}
+
+void Bvh::Clear() {
+    boxes.clear();
+    objects.clear();
+    slots.clear();
+    nodes.clear();
+}
+
+size_t Bvh::Count() const { return boxes.size(); }
+
+void Bvh::Build(JobSystem *jobs) {
+    nodes.clear();
+    uint32_t count = (uint32_t)boxes.size();
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<Primitive> primitives(count);
+    for (uint32_t i = 0; i < count; i++) {
+        primitives[i].box = boxes[i];
+        primitives[i].object = objects[i];
+    }
+
+    // A binary tree with one primitive per leaf has 2n - 1 nodes. Left
+    // uninitialised so untouched pages are never committed.
+    std::unique_ptr<BvhNode[]> built(new BvhNode[2 * (size_t)count]);
+    Builder builder;
+    builder.primitives = primitives.data();
+    builder.nodes = built.get();
+    builder.nodeCount = 1;
+
+    Bounds rootBounds = builder.Measure(0, count, jobs);
+    std::copy(rootBounds.boxes.min, rootBounds.boxes.min + 3, built[0].min);
+    std::copy(rootBounds.boxes.max, rootBounds.boxes.max + 3, built[0].max);
+    built[0].offset = 0;
+    built[0].count = count;
+    Task root = {0, rootBounds.centroids};
+
+    if (jobs != nullptr) {
+        std::vector<Task> subtrees;
+        builder.BuildSubtree(root, jobs, &subtrees);
+        jobs->ParallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                builder.BuildSubtree(subtrees[i], nullptr, nullptr);
+            }
+        });
+    } else {
+        builder.BuildSubtree(root, nullptr, nullptr);
+    }
+
+    nodes.reserve(builder.nodeCount.load());
+    Flatten(built.get(), 0, nodes);
+
+    // Store the boxes in leaf order so traversal and refits read them
+    // sequentially.
+    for (uint32_t i = 0; i < count; i++) {
+        boxes[i] = primitives[i].box;
+        objects[i] = primitives[i].object;
+        slots[objects[i]] = i;
+    }
+}
+
+void Bvh::Refit() {
+    // Children always follow their parent, so a reverse sweep sees both
+    // children of a node before the node itself.
+    for (size_t i = nodes.size(); i-- > 0;) {
+        BvhNode &node = nodes[i];
+        Aabb bounds = Aabb::Empty();
+        if (node.count > 0) {
+            for (uint32_t j = node.offset; j < node.offset + node.count; j++) {
+                bounds.Grow(boxes[j]);
+            }
+        } else {
+            uint32_t left = (uint32_t)i + 1;
+            uint32_t right = SubtreeEnd(nodes[left], left);
+            for (uint32_t child : {left, right}) {
+                bounds.Grow(nodes[child].min);
+                bounds.Grow(nodes[child].max);
+            }
+        }
+        std::copy(bounds.min, bounds.min + 3, node.min);
+        std::copy(bounds.max, bounds.max + 3, node.max);
+    }
+}
+
+void Bvh::Query(const Frustum &frustum, std::vector<unsigned int> &out) const {
+    uint32_t nodeCount = (uint32_t)nodes.size();
+    uint32_t i = 0;
+    while (i < nodeCount) {
+        const BvhNode &node = nodes[i];
+        uint32_t end = SubtreeEnd(node, i);
+        Containment containment = Classify(frustum, node.min, node.max);
+
+        if (containment == Inside) {
+            // Take every primitive of the subtree without further tests.
+            for (uint32_t j = i; j < end; j++) {
+                const BvhNode &leaf = nodes[j];
+                out.insert(out.end(), objects.begin() + leaf.offset,
+                           objects.begin() + leaf.offset + leaf.count);
+            }
+            i = end;
+        } else if (containment == Intersecting && node.count > 0) {
+            for (uint32_t j = node.offset; j < node.offset + node.count; j++) {
+                const Aabb &box = boxes[j];
+                if (Classify(frustum, box.min, box.max) != Outside) {
+                    out.push_back(objects[j]);
+                }
+            }
+            i = end;
+        } else if (containment == Intersecting) {
+            i++;
+        } else {
+            i = end;
+        }
+    }
+}
+
+void Bvh::Query(const Aabb &box, std::vector<unsigned int> &out) const {
+    uint32_t nodeCount = (uint32_t)nodes.size();
+    uint32_t i = 0;
+    while (i < nodeCount) {
+        const BvhNode &node = nodes[i];
+        if (!Overlaps(box, node.min, node.max)) {
+            i = SubtreeEnd(node, i);
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t j = node.offset; j < node.offset + node.count; j++) {
+                const Aabb &primitive = boxes[j];
+                if (Overlaps(box, primitive.min, primitive.max)) {
+                    out.push_back(objects[j]);
+                }
+            }
+        }
+        i++;
+    }
+}
+
+bool Bvh::Raycast(const float origin[3], const float direction[3],
+                  float maxDistance, unsigned int &hitIndex,
+                  float &hitDistance) const {
+    float inverse[3];
+    for (int axis = 0; axis < 3; axis++) {
+        inverse[axis] = 1.0f / direction[axis];
+    }
+
+    bool hit = false;
+    float closest = maxDistance;
+    uint32_t nodeCount = (uint32_t)nodes.size();
+    uint32_t i = 0;
+    while (i < nodeCount) {
+        const BvhNode &node = nodes[i];
+        if (IntersectRay(node.min, node.max, origin, inverse, closest) ==
+            INF) {
+            i = SubtreeEnd(node, i);
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t j = node.offset; j < node.offset + node.count; j++) {
+                const Aabb &box = boxes[j];
+                float distance =
+                    IntersectRay(box.min, box.max, origin, inverse, closest);
+                if (distance != INF && (!hit || distance < closest)) {
+                    closest = distance;
+                    hitIndex = objects[j];
+                    hit = true;
+                }
+            }
+        }
+        i++;
+    }
+
+    hitDistance = closest;
+    return hit;
+}
+
+size_t Bvh::NodeCount() const { return nodes.size(); }
+
+size_t Bvh::MemoryUsage() const {
+    return nodes.size() * sizeof(BvhNode) + boxes.size() * sizeof(Aabb) +
+           (objects.size() + slots.size()) * sizeof(uint32_t);
+}
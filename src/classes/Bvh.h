@@ -0,0 +1,92 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Axis aligned bounding box.
+struct Aabb {
+    float min[3];
+    float max[3];
+
+    // An inverted box that any Grow call replaces.
+    static Aabb Empty();
+
+    void Grow(const float point[3]);
+    void Grow(const Aabb &box);
+    float SurfaceArea() const;
+};
+
+// One node of a Bvh, 32 bytes and 32 byte aligned so a node never straddles
+// a cache line.
+//
+// Nodes are stored in depth first order, so the left child of an interior
+// node is the next node. For interior nodes (count 0) offset is the index of
+// the first node after the subtree, which is where traversal continues when
+// the node is missed. For leaves offset is the position of their first
+// object in leaf order and count the number of objects.
+struct alignas(32) BvhNode {
+    float min[3];
+    uint32_t offset;
+    float max[3];
+    uint32_t count;
+};
+
+// Bounding volume hierarchy over object bounds, for culling, picking and
+// ray queries.
+//
+// Built top down with the surface area heuristic evaluated on binned
+// centroids. Large nodes are binned in parallel, and the subtrees below
+// them are then built as independent jobs. Traversal is stackless: it walks
+// the depth first node array and follows the skip offsets on a miss.
+class Bvh {
+  public:
+    // Adds an object with the given bounds, returns its index. Call Build
+    // afterwards.
+    unsigned int Add(const float min[3], const float max[3]);
+
+    // Replaces the bounds of an object. Call Refit or Build afterwards.
+    void Set(unsigned int index, const float min[3], const float max[3]);
+
+    // Removes every object and node.
+    void Clear();
+
+    // Number of objects.
+    size_t Count() const;
+
+    // Rebuilds the hierarchy from scratch. Runs on jobs if given.
+    void Build(JobSystem *jobs = nullptr);
+
+    // Updates the node bounds after objects moved, keeping the topology.
+    // Much cheaper than Build, but the tree degrades if objects move far.
+    void Refit();
+
+    // Appends the index of every object intersecting the frustum to out.
+    void Query(const Frustum &frustum, std::vector<unsigned int> &out) const;
+
+    // Appends the index of every object overlapping the box to out.
+    void Query(const Aabb &box, std::vector<unsigned int> &out) const;
+
+    // Finds the nearest object whose bounds the ray hits within
+    // maxDistance. Returns false if there is none.
+    bool Raycast(const float origin[3], const float direction[3],
+                 float maxDistance, unsigned int &hitIndex,
+                 float &hitDistance) const;
+
+    // Number of nodes and total bytes used by nodes, bounds and index maps.
+    size_t NodeCount() const;
+    size_t MemoryUsage() const;
+
+  private:
+    // Object bounds, stored in leaf order after a Build. objects maps a
+    // position in boxes to the object index, slots the other way round.
+    std::vector<Aabb> boxes;
+    std::vector<uint32_t> objects;
+    std::vector<uint32_t> slots;
+    std::vector<BvhNode> nodes;
+};
+
+#endif
@@ -1,14 +1,28 @@
 #include "ElementBufferObject.h"
+#include "Trace.h"
 
 ElementBufferObject::ElementBufferObject(unsigned int *indices,
                                          GLsizeiptr size) {
-    glGenBuffers(1, &ID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+    TRACE_SCOPE("ElementBufferObject::ElementBufferObject");
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID());
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 }
 
-void ElementBufferObject::Bind() { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID); }
+ElementBufferObject::ElementBufferObject(const void *indices,
+                                         GLsizeiptr size) {
+    TRACE_SCOPE("ElementBufferObject::ElementBufferObject");
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
+}
+
+void ElementBufferObject::Bind() {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID());
+}
 
 void ElementBufferObject::Unbind() { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); }
 
-void ElementBufferObject::Delete() { glDeleteBuffers(1, &ID); }
+void ElementBufferObject::Delete() { buffer.Reset(); }
+
+GLuint ElementBufferObject::ID() const { return buffer.Name(); }
@@ -1,16 +1,20 @@
 #ifndef ELEMENT_BUFFER_OBJECT_H
 #define ELEMENT_BUFFER_OBJECT_H
 
+#include "GLHandlePool.h"
 #include "../glad/glad.h"
 
 class ElementBufferObject {
   public:
-    // ID reference of the Elements Buffer Object.
-    unsigned int ID;
+    // Name of the EBO, 0 once deleted.
+    GLuint ID() const;
 
     // Constructor that generates EBO and links it to indices.
     ElementBufferObject(unsigned int *indices, GLsizeiptr size);
 
+    // Constructor that uploads size bytes of indices of any type.
+    ElementBufferObject(const void *indices, GLsizeiptr size);
+
     // Binds the EBO.
     void Bind();
 
@@ -19,6 +23,9 @@ class ElementBufferObject {
 
     // Deletes the EBO.
     void Delete();
+
+  private:
+    GLBuffer buffer;
 };
 
 #endif
@@ -0,0 +1,109 @@
+#include "FixedTimestep.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+FixedTimestep::FixedTimestep(double stepSeconds, StepFunction step)
+    : stepSeconds(stepSeconds), stepFunction(step), origin(0.0) {}
+
+FixedTimestep::~FixedTimestep() { Stop(); }
+
+unsigned int FixedTimestep::Advance(double now) {
+    if (!started) {
+        origin = now;
+        started = true;
+    }
+
+    double due = std::floor((now - origin) / stepSeconds) - (double)steps;
+    if (due <= 0.0) {
+        return 0;
+    }
+    unsigned int count = MAX_CATCH_UP_STEPS;
+    if (due > MAX_CATCH_UP_STEPS) {
+        // Too far behind to catch up: let simulated time slip.
+        unsigned long long dropped =
+            (unsigned long long)due - MAX_CATCH_UP_STEPS;
+        origin = origin + dropped * stepSeconds;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        droppedSteps += dropped;
+    } else {
+        count = (unsigned int)due;
+    }
+
+    TRACE_SCOPE("FixedTimestep::Advance");
+    for (unsigned int i = 0; i < count; i++) {
+        Clock::time_point start = Clock::now();
+        stepFunction(steps + 1, stepSeconds);
+        double elapsed = std::chrono::duration<double, std::milli>(
+                             Clock::now() - start)
+                             .count();
+        // Only the advancing thread writes steps; GetStats reads it.
+        std::lock_guard<std::mutex> lock(statsMutex);
+        steps++;
+        stepTotal += elapsed;
+        stepMax = std::max(stepMax, elapsed);
+    }
+    return count;
+}
+
+void FixedTimestep::Start() {
+    if (thread.joinable()) {
+        return;
+    }
+    stopping = false;
+    thread = std::thread(&FixedTimestep::ThreadLoop, this);
+}
+
+void FixedTimestep::Stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+bool FixedTimestep::Running() const { return thread.joinable(); }
+
+float FixedTimestep::Alpha(double now, unsigned long long step) const {
+    double alpha = (now - origin - step * stepSeconds) / stepSeconds;
+    return (float)std::min(std::max(alpha, 0.0), 1.0);
+}
+
+double FixedTimestep::StepSeconds() const { return stepSeconds; }
+
+double FixedTimestep::Origin() const { return origin; }
+
+FixedTimestep::Stats FixedTimestep::GetStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    Stats stats;
+    stats.steps = steps;
+    stats.droppedSteps = droppedSteps;
+    stats.stepMean = steps > 0 ? stepTotal / steps : 0.0;
+    stats.stepMax = stepMax;
+    return stats;
+}
+
+double FixedTimestep::Now() {
+    return std::chrono::duration<double>(Clock::now().time_since_epoch())
+        .count();
+}
+
+void FixedTimestep::ThreadLoop() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while (!stopping) {
+        lock.unlock();
+        Advance(Now());
+        lock.lock();
+
+        // Sleeps until the next step is due, or Stop.
+        double next = origin + (steps + 1) * stepSeconds;
+        Clock::time_point deadline(
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(next)));
+        wake.wait_until(lock, deadline, [this] { return stopping; });
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs a simulation in steps of a fixed length, independent of the frame
+// rate, so its cost per second stays flat however fast the display
+// refreshes and its results do not depend on frame times.
+//
+// Step n advances the state to time Origin() + n * StepSeconds(). Advance
+// runs the steps that are due on the calling thread; Start instead runs
+// them on a thread of their own, which sleeps until each step is due, so
+// simulation and rendering overlap on different cores. When steps fall
+// more than MAX_CATCH_UP_STEPS behind, the rest are dropped and simulated
+// time slips, rather than each slow step making the next batch longer.
+//
+// The step function publishes its results, usually to StateSnapshots, and
+// the renderer interpolates between the last two snapshots with Alpha,
+// drawing one step in the past so there is always a later state to blend
+// towards.
+class FixedTimestep {
+  public:
+    typedef std::chrono::steady_clock Clock;
+    // Called with the number of the step and its length in seconds.
+    typedef std::function<void(unsigned long long step, double stepSeconds)>
+        StepFunction;
+
+    // Steps run by one Advance, or one wake of the thread, at most.
+    static const unsigned int MAX_CATCH_UP_STEPS = 8;
+
+    struct Stats {
+        unsigned long long steps;
+        unsigned long long droppedSteps;
+        // Time spent in the step function, in milliseconds.
+        double stepMean;
+        double stepMax;
+    };
+
+    // Constructor for steps of stepSeconds. Time starts at the first
+    // Advance, or at Start.
+    FixedTimestep(double stepSeconds, StepFunction step);
+
+    // Stops the thread, if running.
+    ~FixedTimestep();
+
+    FixedTimestep(const FixedTimestep &) = delete;
+    FixedTimestep &operator=(const FixedTimestep &) = delete;
+
+    // Runs the steps due by now, in seconds, on the calling thread and
+    // returns how many ran. Not for use while the thread runs.
+    unsigned int Advance(double now);
+
+    // Runs the steps on a thread of their own, against Now().
+    void Start();
+
+    // Stops and joins the thread.
+    void Stop();
+
+    bool Running() const;
+
+    // How far time now lies from the state before step to the state after
+    // it, 0 to 1, rendering one step behind.
+    float Alpha(double now, unsigned long long step) const;
+
+    double StepSeconds() const;
+    // Time of step 0; moves forward by the dropped steps.
+    double Origin() const;
+    Stats GetStats() const;
+
+    // Seconds on the steady clock.
+    static double Now();
+
+  private:
+    double stepSeconds;
+    StepFunction stepFunction;
+    bool started = false;
+    std::atomic<double> origin;
+    unsigned long long steps = 0;
+
+    mutable std::mutex statsMutex;
+    unsigned long long droppedSteps = 0;
+    double stepTotal = 0.0;
+    double stepMax = 0.0;
+
+    std::thread thread;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void ThreadLoop();
+};
+
+// The last two states a simulation published, double buffered: Publish
+// overwrites the older copy and flips, so each step copies the state once
+// and a reader on another thread always sees a consistent pair.
+template <typename State> class StateSnapshots {
+  public:
+    // Constructor that starts both snapshots at initial, as step 0.
+    explicit StateSnapshots(const State &initial) : states{initial, initial} {}
+
+    // Publishes the state after the given step.
+    void Publish(const State &state, unsigned long long step) {
+        std::lock_guard<std::mutex> lock(mutex);
+        states[1 - latest] = state;
+        latest = 1 - latest;
+        latestStep = step;
+    }
+
+    // Copies the last two states and returns the step of the later one.
+    unsigned long long Read(State &previous, State &current) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        previous = states[1 - latest];
+        current = states[latest];
+        return latestStep;
+    }
+
+  private:
+    mutable std::mutex mutex;
+    State states[2];
+    int latest = 0;
+    unsigned long long latestStep = 0;
+};
+
+#endif
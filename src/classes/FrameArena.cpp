@@ -0,0 +1,100 @@
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+FrameArena::FrameArena(size_t bytesPerFrame, unsigned int framesInFlight)
+    : bytesPerFrame(bytesPerFrame),
+      framesInFlight(std::max(framesInFlight, 1u)),
+      memory(new unsigned char[bytesPerFrame * this->framesInFlight]),
+      overflow(this->framesInFlight) {}
+
+FrameArena::~FrameArena() {
+    for (unsigned int block = 0; block < framesInFlight; block++) {
+        FreeOverflow(block);
+    }
+}
+
+void FrameArena::BeginFrame() {
+    frame = (frame + 1) % framesInFlight;
+    head = 0;
+    FreeOverflow(frame);
+}
+
+void *FrameArena::Allocate(size_t size, size_t alignment) {
+    unsigned char *block = memory.get() + (size_t)frame * bytesPerFrame;
+    uintptr_t start = (uintptr_t)(block + head);
+    size_t padding = (alignment - start % alignment) % alignment;
+    if (padding + size <= bytesPerFrame - head) {
+        void *result = block + head + padding;
+        head += padding + size;
+        peak = std::max(peak, head);
+        return result;
+    }
+
+    // Does not fit: take it from the heap until the block is reused.
+    unsigned char *fallback = (unsigned char *)std::malloc(size + alignment);
+    if (fallback == nullptr) {
+        throw std::bad_alloc();
+    }
+    overflow[frame].push_back(fallback);
+    overflowAllocations++;
+    size_t fallbackPadding =
+        (alignment - (uintptr_t)fallback % alignment) % alignment;
+    return fallback + fallbackPadding;
+}
+
+size_t FrameArena::BytesPerFrame() const { return bytesPerFrame; }
+
+size_t FrameArena::Used() const { return head; }
+
+size_t FrameArena::PeakUsed() const { return peak; }
+
+size_t FrameArena::OverflowAllocations() const { return overflowAllocations; }
+
+void FrameArena::FreeOverflow(unsigned int block) {
+    for (void *fallback : overflow[block]) {
+        std::free(fallback);
+    }
+    overflow[block].clear();
+}
+
+ThreadFrameArenas::ThreadFrameArenas(unsigned int threadCount,
+                                     size_t bytesPerFrame,
+                                     unsigned int framesInFlight)
+    : owner(std::this_thread::get_id()) {
+    for (unsigned int i = 0; i < std::max(threadCount, 1u); i++) {
+        arenas.emplace_back(new FrameArena(bytesPerFrame, framesInFlight));
+    }
+}
+
+FrameArena &ThreadFrameArenas::Local() {
+    unsigned int index = JobSystem::ThreadIndex();
+    assert(index != 0 || std::this_thread::get_id() == owner);
+    return *arenas.at(index);
+}
+
+void ThreadFrameArenas::BeginFrame() {
+    for (std::unique_ptr<FrameArena> &arena : arenas) {
+        arena->BeginFrame();
+    }
+}
+
+size_t ThreadFrameArenas::PeakUsed() const {
+    size_t peak = 0;
+    for (const std::unique_ptr<FrameArena> &arena : arenas) {
+        peak = std::max(peak, arena->PeakUsed());
+    }
+    return peak;
+}
+
+size_t ThreadFrameArenas::OverflowAllocations() const {
+    size_t total = 0;
+    for (const std::unique_ptr<FrameArena> &arena : arenas) {
+        total += arena->OverflowAllocations();
+    }
+    return total;
+}
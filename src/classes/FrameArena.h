@@ -0,0 +1,135 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Linear allocator for data that lives for one frame: draw lists, uniform
+// staging, culling output.
+//
+// The arena owns framesInFlight blocks of bytesPerFrame bytes, used in
+// turn. Allocate bumps a pointer through the current block and nothing is
+// freed individually; BeginFrame moves to the next block and forgets what
+// it held framesInFlight frames ago, by which time the GPU frame that read
+// it has finished. Once the blocks are sized for the workload no frame
+// touches the heap. An allocation that does not fit falls back to the heap,
+// is freed when its block comes round again and is counted, so an
+// undersized arena shows up in OverflowAllocations.
+//
+// One arena serves one thread; ThreadFrameArenas gives each JobSystem
+// thread its own.
+class FrameArena {
+  public:
+    // Constructor that allocates the blocks up front.
+    FrameArena(size_t bytesPerFrame, unsigned int framesInFlight = 3);
+
+    // Frees the blocks and any heap fallbacks.
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // Moves to the next block, releasing everything allocated in it.
+    void BeginFrame();
+
+    // Returns size bytes aligned to alignment, a power of two, valid until
+    // the block is reused framesInFlight frames from now.
+    void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Returns uninitialised room for count objects of type T.
+    template <typename T> T *Allocate(size_t count) {
+        return (T *)Allocate(count * sizeof(T), alignof(T));
+    }
+
+    size_t BytesPerFrame() const;
+    // Bytes allocated this frame, and the most allocated in one frame.
+    size_t Used() const;
+    size_t PeakUsed() const;
+    // Allocations that did not fit and went to the heap, since
+    // construction.
+    size_t OverflowAllocations() const;
+
+  private:
+    size_t bytesPerFrame;
+    unsigned int framesInFlight;
+    std::unique_ptr<unsigned char[]> memory;
+    unsigned int frame = 0;
+    size_t head = 0;
+    size_t peak = 0;
+    // Heap fallbacks of each block, freed when it is reused.
+    std::vector<std::vector<void *>> overflow;
+    size_t overflowAllocations = 0;
+
+    void FreeOverflow(unsigned int block);
+};
+
+// One FrameArena per thread of a JobSystem, picked with
+// JobSystem::ThreadIndex(), so jobs allocate without locking.
+//
+// Arena 0 belongs to the thread that constructed the arenas: it is the
+// index of every thread that is not a worker, so Local() asserts that no
+// other such thread calls it. Workers of a second JobSystem would share
+// arenas with the first; give each JobSystem its own ThreadFrameArenas and
+// do not run them at the same time.
+class ThreadFrameArenas {
+  public:
+    // Constructor for threadCount arenas, at least the ThreadCount() of the
+    // JobSystem whose jobs use them.
+    ThreadFrameArenas(unsigned int threadCount, size_t bytesPerFrame,
+                      unsigned int framesInFlight = 3);
+
+    // The arena of the calling thread: a JobSystem worker or the
+    // constructing thread.
+    FrameArena &Local();
+
+    // Moves every arena to its next block. Call while no job is running.
+    void BeginFrame();
+
+    // Largest PeakUsed of any arena, and the total OverflowAllocations.
+    size_t PeakUsed() const;
+    size_t OverflowAllocations() const;
+
+  private:
+    std::vector<std::unique_ptr<FrameArena>> arenas;
+    std::thread::id owner;
+};
+
+// Standard allocator that takes memory from a FrameArena, so containers can
+// hold per-frame data. deallocate is a no-op: memory comes back when the
+// block is reused, so a growing container leaves its old storage behind.
+// Reserve what the frame needs up front.
+template <typename T> class FrameAllocator {
+  public:
+    typedef T value_type;
+
+    FrameAllocator(FrameArena &arena) : arena(&arena) {}
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t count) { return arena->Allocate<T>(count); }
+
+    void deallocate(T *, size_t) {}
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U> &other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const FrameAllocator<U> &other) const {
+        return arena != other.arena;
+    }
+
+  private:
+    template <typename U> friend class FrameAllocator;
+
+    FrameArena *arena;
+};
+
+// Vector whose storage lives in a FrameArena.
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,87 @@
+#include "FrameBufferObject.h"
+#include <cstddef>
+#include <fstream>
+
+FrameBufferObject::FrameBufferObject(int width, int height)
+    : width(width), height(height) {
+    framebuffer = GLFramebuffer::Create();
+    glBindFramebuffer(GL_FRAMEBUFFER, ID());
+
+    // Colour attachment.
+    colourTexture = GLTexture::Create();
+    glBindTexture(GL_TEXTURE_2D, ColourTexture());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           ColourTexture(), 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Depth/stencil attachment.
+    depthStencil = GLRenderbuffer::Create();
+    glBindRenderbuffer(GL_RENDERBUFFER, DepthStencil());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, DepthStencil());
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool FrameBufferObject::IsComplete() {
+    glBindFramebuffer(GL_FRAMEBUFFER, ID());
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void FrameBufferObject::Bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, ID());
+    glViewport(0, 0, width, height);
+}
+
+void FrameBufferObject::Unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+std::vector<unsigned char> FrameBufferObject::ReadPixels() {
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, ID());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    return pixels;
+}
+
+bool FrameBufferObject::SavePPM(const char *path) {
+    std::vector<unsigned char> pixels = ReadPixels();
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    // OpenGL rows start at the bottom, PPM rows start at the top.
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char *row = pixels.data() + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            file.write((const char *)row + x * 4, 3);
+        }
+    }
+
+    return (bool)file;
+}
+
+void FrameBufferObject::Delete() {
+    colourTexture.Reset();
+    depthStencil.Reset();
+    framebuffer.Reset();
+}
+
+GLuint FrameBufferObject::ID() const { return framebuffer.Name(); }
+
+GLuint FrameBufferObject::ColourTexture() const {
+    return colourTexture.Name();
+}
+
+GLuint FrameBufferObject::DepthStencil() const { return depthStencil.Name(); }
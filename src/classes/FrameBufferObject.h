@@ -0,0 +1,49 @@
+#ifndef FRAME_BUFFER_OBJECT_H
+#define FRAME_BUFFER_OBJECT_H
+
+#include "GLHandlePool.h"
+#include "../glad/glad.h"
+#include <vector>
+
+class FrameBufferObject {
+  public:
+    // Name of the Frame Buffer Object, 0 once deleted.
+    GLuint ID() const;
+
+    // Colour texture the FBO renders into.
+    GLuint ColourTexture() const;
+
+    // Depth/stencil renderbuffer attached to the FBO.
+    GLuint DepthStencil() const;
+
+    int width;
+    int height;
+
+    // Constructor that generates an RGBA8 + depth/stencil FBO.
+    FrameBufferObject(int width, int height);
+
+    // Whether the FBO is complete and can be rendered into.
+    bool IsComplete();
+
+    // Binds the FBO and sets the viewport to cover it.
+    void Bind();
+
+    // Unbinds the FBO, going back to the default framebuffer.
+    void Unbind();
+
+    // Reads the colour attachment back as tightly packed RGBA8 rows.
+    std::vector<unsigned char> ReadPixels();
+
+    // Writes the colour attachment to a binary PPM image.
+    bool SavePPM(const char *path);
+
+    // Deletes the FBO and its attachments.
+    void Delete();
+
+  private:
+    GLFramebuffer framebuffer;
+    GLTexture colourTexture;
+    GLRenderbuffer depthStencil;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "FramePacer.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+// Slack left between the predicted end of the frame's work and its
+// deadline: a fixed part for the swap itself and a share of the work for
+// frames slower than predicted.
+const double PREDICTION_MARGIN = 0.5;
+const double PREDICTION_MARGIN_SHARE = 0.1;
+
+// Share of a faster frame that the prediction moves towards, and of a
+// shorter sleep overshoot that the spin time does.
+const double PREDICTION_DECAY = 0.05;
+const double OVERSLEEP_DECAY = 0.05;
+
+typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+FramePacer::Clock::duration ToDuration(double milliseconds) {
+    return std::chrono::duration_cast<FramePacer::Clock::duration>(
+        Milliseconds(milliseconds));
+}
+
+double Since(FramePacer::Clock::time_point start,
+             FramePacer::Clock::time_point end) {
+    return Milliseconds(end - start).count();
+}
+
+// Mean and 99th percentile of the first count samples.
+void Summarise(const std::vector<double> &ring, size_t count, double &mean,
+               double &p99) {
+    mean = 0.0;
+    p99 = 0.0;
+    if (count == 0) {
+        return;
+    }
+    std::vector<double> sorted(ring.begin(), ring.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+    for (double sample : sorted) {
+        mean += sample;
+    }
+    mean /= count;
+    p99 = sorted[std::min(count - 1, (size_t)(count * 0.99))];
+}
+
+} // namespace
+
+FramePacer::FramePacer(const Settings &settings)
+    : settings(settings),
+      fences(std::max(settings.maxFramesInFlight, 1u), nullptr),
+      frameTimes(STAT_FRAMES), latencies(STAT_FRAMES), waits(STAT_FRAMES) {}
+
+int FramePacer::SwapInterval(bool tearSupported) const {
+    switch (settings.vsync) {
+    case VSYNC_OFF:
+        return 0;
+    case VSYNC_ADAPTIVE:
+        return tearSupported ? -1 : 1;
+    default:
+        return 1;
+    }
+}
+
+void FramePacer::BeginFrame() {
+    TRACE_SCOPE("FramePacer::BeginFrame");
+    Clock::time_point start = Clock::now();
+
+    // Only blocks if the GPU is maxFramesInFlight frames behind.
+    if (fences[frame]) {
+        glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GL_TIMEOUT_IGNORED);
+        glDeleteSync(fences[frame]);
+        fences[frame] = nullptr;
+    }
+
+    double period = FramePeriod();
+    if (presented && period > 0.0) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point present;
+        if (settings.targetFps > 0.0) {
+            // Presents stay on a fixed grid; a frame that fell more than a
+            // period behind restarts it.
+            present = presentTarget + ToDuration(period);
+            if (present + ToDuration(period) < now) {
+                present = now;
+            }
+            presentTarget = present;
+        } else {
+            // The swap returned at the last vblank; the next is a refresh
+            // later.
+            present = lastPresent + ToDuration(period);
+        }
+
+        if (settings.predictInput) {
+            double lead = predictedWork * (1.0 + PREDICTION_MARGIN_SHARE) +
+                          PREDICTION_MARGIN;
+            WaitUntil(present - ToDuration(lead));
+        } else if (settings.targetFps > 0.0) {
+            WaitUntil(present);
+        }
+    }
+    waited = Since(start, Clock::now());
+}
+
+void FramePacer::InputSampled() { inputTime = Clock::now(); }
+
+void FramePacer::EndFrame() {
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame = (frame + 1) % fences.size();
+
+    double work = Since(inputTime, Clock::now());
+    if (work > predictedWork) {
+        predictedWork = work;
+    } else {
+        predictedWork += (work - predictedWork) * PREDICTION_DECAY;
+    }
+}
+
+void FramePacer::Presented() {
+    Clock::time_point now = Clock::now();
+    if (presented) {
+        size_t slot = samples % STAT_FRAMES;
+        frameTimes[slot] = Since(lastPresent, now);
+        latencies[slot] = Since(inputTime, now);
+        waits[slot] = waited;
+        samples++;
+    } else {
+        presentTarget = now;
+    }
+    lastPresent = now;
+    presented = true;
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+    Stats stats = {};
+    size_t count = std::min(samples, STAT_FRAMES);
+    stats.frames = count;
+    Summarise(frameTimes, count, stats.frameMean, stats.frameP99);
+    Summarise(latencies, count, stats.latencyMean, stats.latencyP99);
+    double waitP99;
+    Summarise(waits, count, stats.waitMean, waitP99);
+
+    double variance = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double deviation = frameTimes[i] - stats.frameMean;
+        variance += deviation * deviation;
+    }
+    stats.frameJitter = count > 0 ? std::sqrt(variance / count) : 0.0;
+    return stats;
+}
+
+void FramePacer::Delete() {
+    for (GLsync &fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+}
+
+void FramePacer::WaitUntil(Clock::time_point deadline) {
+    Clock::time_point now = Clock::now();
+    if (deadline <= now) {
+        return;
+    }
+
+    // Sleep to within the expected overshoot, then spin.
+    double spin = std::max(settings.spinMilliseconds, oversleep * 1.5);
+    Clock::time_point wake = deadline - ToDuration(spin);
+    if (wake > now) {
+        std::this_thread::sleep_until(wake);
+        double overshoot = Since(wake, Clock::now());
+        oversleep = overshoot > oversleep
+                        ? overshoot
+                        : oversleep + (overshoot - oversleep) * OVERSLEEP_DECAY;
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+double FramePacer::FramePeriod() const {
+    if (settings.targetFps > 0.0) {
+        return 1000.0 / settings.targetFps;
+    }
+    if (settings.vsync != VSYNC_OFF && settings.refreshRate > 0.0) {
+        return 1000.0 / settings.refreshRate;
+    }
+    return 0.0;
+}
@@ -0,0 +1,122 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "../glad/glad.h"
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// Vsync behaviour asked of the swap chain.
+enum VsyncMode {
+    VSYNC_OFF,
+    VSYNC_ON,
+    // Waits for vblank when the frame is on time and tears instead of
+    // waiting a whole refresh when it is late (swap_control_tear).
+    VSYNC_ADAPTIVE
+};
+
+// Decides when each frame of the render loop starts, to keep frame times
+// even and input latency low. Usage per frame:
+//   BeginFrame() -> sample input -> InputSampled() -> update and draw
+//   -> EndFrame() -> swap -> Presented().
+//
+// BeginFrame first waits on a fence until fewer than maxFramesInFlight
+// frames are queued on the GPU, so the CPU cannot run ahead and pile up
+// latency. It then holds the frame back: to the FPS cap when there is one,
+// and with predictive input sampling until the last moment at which the
+// frame, at its recently measured cost, still makes the next refresh or
+// cap deadline. The wait sleeps most of the way and spins the rest, as
+// sleeps overshoot by up to a scheduler tick.
+//
+// Reports frame time jitter (standard deviation of present-to-present
+// times) and input-to-present latency (from InputSampled to the return of
+// the swap) over the last STAT_FRAMES frames.
+class FramePacer {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Frames kept for the statistics.
+    static constexpr size_t STAT_FRAMES = 512;
+
+    struct Settings {
+        VsyncMode vsync = VSYNC_ADAPTIVE;
+        // Frame rate cap, or 0 for none.
+        double targetFps = 0.0;
+        // Refresh rate of the display, or 0 if unknown; paces predictive
+        // input sampling when there is no cap.
+        double refreshRate = 0.0;
+        unsigned int maxFramesInFlight = 2;
+        // Sample input as late as the predicted frame cost allows.
+        bool predictInput = true;
+        // Time before a deadline that is spun rather than slept, at least.
+        double spinMilliseconds = 1.0;
+    };
+
+    struct Stats {
+        size_t frames;
+        double frameMean;
+        double frameJitter;
+        double frameP99;
+        double latencyMean;
+        double latencyP99;
+        // Time spent waiting in BeginFrame, per frame.
+        double waitMean;
+    };
+
+    explicit FramePacer(const Settings &settings);
+
+    FramePacer(const FramePacer &) = delete;
+    FramePacer &operator=(const FramePacer &) = delete;
+
+    // Swap interval to set on the context: -1 for adaptive vsync when the
+    // context supports swap_control_tear, falling back to 1, else 1 or 0.
+    int SwapInterval(bool tearSupported) const;
+
+    // Waits until the next frame may start.
+    void BeginFrame();
+
+    // Marks the moment input was sampled.
+    void InputSampled();
+
+    // Fences the frame's commands. Call after the last draw, before the
+    // swap.
+    void EndFrame();
+
+    // Marks the return of the swap; headless loops call it after EndFrame.
+    void Presented();
+
+    Stats GetStats() const;
+
+    // Deletes the pending fences.
+    void Delete();
+
+  private:
+    Settings settings;
+    std::vector<GLsync> fences;
+    unsigned int frame = 0;
+
+    Clock::time_point inputTime;
+    Clock::time_point lastPresent;
+    // Present time the FPS cap aims the current frame at.
+    Clock::time_point presentTarget;
+    bool presented = false;
+    // Predicted time from input sampling to EndFrame, in milliseconds.
+    // Rises at once on a slow frame and decays slowly.
+    double predictedWork = 0.0;
+    // Recent overshoot of sleeps, in milliseconds.
+    double oversleep = 0.0;
+    double waited = 0.0;
+
+    // Ring buffers of the last STAT_FRAMES samples, in milliseconds.
+    std::vector<double> frameTimes;
+    std::vector<double> latencies;
+    std::vector<double> waits;
+    size_t samples = 0;
+
+    // Sleeps, then spins, until deadline.
+    void WaitUntil(Clock::time_point deadline);
+    // Time between frames the pacer aims for, or 0.
+    double FramePeriod() const;
+};
+
+#endif
@@ -0,0 +1,319 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_X86 1
+#endif
+
+#if defined(FRUSTUM_CULLER_X86) && (defined(__GNUC__) || defined(__clang__))
+// The AVX2 kernel is compiled with a target attribute and picked at run
+// time, so the rest of the build does not need -mavx2.
+#define FRUSTUM_CULLER_AVX2 1
+#endif
+
+namespace {
+
+// Pointers into the structure of arrays, offset to the range being culled.
+struct Bounds {
+    const float *minX, *minY, *minZ;
+    const float *maxX, *maxY, *maxZ;
+    const float *centerX, *centerY, *centerZ, *radius;
+};
+
+// Writes the index of every visible object in [begin, end) to out and
+// returns how many were written.
+typedef size_t (*Kernel)(const Bounds &bounds, const Frustum &frustum,
+                         size_t begin, size_t end, unsigned int *out);
+
+bool SphereVisible(const Bounds &b, const Frustum &f, size_t i) {
+    for (const float *plane : f.planes) {
+        float distance = plane[0] * b.centerX[i] + plane[1] * b.centerY[i] +
+                         plane[2] * b.centerZ[i] + plane[3];
+        if (distance < -b.radius[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BoxVisible(const Bounds &b, const Frustum &f, size_t i) {
+    for (const float *plane : f.planes) {
+        // The corner furthest along the plane normal.
+        float x = plane[0] > 0.0f ? b.maxX[i] : b.minX[i];
+        float y = plane[1] > 0.0f ? b.maxY[i] : b.minY[i];
+        float z = plane[2] > 0.0f ? b.maxZ[i] : b.minZ[i];
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CullScalar(const Bounds &bounds, const Frustum &frustum, size_t begin,
+                  size_t end, unsigned int *out) {
+    size_t written = 0;
+    for (size_t i = begin; i < end; i++) {
+        if (SphereVisible(bounds, frustum, i) &&
+            BoxVisible(bounds, frustum, i)) {
+            out[written++] = (unsigned int)i;
+        }
+    }
+    return written;
+}
+
+// Appends the set bits of mask as indices starting at base.
+inline size_t Compact(unsigned int mask, size_t base, unsigned int *out) {
+    size_t written = 0;
+    while (mask != 0) {
+#if defined(__GNUC__) || defined(__clang__)
+        unsigned int lane = __builtin_ctz(mask);
+#else
+        unsigned int lane = 0;
+        while (!(mask & (1u << lane))) {
+            lane++;
+        }
+#endif
+        out[written++] = (unsigned int)(base + lane);
+        mask &= mask - 1;
+    }
+    return written;
+}
+
+#ifdef FRUSTUM_CULLER_X86
+
+// Visible lanes of 4 objects starting at i, as a 4 bit mask.
+inline unsigned int CullGroupSSE(const Bounds &b, const Frustum &f, size_t i) {
+    __m128 cx = _mm_loadu_ps(b.centerX + i);
+    __m128 cy = _mm_loadu_ps(b.centerY + i);
+    __m128 cz = _mm_loadu_ps(b.centerZ + i);
+    __m128 negativeRadius =
+        _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(b.radius + i));
+
+    __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (const float *plane : f.planes) {
+        __m128 distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), cx),
+                       _mm_mul_ps(_mm_set1_ps(plane[1]), cy)),
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), cz),
+                       _mm_set1_ps(plane[3])));
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+    }
+    if (_mm_movemask_ps(visible) == 0) {
+        return 0;
+    }
+
+    for (const float *plane : f.planes) {
+        // The normal is the same for every lane, so the corner choice is too.
+        __m128 x = _mm_loadu_ps((plane[0] > 0.0f ? b.maxX : b.minX) + i);
+        __m128 y = _mm_loadu_ps((plane[1] > 0.0f ? b.maxY : b.minY) + i);
+        __m128 z = _mm_loadu_ps((plane[2] > 0.0f ? b.maxZ : b.minZ) + i);
+        __m128 distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), x),
+                       _mm_mul_ps(_mm_set1_ps(plane[1]), y)),
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), z),
+                       _mm_set1_ps(plane[3])));
+        visible =
+            _mm_and_ps(visible, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+    }
+    return (unsigned int)_mm_movemask_ps(visible);
+}
+
+size_t CullSSE(const Bounds &bounds, const Frustum &frustum, size_t begin,
+               size_t end, unsigned int *out) {
+    size_t written = 0;
+    size_t i = begin;
+    // Two groups of 4, 8 objects per iteration.
+    for (; i + 8 <= end; i += 8) {
+        unsigned int mask = CullGroupSSE(bounds, frustum, i) |
+                            CullGroupSSE(bounds, frustum, i + 4) << 4;
+        written += Compact(mask, i, out + written);
+    }
+    return written + CullScalar(bounds, frustum, i, end, out + written);
+}
+
+#endif
+
+#ifdef FRUSTUM_CULLER_AVX2
+
+__attribute__((target("avx2,fma"))) size_t
+CullAVX2(const Bounds &b, const Frustum &f, size_t begin, size_t end,
+         unsigned int *out) {
+    size_t written = 0;
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 cx = _mm256_loadu_ps(b.centerX + i);
+        __m256 cy = _mm256_loadu_ps(b.centerY + i);
+        __m256 cz = _mm256_loadu_ps(b.centerZ + i);
+        __m256 negativeRadius =
+            _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(b.radius + i));
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const float *plane : f.planes) {
+            __m256 distance = _mm256_fmadd_ps(
+                _mm256_set1_ps(plane[0]), cx,
+                _mm256_fmadd_ps(_mm256_set1_ps(plane[1]), cy,
+                                _mm256_fmadd_ps(_mm256_set1_ps(plane[2]), cz,
+                                                _mm256_set1_ps(plane[3]))));
+            visible = _mm256_and_ps(
+                visible, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+        if (_mm256_movemask_ps(visible) == 0) {
+            continue;
+        }
+
+        for (const float *plane : f.planes) {
+            __m256 x = _mm256_loadu_ps((plane[0] > 0.0f ? b.maxX : b.minX) + i);
+            __m256 y = _mm256_loadu_ps((plane[1] > 0.0f ? b.maxY : b.minY) + i);
+            __m256 z = _mm256_loadu_ps((plane[2] > 0.0f ? b.maxZ : b.minZ) + i);
+            __m256 distance = _mm256_fmadd_ps(
+                _mm256_set1_ps(plane[0]), x,
+                _mm256_fmadd_ps(_mm256_set1_ps(plane[1]), y,
+                                _mm256_fmadd_ps(_mm256_set1_ps(plane[2]), z,
+                                                _mm256_set1_ps(plane[3]))));
+            visible = _mm256_and_ps(
+                visible,
+                _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        written += Compact((unsigned int)_mm256_movemask_ps(visible), i,
+                           out + written);
+    }
+    return written + CullScalar(b, f, i, end, out + written);
+}
+
+#endif
+
+Kernel SelectKernel(const char **name) {
+#ifdef FRUSTUM_CULLER_AVX2
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        *name = "avx2";
+        return CullAVX2;
+    }
+#endif
+#ifdef FRUSTUM_CULLER_X86
+    *name = "sse";
+    return CullSSE;
+#else
+    *name = "scalar";
+    return CullScalar;
+#endif
+}
+
+const char *kernelName = "scalar";
+const Kernel kernel = SelectKernel(&kernelName);
+
+} // namespace
+
+Frustum Frustum::FromMatrix(const mat4 &viewProjection) {
+    // Gribb/Hartmann: each plane is the last row of the matrix plus or
+    // minus one of the other rows.
+    Frustum frustum;
+    for (int i = 0; i < 6; i++) {
+        float sign = i % 2 == 0 ? 1.0f : -1.0f;
+        vec4 plane =
+            viewProjection.Row(3) + viewProjection.Row(i / 2) * sign;
+
+        float planeLength = length(plane.xyz());
+        if (planeLength > 0.0f) {
+            plane = plane * (1.0f / planeLength);
+        }
+        frustum.planes[i][0] = plane.x;
+        frustum.planes[i][1] = plane.y;
+        frustum.planes[i][2] = plane.z;
+        frustum.planes[i][3] = plane.w;
+    }
+    return frustum;
+}
+
+unsigned int FrustumCuller::Add(const float min[3], const float max[3]) {
+    unsigned int index = (unsigned int)minX.size();
+    for (std::vector<float> *array :
+         {&minX, &minY, &minZ, &maxX, &maxY, &maxZ, &centerX, &centerY,
+          &centerZ, &radius}) {
+        array->push_back(0.0f);
+    }
+    Set(index, min, max);
+    return index;
+}
+
+void FrustumCuller::Set(unsigned int index, const float min[3],
+                        const float max[3]) {
+    minX[index] = min[0];
+    minY[index] = min[1];
+    minZ[index] = min[2];
+    maxX[index] = max[0];
+    maxY[index] = max[1];
+    maxZ[index] = max[2];
+
+    // The bounding sphere encloses the box.
+    float halfX = (max[0] - min[0]) * 0.5f;
+    float halfY = (max[1] - min[1]) * 0.5f;
+    float halfZ = (max[2] - min[2]) * 0.5f;
+    centerX[index] = min[0] + halfX;
+    centerY[index] = min[1] + halfY;
+    centerZ[index] = min[2] + halfZ;
+    radius[index] = std::sqrt(halfX * halfX + halfY * halfY + halfZ * halfZ);
+}
+
+void FrustumCuller::Clear() {
+    for (std::vector<float> *array :
+         {&minX, &minY, &minZ, &maxX, &maxY, &maxZ, &centerX, &centerY,
+          &centerZ, &radius}) {
+        array->clear();
+    }
+}
+
+size_t FrustumCuller::Count() const { return minX.size(); }
+
+void FrustumCuller::Cull(const Frustum &frustum,
+                         std::vector<unsigned int> &visible, JobSystem *jobs) {
+    const Bounds bounds = {minX.data(),    minY.data(),    minZ.data(),
+                           maxX.data(),    maxY.data(),    maxZ.data(),
+                           centerX.data(), centerY.data(), centerZ.data(),
+                           radius.data()};
+
+    size_t count = Count();
+    size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (chunkVisible.size() < chunks) {
+        chunkVisible.resize(chunks);
+    }
+
+    std::vector<size_t> chunkCounts(chunks);
+    auto cullChunks = [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; chunk++) {
+            size_t begin = chunk * CHUNK_SIZE;
+            size_t end = begin + CHUNK_SIZE < count ? begin + CHUNK_SIZE
+                                                    : count;
+            std::vector<unsigned int> &out = chunkVisible[chunk];
+            if (out.size() < CHUNK_SIZE) {
+                out.resize(CHUNK_SIZE);
+            }
+            chunkCounts[chunk] = kernel(bounds, frustum, begin, end, out.data());
+        }
+    };
+
+    if (jobs != nullptr) {
+        jobs->ParallelFor(chunks, 1, cullChunks);
+    } else {
+        cullChunks(0, chunks);
+    }
+
+    // Concatenate the chunks in order.
+    size_t total = 0;
+    for (size_t chunkCount : chunkCounts) {
+        total += chunkCount;
+    }
+    visible.resize(total);
+
+    size_t offset = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        std::copy(chunkVisible[chunk].begin(),
+                  chunkVisible[chunk].begin() + chunkCounts[chunk],
+                  visible.begin() + offset);
+        offset += chunkCounts[chunk];
+    }
+}
+
+const char *FrustumCuller::KernelName() { return kernelName; }
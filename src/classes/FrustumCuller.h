@@ -0,0 +1,58 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include "JobSystem.h"
+#include "VectorMath.h"
+#include <cstddef>
+#include <vector>
+
+// The six planes (a, b, c, d) of a view frustum with normals pointing
+// inwards: a point is inside a plane when a*x + b*y + c*z + d >= 0.
+struct Frustum {
+    float planes[6][4];
+
+    // Extracts the planes from an OpenGL view-projection matrix.
+    static Frustum FromMatrix(const mat4 &viewProjection);
+};
+
+// Culls object bounds against a frustum.
+//
+// Bounds are stored as structure of arrays (one array per component) so the
+// kernels can test 8 objects per iteration with AVX2, or two groups of 4
+// with SSE. Each group is first tested with its bounding spheres; only
+// groups with a surviving sphere load their boxes for the exact test.
+class FrustumCuller {
+  public:
+    // Objects per job when culling in parallel.
+    static const size_t CHUNK_SIZE = 16 * 1024;
+
+    // Adds an object with the given axis aligned bounds, returns its index.
+    unsigned int Add(const float min[3], const float max[3]);
+
+    // Replaces the bounds of an object.
+    void Set(unsigned int index, const float min[3], const float max[3]);
+
+    // Removes every object.
+    void Clear();
+
+    // Number of objects.
+    size_t Count() const;
+
+    // Fills visible with the indices, in increasing order, of every object
+    // whose bounds intersect the frustum. Runs on jobs if given.
+    void Cull(const Frustum &frustum, std::vector<unsigned int> &visible,
+              JobSystem *jobs = nullptr);
+
+    // Name of the kernel Cull uses on this CPU: "avx2", "sse" or "scalar".
+    static const char *KernelName();
+
+  private:
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+    std::vector<float> centerX, centerY, centerZ, radius;
+
+    // Per chunk results, reused between calls.
+    std::vector<std::vector<unsigned int>> chunkVisible;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "GLDebug.h"
+#include "Log.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace GLDebug {
+
+namespace {
+
+// Distinct message keys tracked for deduplication. Must be a power of two.
+const int TABLE_SIZE = 1024;
+
+// Repeats of one message logged per second after the first.
+const uint32_t REPEATS_PER_SECOND = 2;
+
+// Open addressing table, filled in with compare-exchange so the callback
+// never takes a lock.
+struct Entry {
+    std::atomic<uint64_t> key{0};
+    std::atomic<uint64_t> count{0};
+    std::atomic<int64_t> windowStart{0};
+    std::atomic<uint32_t> loggedInWindow{0};
+};
+
+Entry table[TABLE_SIZE];
+
+std::atomic<uint64_t> high{0}, medium{0}, low{0}, notification{0};
+std::atomic<uint64_t> performance{0}, suppressed{0};
+
+int64_t NowMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char *SourceName(GLenum source) {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API:
+        return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+        return "WINDOW_SYSTEM";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER:
+        return "SHADER_COMPILER";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:
+        return "THIRD_PARTY";
+    case GL_DEBUG_SOURCE_APPLICATION:
+        return "APPLICATION";
+    default:
+        return "OTHER";
+    }
+}
+
+const char *TypeName(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:
+        return "ERROR";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+        return "DEPRECATED_BEHAVIOR";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+        return "UNDEFINED_BEHAVIOR";
+    case GL_DEBUG_TYPE_PORTABILITY:
+        return "PORTABILITY";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+        return "PERFORMANCE";
+    case GL_DEBUG_TYPE_MARKER:
+        return "MARKER";
+    default:
+        return "OTHER";
+    }
+}
+
+// Finds or claims the table entry for key. Returns nullptr if the table is
+// full, in which case the message is logged without deduplication.
+Entry *Lookup(uint64_t key) {
+    uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+    for (int probe = 0; probe < TABLE_SIZE; probe++) {
+        Entry &entry = table[(hash + probe) & (TABLE_SIZE - 1)];
+        uint64_t existing = entry.key.load(std::memory_order_acquire);
+        if (existing == key) {
+            return &entry;
+        }
+        if (existing == 0 &&
+            entry.key.compare_exchange_strong(existing, key,
+                                              std::memory_order_acq_rel)) {
+            return &entry;
+        }
+        if (existing == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Decides whether this occurrence should be logged and how many repeats it
+// stands for.
+bool ShouldLog(Entry *entry, uint64_t &repeats) {
+    if (entry == nullptr) {
+        repeats = 0;
+        return true;
+    }
+
+    uint64_t count = entry->count.fetch_add(1, std::memory_order_relaxed) + 1;
+    repeats = count - 1;
+    if (count == 1) {
+        entry->windowStart.store(NowMilliseconds(), std::memory_order_relaxed);
+        return true;
+    }
+
+    int64_t now = NowMilliseconds();
+    int64_t windowStart = entry->windowStart.load(std::memory_order_relaxed);
+    if (now - windowStart >= 1000 &&
+        entry->windowStart.compare_exchange_strong(windowStart, now,
+                                                   std::memory_order_relaxed)) {
+        entry->loggedInWindow.store(0, std::memory_order_relaxed);
+    }
+
+    return entry->loggedInWindow.fetch_add(1, std::memory_order_relaxed) <
+           REPEATS_PER_SECOND;
+}
+
+void APIENTRY Callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                       GLsizei length, const GLchar *message,
+                       const void *userParam) {
+    (void)length;
+    (void)userParam;
+
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH:
+        high.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case GL_DEBUG_SEVERITY_MEDIUM:
+        medium.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case GL_DEBUG_SEVERITY_LOW:
+        low.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        notification.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    if (type == GL_DEBUG_TYPE_PERFORMANCE) {
+        performance.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // GL enums fit in 16 bits; the top bit keeps the key from being 0.
+    uint64_t key = ((uint64_t)(source & 0xFFFF) << 48) |
+                   ((uint64_t)(type & 0xFFFF) << 32) | id;
+    uint64_t repeats;
+    if (!ShouldLog(Lookup(key | 1ull << 63), repeats)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const char *format = "GL %s %s [%u]: %s (seen %llu times)";
+    if (repeats == 0) {
+        format = "GL %s %s [%u]: %s";
+    }
+    unsigned long long seen = repeats + 1;
+
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH:
+        LOG_ERROR(format, SourceName(source), TypeName(type), id, message,
+                  seen);
+        break;
+    case GL_DEBUG_SEVERITY_MEDIUM:
+        LOG_WARN(format, SourceName(source), TypeName(type), id, message,
+                 seen);
+        break;
+    case GL_DEBUG_SEVERITY_LOW:
+        LOG_INFO(format, SourceName(source), TypeName(type), id, message,
+                 seen);
+        break;
+    default:
+        LOG_DEBUG(format, SourceName(source), TypeName(type), id, message,
+                  seen);
+        break;
+    }
+}
+
+// Fetches the KHR_debug entry points glad left null, if the context lists
+// the extension. On a core profile they have no KHR suffix.
+void LoadKhrDebug(GLADloadproc load) {
+    if (glDebugMessageCallback != NULL || load == NULL) {
+        return;
+    }
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (name != NULL && strcmp(name, "GL_KHR_debug") == 0) {
+            glad_glDebugMessageCallback =
+                (PFNGLDEBUGMESSAGECALLBACKPROC)load("glDebugMessageCallback");
+            glad_glDebugMessageControl =
+                (PFNGLDEBUGMESSAGECONTROLPROC)load("glDebugMessageControl");
+            return;
+        }
+    }
+}
+
+} // namespace
+
+bool Install(bool synchronous, GLADloadproc load) {
+    LoadKhrDebug(load);
+    if (glDebugMessageCallback == NULL || glDebugMessageControl == NULL) {
+        LOG_WARN("GL debug output is not available on this context");
+        return false;
+    }
+
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+        LOG_WARN("Not a debug context, GL may report few or no messages");
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+    if (synchronous) {
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    } else {
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    glDebugMessageCallback(Callback, NULL);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL,
+                          GL_TRUE);
+    return true;
+}
+
+void Uninstall() {
+    if (glDebugMessageCallback == NULL) {
+        return;
+    }
+
+    glDebugMessageCallback(NULL, NULL);
+    glDisable(GL_DEBUG_OUTPUT);
+}
+
+Counters GetCounters() {
+    Counters counters;
+    counters.high = high.load(std::memory_order_relaxed);
+    counters.medium = medium.load(std::memory_order_relaxed);
+    counters.low = low.load(std::memory_order_relaxed);
+    counters.notification = notification.load(std::memory_order_relaxed);
+    counters.performance = performance.load(std::memory_order_relaxed);
+    counters.suppressed = suppressed.load(std::memory_order_relaxed);
+    return counters;
+}
+
+} // namespace GLDebug
@@ -0,0 +1,43 @@
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include "../glad/glad.h"
+#include <cstdint>
+
+// Routes KHR_debug / GL 4.3 debug output into the logger.
+//
+// Repeated messages are deduplicated by (source, type, id): the first one is
+// logged in full, later repeats at most a few times per second with a repeat
+// count. Every message is counted per severity, and driver performance
+// warnings (GL_DEBUG_TYPE_PERFORMANCE) are counted separately as a metric.
+//
+// In synchronous mode the callback runs inside the offending GL call, which
+// is what you want when debugging. Asynchronous mode lets the driver call
+// back from its own threads without serialising; the callback is lock-free.
+namespace GLDebug {
+
+struct Counters {
+    uint64_t high;
+    uint64_t medium;
+    uint64_t low;
+    uint64_t notification;
+    uint64_t performance;
+    // Messages counted but not logged because of deduplication.
+    uint64_t suppressed;
+};
+
+// Installs the callback. Returns false if the context has no debug output.
+// load is the loader given to gladLoadGLLoader: glad only loads the debug
+// entry points on GL 4.3, so below that they are fetched through it when
+// the context lists GL_KHR_debug.
+bool Install(bool synchronous, GLADloadproc load);
+
+// Removes the callback and disables debug output.
+void Uninstall();
+
+// Snapshot of the message counters.
+Counters GetCounters();
+
+} // namespace GLDebug
+
+#endif
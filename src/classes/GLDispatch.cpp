@@ -0,0 +1,535 @@
+#include "GLDispatch.h"
+#include "../glad/glad.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+namespace GLDispatch {
+
+namespace {
+
+// How a call affects GL state. Shadowed calls are compared with the last
+// value set for the same piece of state, so redundant ones can be told
+// apart from real changes.
+enum StateRule {
+    // Does not set state.
+    NO_STATE,
+    // Sets state that is not shadowed; every call counts as a change.
+    UNSHADOWED,
+    // Sets one global value from all its arguments, e.g. glUseProgram.
+    KEY_NONE,
+    // Sets the value selected by its first argument to the rest.
+    KEY_FIRST,
+    // The bindings, with their side effects on other bindings.
+    ACTIVE_TEXTURE,
+    BIND_BUFFER,
+    BIND_INDEXED_BUFFER,
+    BIND_TEXTURE,
+    BIND_FRAMEBUFFER,
+    BIND_VERTEX_ARRAY,
+    ENABLE,
+    DISABLE,
+    // Deletes objects, which can unbind them; forgets the shadowed state.
+    FORGETS_STATE,
+};
+
+struct EntryPoint {
+    const char *name;
+    // Address of the glad function pointer.
+    void **slot;
+    // Pointer saved on install, restored on uninstall.
+    void *real;
+    // Simulated implementation for Mock mode, if the default of doing
+    // nothing and returning zero is not enough.
+    void *mock;
+    StateRule state;
+    std::atomic<uint64_t> calls;
+};
+
+// Piece of state: the entry point or group that sets it and up to two
+// values selecting it, e.g. the buffer binding of one target.
+struct StateKey {
+    const void *group;
+    uint64_t first;
+    uint64_t second;
+
+    bool operator==(const StateKey &other) const {
+        return group == other.group && first == other.first &&
+               second == other.second;
+    }
+};
+
+struct StateKeyHash {
+    size_t operator()(const StateKey &key) const {
+        return std::hash<const void *>()(key.group) ^
+               std::hash<uint64_t>()(key.first * 31 + key.second);
+    }
+};
+
+// Values a call sets, as bits; no shadowed call sets more than four.
+struct StateValue {
+    uint64_t values[4];
+    int count;
+
+    bool operator==(const StateValue &other) const {
+        return count == other.count &&
+               std::equal(values, values + count, other.values);
+    }
+};
+
+bool installed = false;
+Mode mode = Forward;
+bool logging = false;
+// Counters are atomic (relaxed) so threads other than the GL thread can
+// read them while it records. The call log takes a lock when logging.
+std::atomic<uint64_t> totalCalls(0);
+std::atomic<uint64_t> stateChanges(0);
+std::atomic<uint64_t> redundantStateCalls(0);
+std::mutex callLogMutex;
+std::vector<std::string> callLog;
+
+// Last value set for each shadowed piece of state. Only the thread that
+// owns the context makes GL calls, so only it touches this.
+std::unordered_map<StateKey, StateValue, StateKeyHash> shadow;
+// Groups of shadowed state that several entry points set; the rest is
+// keyed by the entry point.
+const char ACTIVE_TEXTURE_GROUP = 0;
+const char BUFFER_GROUP = 0;
+const char INDEXED_BUFFER_GROUP = 0;
+const char FRAMEBUFFER_GROUP = 0;
+const char CAPABILITY_GROUP = 0;
+
+template <typename T> void AppendArgument(std::string &line, T value) {
+    char text[32];
+    if constexpr (std::is_pointer<T>::value) {
+        snprintf(text, sizeof(text), "0x%" PRIxPTR, (uintptr_t)value);
+    } else if constexpr (std::is_floating_point<T>::value) {
+        snprintf(text, sizeof(text), "%g", (double)value);
+    } else if constexpr (std::is_signed<T>::value) {
+        snprintf(text, sizeof(text), "%lld", (long long)value);
+    } else {
+        snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+    }
+    line += text;
+}
+
+template <typename T> uint64_t ToBits(T value) {
+    if constexpr (std::is_pointer<T>::value) {
+        return (uint64_t)(uintptr_t)value;
+    } else if constexpr (std::is_floating_point<T>::value) {
+        double wide = value;
+        uint64_t bits;
+        memcpy(&bits, &wide, sizeof(bits));
+        return bits;
+    } else {
+        return (uint64_t)value;
+    }
+}
+
+// Sets a shadowed value and returns whether it differed.
+bool SetShadow(const StateKey &key, const StateValue &value) {
+    auto found = shadow.find(key);
+    if (found != shadow.end() && found->second == value) {
+        return false;
+    }
+    shadow[key] = value;
+    return true;
+}
+
+// Arguments first to first + count - 1 as a value.
+StateValue ValueOf(const uint64_t *bits, int first, int count) {
+    StateValue value = {};
+    value.count = std::min(count, 4);
+    std::copy(bits + first, bits + first + value.count, value.values);
+    return value;
+}
+
+// Updates the shadow for a state setting call with arguments bits and
+// returns whether it changed anything.
+bool UpdateShadow(const EntryPoint &entry, const uint64_t *bits,
+                  int count) {
+    switch (entry.state) {
+    case KEY_NONE:
+        return SetShadow({&entry, 0, 0}, ValueOf(bits, 0, count));
+    case KEY_FIRST:
+        return SetShadow({&entry, bits[0], 0}, ValueOf(bits, 1, count - 1));
+    case ACTIVE_TEXTURE:
+        return SetShadow({&ACTIVE_TEXTURE_GROUP, 0, 0}, ValueOf(bits, 0, 1));
+    case BIND_BUFFER:
+        return SetShadow({&BUFFER_GROUP, bits[0], 0}, ValueOf(bits, 1, 1));
+    case BIND_INDEXED_BUFFER:
+        // Also sets the target's generic binding.
+        SetShadow({&BUFFER_GROUP, bits[0], 0}, ValueOf(bits, 2, 1));
+        return SetShadow({&INDEXED_BUFFER_GROUP, bits[0], bits[1]},
+                         ValueOf(bits, 2, count - 2));
+    case BIND_TEXTURE: {
+        auto unit = shadow.find({&ACTIVE_TEXTURE_GROUP, 0, 0});
+        uint64_t active = unit != shadow.end() ? unit->second.values[0]
+                                               : (uint64_t)GL_TEXTURE0;
+        return SetShadow({&entry, active, bits[0]}, ValueOf(bits, 1, 1));
+    }
+    case BIND_FRAMEBUFFER: {
+        // GL_FRAMEBUFFER binds both the read and the draw framebuffer.
+        bool changed = false;
+        if (bits[0] != GL_DRAW_FRAMEBUFFER) {
+            changed |= SetShadow({&FRAMEBUFFER_GROUP, GL_READ_FRAMEBUFFER, 0},
+                                 ValueOf(bits, 1, 1));
+        }
+        if (bits[0] != GL_READ_FRAMEBUFFER) {
+            changed |= SetShadow({&FRAMEBUFFER_GROUP, GL_DRAW_FRAMEBUFFER, 0},
+                                 ValueOf(bits, 1, 1));
+        }
+        return changed;
+    }
+    case BIND_VERTEX_ARRAY:
+        // The element array binding belongs to the vertex array.
+        if (!SetShadow({&entry, 0, 0}, ValueOf(bits, 0, 1))) {
+            return false;
+        }
+        shadow.erase({&BUFFER_GROUP, GL_ELEMENT_ARRAY_BUFFER, 0});
+        return true;
+    case ENABLE:
+    case DISABLE: {
+        uint64_t enabled = entry.state == ENABLE;
+        return SetShadow({&CAPABILITY_GROUP, bits[0], 0},
+                         ValueOf(&enabled, 0, 1));
+    }
+    default:
+        return true;
+    }
+}
+
+template <typename... A> void Record(EntryPoint &entry, A... args) {
+    entry.calls.fetch_add(1, std::memory_order_relaxed);
+    totalCalls.fetch_add(1, std::memory_order_relaxed);
+    if (entry.state == FORGETS_STATE) {
+        shadow.clear();
+    } else if (entry.state != NO_STATE) {
+        uint64_t bits[sizeof...(A) + 1] = {ToBits(args)...};
+        if (UpdateShadow(entry, bits, (int)sizeof...(A))) {
+            stateChanges.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            redundantStateCalls.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (logging) {
+        std::string line = entry.name;
+        line += "(";
+        const char *separator = "";
+        ((line += separator, AppendArgument(line, args), separator = ", "),
+         ...);
+        (void)separator;
+        line += ")";
+        std::lock_guard<std::mutex> lock(callLogMutex);
+        callLog.push_back(line);
+    }
+}
+
+// Recording stub for the entry point E with function pointer type F.
+template <EntryPoint *E, typename F> struct Hook;
+
+template <EntryPoint *E, typename R, typename... A>
+struct Hook<E, R(APIENTRYP)(A...)> {
+    typedef R(APIENTRYP Function)(A...);
+
+    static R APIENTRY Call(A... args) {
+        Record(*E, args...);
+        if (mode == Forward && E->real != nullptr) {
+            return ((Function)E->real)(args...);
+        }
+        if (E->mock != nullptr) {
+            return ((Function)E->mock)(args...);
+        }
+        return R();
+    }
+};
+
+// Simulated driver state for Mock mode.
+GLuint nextName = 0;
+std::vector<char> mappedMemory;
+
+void APIENTRY MockGen(GLsizei n, GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) {
+        names[i] = ++nextName;
+    }
+}
+
+GLuint APIENTRY MockCreateShader(GLenum type) {
+    (void)type;
+    return ++nextName;
+}
+
+GLuint APIENTRY MockCreateProgram() { return ++nextName; }
+
+void APIENTRY MockGetShaderiv(GLuint shader, GLenum pname, GLint *params) {
+    (void)shader;
+    *params = pname == GL_COMPILE_STATUS || pname == GL_LINK_STATUS ? GL_TRUE
+                                                                    : 0;
+}
+
+void APIENTRY MockGetInfoLog(GLuint object, GLsizei bufSize, GLsizei *length,
+                             GLchar *infoLog) {
+    (void)object;
+    if (length != NULL) {
+        *length = 0;
+    }
+    if (bufSize > 0) {
+        infoLog[0] = '\0';
+    }
+}
+
+void APIENTRY MockGetActiveUniformBlockiv(GLuint program, GLuint index,
+                                          GLenum pname, GLint *params) {
+    (void)program;
+    (void)index;
+    // An empty 16 byte block, the smallest std140 size.
+    *params = pname == GL_UNIFORM_BLOCK_DATA_SIZE ? 16 : 0;
+}
+
+void APIENTRY MockGetIntegerv(GLenum pname, GLint *data) {
+    *data = pname == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT ? 256 : 0;
+}
+
+void *APIENTRY MockMapBufferRange(GLenum target, GLintptr offset,
+                                  GLsizeiptr length, GLbitfield access) {
+    (void)target;
+    (void)offset;
+    (void)access;
+    if ((size_t)length > mappedMemory.size()) {
+        mappedMemory.resize(length);
+    }
+    return mappedMemory.data();
+}
+
+GLboolean APIENTRY MockUnmapBuffer(GLenum target) {
+    (void)target;
+    return GL_TRUE;
+}
+
+GLsync APIENTRY MockFenceSync(GLenum condition, GLbitfield flags) {
+    (void)condition;
+    (void)flags;
+    return (GLsync)(uintptr_t)++nextName;
+}
+
+GLenum APIENTRY MockClientWaitSync(GLsync sync, GLbitfield flags,
+                                   GLuint64 timeout) {
+    (void)sync;
+    (void)flags;
+    (void)timeout;
+    return GL_ALREADY_SIGNALED;
+}
+
+GLenum APIENTRY MockCheckFramebufferStatus(GLenum target) {
+    (void)target;
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void APIENTRY MockGetQueryObjectuiv(GLuint id, GLenum pname, GLuint *params) {
+    (void)id;
+    // Results are always available (and always zero).
+    *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void APIENTRY MockGetQueryObjectui64v(GLuint id, GLenum pname,
+                                      GLuint64 *params) {
+    (void)id;
+    (void)pname;
+    *params = 0;
+}
+
+void APIENTRY MockGetInteger64v(GLenum pname, GLint64 *data) {
+    (void)pname;
+    *data = 0;
+}
+
+const GLubyte *APIENTRY MockGetString(GLenum name) {
+    (void)name;
+    return (const GLubyte *)"GLDispatch mock";
+}
+
+// Entry points covered by the dispatch layer:
+//   X(name, state rule, mock implementation or nullptr)
+#define GL_DISPATCH_ENTRY_POINTS(X)                                            \
+    X(glActiveTexture, ACTIVE_TEXTURE, nullptr)                                \
+    X(glAttachShader, NO_STATE, nullptr)                                       \
+    X(glBeginQuery, NO_STATE, nullptr)                                         \
+    X(glBindBuffer, BIND_BUFFER, nullptr)                                      \
+    X(glBindBufferBase, BIND_INDEXED_BUFFER, nullptr)                          \
+    X(glBindBufferRange, BIND_INDEXED_BUFFER, nullptr)                         \
+    X(glBindFramebuffer, BIND_FRAMEBUFFER, nullptr)                            \
+    X(glBindRenderbuffer, KEY_FIRST, nullptr)                                  \
+    X(glBindTexture, BIND_TEXTURE, nullptr)                                    \
+    X(glBindVertexArray, BIND_VERTEX_ARRAY, nullptr)                           \
+    X(glBufferData, NO_STATE, nullptr)                                         \
+    X(glBufferSubData, NO_STATE, nullptr)                                      \
+    X(glCheckFramebufferStatus, NO_STATE, MockCheckFramebufferStatus)          \
+    X(glClear, NO_STATE, nullptr)                                              \
+    X(glClearColor, KEY_NONE, nullptr)                                         \
+    X(glClientWaitSync, NO_STATE, MockClientWaitSync)                          \
+    X(glCompileShader, NO_STATE, nullptr)                                      \
+    X(glCreateProgram, NO_STATE, MockCreateProgram)                            \
+    X(glCreateShader, NO_STATE, MockCreateShader)                              \
+    X(glDeleteBuffers, FORGETS_STATE, nullptr)                                 \
+    X(glDeleteFramebuffers, FORGETS_STATE, nullptr)                            \
+    X(glDeleteProgram, FORGETS_STATE, nullptr)                                 \
+    X(glDeleteQueries, NO_STATE, nullptr)                                      \
+    X(glDeleteRenderbuffers, FORGETS_STATE, nullptr)                           \
+    X(glDeleteShader, NO_STATE, nullptr)                                       \
+    X(glDeleteSync, NO_STATE, nullptr)                                         \
+    X(glDeleteTextures, FORGETS_STATE, nullptr)                                \
+    X(glDeleteVertexArrays, FORGETS_STATE, nullptr)                            \
+    X(glDisable, DISABLE, nullptr)                                             \
+    X(glDrawArrays, NO_STATE, nullptr)                                         \
+    X(glDrawElements, NO_STATE, nullptr)                                       \
+    X(glDrawElementsInstanced, NO_STATE, nullptr)                              \
+    X(glEnable, ENABLE, nullptr)                                               \
+    X(glEnableVertexAttribArray, UNSHADOWED, nullptr)                          \
+    X(glEndQuery, NO_STATE, nullptr)                                           \
+    X(glFenceSync, NO_STATE, MockFenceSync)                                    \
+    X(glFinish, NO_STATE, nullptr)                                             \
+    X(glFlush, NO_STATE, nullptr)                                              \
+    X(glFlushMappedBufferRange, NO_STATE, nullptr)                             \
+    X(glFramebufferRenderbuffer, UNSHADOWED, nullptr)                          \
+    X(glFramebufferTexture2D, UNSHADOWED, nullptr)                             \
+    X(glGenBuffers, NO_STATE, MockGen)                                         \
+    X(glGenFramebuffers, NO_STATE, MockGen)                                    \
+    X(glGenQueries, NO_STATE, MockGen)                                         \
+    X(glGenRenderbuffers, NO_STATE, MockGen)                                   \
+    X(glGenTextures, NO_STATE, MockGen)                                        \
+    X(glGenVertexArrays, NO_STATE, MockGen)                                    \
+    X(glGenerateMipmap, NO_STATE, nullptr)                                     \
+    X(glGetActiveUniformBlockiv, NO_STATE, MockGetActiveUniformBlockiv)        \
+    X(glGetActiveUniformName, NO_STATE, nullptr)                               \
+    X(glGetActiveUniformsiv, NO_STATE, nullptr)                                \
+    X(glGetError, NO_STATE, nullptr)                                           \
+    X(glGetInteger64v, NO_STATE, MockGetInteger64v)                            \
+    X(glGetIntegerv, NO_STATE, MockGetIntegerv)                                \
+    X(glGetProgramInfoLog, NO_STATE, MockGetInfoLog)                           \
+    X(glGetProgramiv, NO_STATE, MockGetShaderiv)                               \
+    X(glGetQueryObjectui64v, NO_STATE, MockGetQueryObjectui64v)                \
+    X(glGetQueryObjectuiv, NO_STATE, MockGetQueryObjectuiv)                    \
+    X(glGetShaderInfoLog, NO_STATE, MockGetInfoLog)                            \
+    X(glGetShaderiv, NO_STATE, MockGetShaderiv)                                \
+    X(glGetString, NO_STATE, MockGetString)                                    \
+    X(glGetUniformBlockIndex, NO_STATE, nullptr)                               \
+    X(glGetUniformLocation, NO_STATE, nullptr)                                 \
+    X(glLinkProgram, NO_STATE, nullptr)                                        \
+    X(glMapBufferRange, NO_STATE, MockMapBufferRange)                          \
+    X(glPixelStorei, KEY_FIRST, nullptr)                                       \
+    X(glQueryCounter, NO_STATE, nullptr)                                       \
+    X(glReadPixels, NO_STATE, nullptr)                                         \
+    X(glRenderbufferStorage, NO_STATE, nullptr)                                \
+    X(glShaderSource, NO_STATE, nullptr)                                       \
+    X(glTexImage2D, NO_STATE, nullptr)                                         \
+    X(glTexParameteri, UNSHADOWED, nullptr)                                    \
+    X(glTexSubImage2D, NO_STATE, nullptr)                                      \
+    X(glUniform1f, UNSHADOWED, nullptr)                                        \
+    X(glUniform1i, UNSHADOWED, nullptr)                                        \
+    X(glUniformBlockBinding, UNSHADOWED, nullptr)                              \
+    X(glUnmapBuffer, NO_STATE, MockUnmapBuffer)                                \
+    X(glUseProgram, KEY_NONE, nullptr)                                         \
+    X(glVertexAttribDivisor, UNSHADOWED, nullptr)                              \
+    X(glVertexAttribPointer, UNSHADOWED, nullptr)                              \
+    X(glViewport, KEY_NONE, nullptr)
+
+#define DEFINE_ENTRY_POINT(name, state, mockFunction)                          \
+    EntryPoint entry_##name = {#name, (void **)&glad_##name, nullptr,          \
+                               (void *)mockFunction, state, 0};
+GL_DISPATCH_ENTRY_POINTS(DEFINE_ENTRY_POINT)
+
+struct HookedEntryPoint {
+    EntryPoint *entry;
+    void *hook;
+};
+
+#define HOOK_ENTRY_POINT(name, state, mockFunction)                            \
+    {&entry_##name,                                                            \
+     (void *)&Hook<&entry_##name, decltype(glad_##name)>::Call},
+const HookedEntryPoint entryPoints[] = {
+    GL_DISPATCH_ENTRY_POINTS(HOOK_ENTRY_POINT)};
+
+} // namespace
+
+void InstallRecording(Mode recordingMode, bool logCalls) {
+    if (installed) {
+        Uninstall();
+    }
+
+    mode = recordingMode;
+    logging = logCalls;
+    Reset();
+    for (const HookedEntryPoint &entryPoint : entryPoints) {
+        entryPoint.entry->real = *entryPoint.entry->slot;
+        *entryPoint.entry->slot = entryPoint.hook;
+    }
+    installed = true;
+}
+
+void Uninstall() {
+    if (!installed) {
+        return;
+    }
+
+    for (const HookedEntryPoint &entryPoint : entryPoints) {
+        *entryPoint.entry->slot = entryPoint.entry->real;
+    }
+    installed = false;
+}
+
+void Reset() {
+    for (const HookedEntryPoint &entryPoint : entryPoints) {
+        entryPoint.entry->calls.store(0, std::memory_order_relaxed);
+    }
+    totalCalls.store(0, std::memory_order_relaxed);
+    stateChanges.store(0, std::memory_order_relaxed);
+    redundantStateCalls.store(0, std::memory_order_relaxed);
+    // The driver's state is unknown again, e.g. after a context switch.
+    shadow.clear();
+    std::lock_guard<std::mutex> lock(callLogMutex);
+    callLog.clear();
+}
+
+uint64_t CallCount(const char *entryPoint) {
+    for (const HookedEntryPoint &hooked : entryPoints) {
+        if (strcmp(hooked.entry->name, entryPoint) == 0) {
+            return hooked.entry->calls.load(std::memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+uint64_t TotalCalls() { return totalCalls.load(std::memory_order_relaxed); }
+
+uint64_t StateChanges() {
+    return stateChanges.load(std::memory_order_relaxed);
+}
+
+uint64_t RedundantStateCalls() {
+    return redundantStateCalls.load(std::memory_order_relaxed);
+}
+
+std::vector<std::pair<const char *, uint64_t>> CallCounts() {
+    std::vector<std::pair<const char *, uint64_t>> counts;
+    for (const HookedEntryPoint &hooked : entryPoints) {
+        uint64_t calls = hooked.entry->calls.load(std::memory_order_relaxed);
+        if (calls > 0) {
+            counts.push_back({hooked.entry->name, calls});
+        }
+    }
+    std::stable_sort(counts.begin(), counts.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.second > b.second;
+                     });
+    return counts;
+}
+
+const std::vector<std::string> &CallLog() { return callLog; }
+
+} // namespace GLDispatch
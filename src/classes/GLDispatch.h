@@ -0,0 +1,63 @@
+#ifndef GL_DISPATCH_H
+#define GL_DISPATCH_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Swappable GL dispatch for the entry points the wrapper classes use.
+//
+// glad calls every GL function through a pointer (glad_glGenBuffers, ...).
+// InstallRecording swaps those pointers for recording stubs that count each
+// call, count state changes and optionally log every call with its
+// arguments. Bindings, capabilities, the program, clear colour and viewport
+// are shadowed, so a call that sets them to their current value counts as
+// redundant rather than as a change; other state setting calls always
+// count as changes. The stubs then either forward to the driver or, in
+// Mock mode, simulate the driver well enough (object IDs, successful
+// compiles, mapped memory, signalled fences) to run Shader, Texture and the
+// buffer classes on a machine with no GPU and no context.
+namespace GLDispatch {
+
+enum Mode {
+    // Record, then call the real driver function.
+    Forward,
+    // Record and simulate; no context needed.
+    Mock,
+};
+
+// Replaces the glad pointers with recording stubs.
+void InstallRecording(Mode mode, bool logCalls = false);
+
+// Restores the pointers saved by InstallRecording.
+void Uninstall();
+
+// Clears the counters, the call log and the shadowed state.
+void Reset();
+
+// Calls made to one entry point, e.g. CallCount("glBindBuffer").
+uint64_t CallCount(const char *entryPoint);
+
+// Calls made to any hooked entry point.
+uint64_t TotalCalls();
+
+// State setting calls that changed the state.
+uint64_t StateChanges();
+
+// State setting calls that left the shadowed state as it was.
+uint64_t RedundantStateCalls();
+
+// Entry points with at least one call, most called first.
+std::vector<std::pair<const char *, uint64_t>> CallCounts();
+
+// Counters may be read from any thread. GL calls, and so the shadowed state,
+// belong to the thread that owns the context.
+
+// Every call with its arguments, when logCalls was set. Read it when no
+// thread is making GL calls.
+const std::vector<std::string> &CallLog();
+
+} // namespace GLDispatch
+
+#endif
@@ -0,0 +1,214 @@
+#include "GLHandlePool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Frames ended so far, and the last one whose fence has signalled.
+unsigned long long currentFrame = 0;
+unsigned long long finishedFrame = 0;
+// Fences of ended frames that destroyed something, oldest first.
+std::deque<std::pair<unsigned long long, GLsync>> frameFences;
+size_t deleteBudget = GLHandlePool::DEFAULT_DELETE_BUDGET;
+
+} // namespace
+
+GLHandlePool::GLHandlePool(GLObjectType type, unsigned int batch)
+    : type(type), batch(std::max(batch, 1u)) {}
+
+GLHandlePool &GLHandlePool::Get(GLObjectType type) {
+    static GLHandlePool pools[GL_OBJECT_TYPE_COUNT] = {
+        GLHandlePool(GL_OBJECT_BUFFER), GLHandlePool(GL_OBJECT_TEXTURE),
+        GLHandlePool(GL_OBJECT_VERTEX_ARRAY),
+        GLHandlePool(GL_OBJECT_FRAMEBUFFER),
+        GLHandlePool(GL_OBJECT_RENDERBUFFER)};
+    return pools[type];
+}
+
+void GLHandlePool::EndFrame() {
+    TRACE_SCOPE("GLHandlePool::EndFrame");
+    currentFrame++;
+    bool destroyed = false;
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; type++) {
+        GLHandlePool &pool = Get((GLObjectType)type);
+        if (!pool.doomed.empty()) {
+            pool.retiring.push_back({currentFrame, std::move(pool.doomed)});
+            pool.retiringCount += pool.retiring.back().names.size();
+            pool.doomed.clear();
+            destroyed = true;
+        }
+    }
+    if (destroyed) {
+        frameFences.push_back(
+            {currentFrame, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+    }
+
+    // Polls without waiting; the oldest fences signal first.
+    while (!frameFences.empty()) {
+        GLenum status = glClientWaitSync(frameFences.front().second, 0, 0);
+        if (status != GL_ALREADY_SIGNALED &&
+            status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        finishedFrame = frameFences.front().first;
+        glDeleteSync(frameFences.front().second);
+        frameFences.pop_front();
+    }
+
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; type++) {
+        Get((GLObjectType)type).DeleteRetired(finishedFrame, deleteBudget);
+    }
+}
+
+void GLHandlePool::FlushAll() {
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; type++) {
+        GLHandlePool &pool = Get((GLObjectType)type);
+        pool.DeleteRetired(currentFrame, pool.retiringCount);
+        pool.Flush();
+        pool.DeleteNames(pool.spares.data(), pool.spares.size());
+        pool.spares.clear();
+    }
+    for (const std::pair<unsigned long long, GLsync> &fence : frameFences) {
+        glDeleteSync(fence.second);
+    }
+    frameFences.clear();
+    finishedFrame = currentFrame;
+}
+
+void GLHandlePool::SetDeleteBudget(size_t names) {
+    deleteBudget = std::max(names, (size_t)1);
+}
+
+GLHandle GLHandlePool::Create() {
+    GLHandle handle;
+    Create(&handle, 1);
+    return handle;
+}
+
+void GLHandlePool::Create(GLHandle *handles, size_t count) {
+    if (spares.size() < count) {
+        Generate(std::max(count - spares.size(), (size_t)batch));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        GLuint name = spares.back();
+        spares.pop_back();
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            names[slot] = name;
+            generations[slot]++;
+        } else {
+            slot = (uint32_t)names.size();
+            names.push_back(name);
+            generations.push_back(0);
+        }
+        handles[i].index = slot;
+        handles[i].generation = generations[slot];
+    }
+    live += count;
+}
+
+void GLHandlePool::Destroy(GLHandle handle) {
+    if (!IsValid(handle)) {
+        return;
+    }
+    doomed.push_back(names[handle.index]);
+    names[handle.index] = 0;
+    generations[handle.index]++;
+    freeSlots.push_back(handle.index);
+    live--;
+}
+
+void GLHandlePool::Flush() {
+    if (doomed.empty()) {
+        return;
+    }
+    TRACE_SCOPE("GLHandlePool::Flush");
+    DeleteNames(doomed.data(), doomed.size());
+    doomed.clear();
+}
+
+void GLHandlePool::DeleteRetired(unsigned long long lastFinished,
+                                 size_t budget) {
+    deleting.clear();
+    while (!retiring.empty() && retiring.front().frame <= lastFinished &&
+           deleting.size() < budget) {
+        const std::vector<GLuint> &names = retiring.front().names;
+        size_t take =
+            std::min(names.size() - retiringDeleted, budget - deleting.size());
+        deleting.insert(deleting.end(), names.begin() + retiringDeleted,
+                        names.begin() + retiringDeleted + take);
+        retiringDeleted += take;
+        if (retiringDeleted == names.size()) {
+            retiring.pop_front();
+            retiringDeleted = 0;
+        }
+    }
+    retiringCount -= deleting.size();
+    DeleteNames(deleting.data(), deleting.size());
+}
+
+void GLHandlePool::DeleteNames(const GLuint *names, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    switch (type) {
+    case GL_OBJECT_BUFFER:
+        glDeleteBuffers((GLsizei)count, names);
+        break;
+    case GL_OBJECT_TEXTURE:
+        glDeleteTextures((GLsizei)count, names);
+        break;
+    case GL_OBJECT_VERTEX_ARRAY:
+        glDeleteVertexArrays((GLsizei)count, names);
+        break;
+    case GL_OBJECT_FRAMEBUFFER:
+        glDeleteFramebuffers((GLsizei)count, names);
+        break;
+    case GL_OBJECT_RENDERBUFFER:
+        glDeleteRenderbuffers((GLsizei)count, names);
+        break;
+    default:
+        break;
+    }
+    deleteCalls++;
+}
+
+void GLHandlePool::Generate(size_t count) {
+    size_t first = spares.size();
+    spares.resize(first + count);
+    GLuint *out = spares.data() + first;
+    switch (type) {
+    case GL_OBJECT_BUFFER:
+        glGenBuffers((GLsizei)count, out);
+        break;
+    case GL_OBJECT_TEXTURE:
+        glGenTextures((GLsizei)count, out);
+        break;
+    case GL_OBJECT_VERTEX_ARRAY:
+        glGenVertexArrays((GLsizei)count, out);
+        break;
+    case GL_OBJECT_FRAMEBUFFER:
+        glGenFramebuffers((GLsizei)count, out);
+        break;
+    case GL_OBJECT_RENDERBUFFER:
+        glGenRenderbuffers((GLsizei)count, out);
+        break;
+    default:
+        break;
+    }
+    generateCalls++;
+}
+
+size_t GLHandlePool::LiveCount() const { return live; }
+
+size_t GLHandlePool::PendingDeletes() const { return doomed.size(); }
+
+size_t GLHandlePool::RetiringDeletes() const { return retiringCount; }
+
+size_t GLHandlePool::GenerateCalls() const { return generateCalls; }
+
+size_t GLHandlePool::DeleteCalls() const { return deleteCalls; }
@@ -0,0 +1,212 @@
+#ifndef GL_HANDLE_POOL_H
+#define GL_HANDLE_POOL_H
+
+#include "../glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Kinds of GL object names handed out by the pools.
+enum GLObjectType {
+    GL_OBJECT_BUFFER,
+    GL_OBJECT_TEXTURE,
+    GL_OBJECT_VERTEX_ARRAY,
+    GL_OBJECT_FRAMEBUFFER,
+    GL_OBJECT_RENDERBUFFER,
+    GL_OBJECT_TYPE_COUNT
+};
+
+// Reference to a GL object name in a GLHandlePool. The generation changes
+// every time the slot is freed, so a handle kept after its object was
+// destroyed is recognisably stale rather than naming some other object.
+struct GLHandle {
+    static const uint32_t NO_INDEX = 0xffffffffu;
+
+    uint32_t index = NO_INDEX;
+    uint32_t generation = 0;
+};
+
+// Names of one kind of GL object, kept in dense arrays indexed by handle.
+//
+// Names are generated in batches: Create takes a spare name and refills
+// the spares with one glGen* call when they run out. Destroy frees the slot
+// at once but only queues the name, so objects can be released mid-frame
+// while queued commands still use them.
+//
+// EndFrame, called once per frame after the last draw, puts a fence behind
+// the names destroyed during the frame. Names are deleted once their
+// frame's fence has signalled, with one glDelete* call per type and frame,
+// and at most the delete budget of each type per frame; the rest wait for
+// the next frame, so unloading a level spreads its deletes over several
+// frames instead of stalling one.
+//
+// The pools serve the GL context of the render thread and are not
+// thread-safe.
+class GLHandlePool {
+  public:
+    // Names generated per glGen* call by default.
+    static const unsigned int DEFAULT_BATCH = 64;
+
+    // Names of each type EndFrame deletes per frame by default.
+    static const size_t DEFAULT_DELETE_BUDGET = 4096;
+
+    // Constructor for a pool of one kind of object.
+    explicit GLHandlePool(GLObjectType type,
+                          unsigned int batch = DEFAULT_BATCH);
+
+    GLHandlePool(const GLHandlePool &) = delete;
+    GLHandlePool &operator=(const GLHandlePool &) = delete;
+
+    // The pool of each kind of object for the current context.
+    static GLHandlePool &Get(GLObjectType type);
+
+    // Fences the names destroyed this frame and deletes the names of
+    // finished frames, up to the delete budget per type.
+    static void EndFrame();
+
+    // Deletes every queued and spare name of every pool now, without
+    // waiting for the GPU. Call before the context is destroyed, after the
+    // objects still alive, whose names it leaves alone. Slot generations
+    // are kept, so an old handle never names a later object and the pools
+    // can be used again, e.g. with a new context.
+    static void FlushAll();
+
+    // Names of each type EndFrame may delete per frame.
+    static void SetDeleteBudget(size_t names);
+
+    // Takes a name and returns its handle.
+    GLHandle Create();
+
+    // Takes count names with at most one glGen* call.
+    void Create(GLHandle *handles, size_t count);
+
+    // Frees a handle and queues its name for deletion. Stale handles are
+    // ignored.
+    void Destroy(GLHandle handle);
+
+    // Whether a handle refers to a live object; O(1).
+    bool IsValid(GLHandle handle) const {
+        return handle.index < generations.size() &&
+               generations[handle.index] == handle.generation;
+    }
+
+    // GL name of a handle, or 0 if it is stale.
+    GLuint Name(GLHandle handle) const {
+        return IsValid(handle) ? names[handle.index] : 0;
+    }
+
+    // Deletes the names queued by this pool now, with one glDelete* call
+    // and without waiting for the GPU.
+    void Flush();
+
+    // Live handles; names destroyed this frame; and names of earlier
+    // frames not deleted yet.
+    size_t LiveCount() const;
+    size_t PendingDeletes() const;
+    size_t RetiringDeletes() const;
+
+    // glGen* and glDelete* calls made so far.
+    size_t GenerateCalls() const;
+    size_t DeleteCalls() const;
+
+  private:
+    GLObjectType type;
+    unsigned int batch;
+
+    // Per slot: the name, and the generation of the handle that owns it.
+    // Free slots have an odd generation, live ones an even one.
+    std::vector<GLuint> names;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> freeSlots;
+    // Generated but never handed out.
+    std::vector<GLuint> spares;
+    // Destroyed this frame.
+    std::vector<GLuint> doomed;
+    // Names destroyed in earlier frames, oldest first, with the frame.
+    struct Retiring {
+        unsigned long long frame;
+        std::vector<GLuint> names;
+    };
+    std::deque<Retiring> retiring;
+    // Names of the front batch already deleted.
+    size_t retiringDeleted = 0;
+    size_t retiringCount = 0;
+    std::vector<GLuint> deleting;
+    size_t live = 0;
+    size_t generateCalls = 0;
+    size_t deleteCalls = 0;
+
+    void Generate(size_t count);
+    // Deletes up to budget names destroyed in frames up to lastFinished.
+    void DeleteRetired(unsigned long long lastFinished, size_t budget);
+    void DeleteNames(const GLuint *names, size_t count);
+};
+
+// Move-only owner of one pooled GL object name. The name is queued for
+// deletion when the owner is destroyed or reset.
+template <GLObjectType Type> class GLObject {
+  public:
+    // An owner of nothing, with name 0.
+    GLObject() = default;
+
+    ~GLObject() { Reset(); }
+
+    GLObject(GLObject &&other) noexcept : handle(other.handle) {
+        other.handle = GLHandle();
+    }
+
+    GLObject &operator=(GLObject &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            handle = other.handle;
+            other.handle = GLHandle();
+        }
+        return *this;
+    }
+
+    GLObject(const GLObject &) = delete;
+    GLObject &operator=(const GLObject &) = delete;
+
+    // Creates a new object.
+    static GLObject Create() {
+        GLObject object;
+        object.handle = GLHandlePool::Get(Type).Create();
+        return object;
+    }
+
+    // Creates count objects, replacing what they owned, with at most one
+    // glGen* call.
+    static void Create(GLObject *objects, size_t count) {
+        std::vector<GLHandle> handles(count);
+        GLHandlePool::Get(Type).Create(handles.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            objects[i].Reset();
+            objects[i].handle = handles[i];
+        }
+    }
+
+    // The GL name, or 0 if empty.
+    GLuint Name() const { return GLHandlePool::Get(Type).Name(handle); }
+
+    GLHandle Handle() const { return handle; }
+
+    // Queues the object for deletion and becomes empty.
+    void Reset() {
+        if (handle.index != GLHandle::NO_INDEX) {
+            GLHandlePool::Get(Type).Destroy(handle);
+            handle = GLHandle();
+        }
+    }
+
+  private:
+    GLHandle handle;
+};
+
+typedef GLObject<GL_OBJECT_BUFFER> GLBuffer;
+typedef GLObject<GL_OBJECT_TEXTURE> GLTexture;
+typedef GLObject<GL_OBJECT_VERTEX_ARRAY> GLVertexArray;
+typedef GLObject<GL_OBJECT_FRAMEBUFFER> GLFramebuffer;
+typedef GLObject<GL_OBJECT_RENDERBUFFER> GLRenderbuffer;
+
+#endif
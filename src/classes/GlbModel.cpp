@@ -0,0 +1,624 @@
+#include "GlbModel.h"
+#include "JsonReader.h"
+#include "Log.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace {
+
+const uint32_t GLB_MAGIC = 0x46546c67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004e4942;  // "BIN\0"
+
+// Vertex shader locations of the attributes that are read.
+const char *const ATTRIBUTES[] = {"POSITION", "COLOR_0", "TEXCOORD_0"};
+const int ATTRIBUTE_COUNT = 3;
+
+struct Buffer {
+    bool external = false;
+};
+
+struct BufferView {
+    int buffer = -1;
+    size_t byteOffset = 0;
+    size_t byteLength = 0;
+    size_t byteStride = 0;
+};
+
+struct Accessor {
+    int bufferView = -1;
+    size_t byteOffset = 0;
+    int componentType = 0;
+    bool normalized = false;
+    size_t count = 0;
+    int components = 0;
+    bool sparse = false;
+};
+
+struct MeshPrimitive {
+    int attributes[ATTRIBUTE_COUNT] = {-1, -1, -1};
+    int indices = -1;
+    int material = -1;
+    int mode = GL_TRIANGLES;
+};
+
+struct Image {
+    int bufferView = -1;
+    bool external = false;
+};
+
+// The parts of a glTF document the loader uses.
+struct Document {
+    std::vector<Buffer> buffers;
+    std::vector<BufferView> bufferViews;
+    std::vector<Accessor> accessors;
+    std::vector<MeshPrimitive> primitives;
+    // Base colour texture of each material.
+    std::vector<int> materials;
+    // Image of each texture.
+    std::vector<int> textures;
+    std::vector<Image> images;
+    std::string version;
+    std::vector<std::string> extensionsRequired;
+    // Field whose value was not a usable index or size, which stops the
+    // parse.
+    std::string invalidField;
+};
+
+// Fills a Document while the JSON is read. The path to the current value is
+// kept as a stack of the keys and array indices leading to it.
+class GltfHandler : public JsonHandler {
+  public:
+    Document document;
+
+    bool StartObject() override { return Open(false); }
+    bool EndObject() override { return Close(); }
+    bool StartArray() override { return Open(true); }
+    bool EndArray() override { return Close(); }
+
+    bool Key(const char *key, size_t length) override {
+        path.back().key.assign(key, length);
+        return true;
+    }
+
+    bool String(const char *value, size_t length) override {
+        return Scalar(0.0, value, length);
+    }
+
+    bool Number(double value) override {
+        return Scalar(value, nullptr, 0);
+    }
+
+    bool Bool(bool value) override {
+        return Scalar(value ? 1.0 : 0.0, nullptr, 0);
+    }
+
+    bool Null() override {
+        NextElement();
+        return true;
+    }
+
+  private:
+    struct Frame {
+        bool isArray;
+        // Key of the current member, or index of the current element.
+        std::string key;
+        size_t index;
+    };
+
+    std::vector<Frame> path;
+    // Mesh whose primitives are being read, and where they start in the
+    // flattened list.
+    size_t currentMesh = (size_t)-1;
+    size_t meshStart = 0;
+
+    bool Open(bool isArray) {
+        path.push_back({isArray, std::string(), 0});
+        return true;
+    }
+
+    bool Close() {
+        path.pop_back();
+        NextElement();
+        return true;
+    }
+
+    void NextElement() {
+        if (!path.empty() && path.back().isArray) {
+            path.back().index++;
+        }
+    }
+
+    // Whether the value at depth is the member called key.
+    bool Is(size_t depth, const char *key) const {
+        return depth < path.size() && !path[depth].isArray &&
+               path[depth].key == key;
+    }
+
+    template <typename T>
+    static T &Element(std::vector<T> &items, size_t index) {
+        if (index >= items.size()) {
+            items.resize(index + 1);
+        }
+        return items[index];
+    }
+
+    bool Scalar(double number, const char *string, size_t length) {
+        bool valid = TopLevel(number, string, length);
+        NextElement();
+        return valid;
+    }
+
+    // Stores a number read for an index or size field, or records the
+    // field and returns false if it is not a non-negative integer that
+    // fits in T.
+    template <typename T>
+    bool Integer(double number, const char *string, T &out) {
+        if (string || !(number >= 0.0) || number != std::floor(number) ||
+            number >= (double)std::numeric_limits<T>::max()) {
+            document.invalidField = path.back().key;
+            return false;
+        }
+        out = (T)number;
+        return true;
+    }
+
+    // Returns false to stop the parse.
+    bool TopLevel(double number, const char *string, size_t length) {
+        size_t depth = path.size();
+        if (depth < 2) {
+            return true;
+        }
+        const std::string &field = path.back().key;
+        size_t index = path[1].index;
+
+        if (Is(0, "asset") && depth == 2 && field == "version" && string) {
+            document.version.assign(string, length);
+        } else if (Is(0, "extensionsRequired") && depth == 2 && string) {
+            document.extensionsRequired.emplace_back(string, length);
+        } else if (Is(0, "buffers") && depth == 3 && field == "uri") {
+            Element(document.buffers, index).external = true;
+        } else if (Is(0, "bufferViews") && depth == 3) {
+            BufferView &view = Element(document.bufferViews, index);
+            if (field == "buffer") {
+                return Integer(number, string, view.buffer);
+            } else if (field == "byteOffset") {
+                return Integer(number, string, view.byteOffset);
+            } else if (field == "byteLength") {
+                return Integer(number, string, view.byteLength);
+            } else if (field == "byteStride") {
+                return Integer(number, string, view.byteStride);
+            }
+        } else if (Is(0, "accessors") && Is(2, "sparse")) {
+            Element(document.accessors, index).sparse = true;
+        } else if (Is(0, "accessors") && depth == 3) {
+            Accessor &accessor = Element(document.accessors, index);
+            if (field == "bufferView") {
+                return Integer(number, string, accessor.bufferView);
+            } else if (field == "byteOffset") {
+                return Integer(number, string, accessor.byteOffset);
+            } else if (field == "componentType") {
+                return Integer(number, string, accessor.componentType);
+            } else if (field == "normalized") {
+                accessor.normalized = number != 0.0;
+            } else if (field == "count") {
+                return Integer(number, string, accessor.count);
+            } else if (field == "type" && string) {
+                accessor.components = Components(std::string(string, length));
+            }
+        } else if (Is(0, "meshes") && Is(2, "primitives") && depth >= 5) {
+            // Primitives of every mesh are flattened into one list.
+            MeshPrimitive &primitive =
+                Element(document.primitives, PrimitiveIndex(index));
+            if (depth == 6 && Is(4, "attributes")) {
+                for (int i = 0; i < ATTRIBUTE_COUNT; i++) {
+                    if (field == ATTRIBUTES[i]) {
+                        return Integer(number, string, primitive.attributes[i]);
+                    }
+                }
+            } else if (depth == 5 && field == "indices") {
+                return Integer(number, string, primitive.indices);
+            } else if (depth == 5 && field == "material") {
+                return Integer(number, string, primitive.material);
+            } else if (depth == 5 && field == "mode") {
+                return Integer(number, string, primitive.mode);
+            }
+        } else if (Is(0, "materials") && depth == 5 &&
+                   Is(2, "pbrMetallicRoughness") &&
+                   Is(3, "baseColorTexture") && field == "index") {
+            return Integer(number, string, Element(document.materials, index));
+        } else if (Is(0, "textures") && depth == 3 && field == "source") {
+            return Integer(number, string, Element(document.textures, index));
+        } else if (Is(0, "images") && depth == 3) {
+            Image &image = Element(document.images, index);
+            if (field == "bufferView") {
+                return Integer(number, string, image.bufferView);
+            } else if (field == "uri") {
+                image.external = true;
+            }
+        }
+        return true;
+    }
+
+    // Index into the flattened primitive list of the current primitive.
+    size_t PrimitiveIndex(size_t mesh) {
+        if (mesh != currentMesh) {
+            currentMesh = mesh;
+            meshStart = document.primitives.size();
+        }
+        return meshStart + path[3].index;
+    }
+
+    static int Components(const std::string &type) {
+        if (type == "SCALAR") {
+            return 1;
+        } else if (type == "VEC2") {
+            return 2;
+        } else if (type == "VEC3") {
+            return 3;
+        } else if (type == "VEC4") {
+            return 4;
+        }
+        return 0;
+    }
+};
+
+uint32_t ReadUint32(const char *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+size_t ComponentSize(int componentType) {
+    switch (componentType) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return 4;
+    }
+    return 0;
+}
+
+// Checks that an accessor's elements lie inside its buffer view and the
+// BIN chunk.
+bool ValidAccessor(const Document &document, int index, size_t binSize) {
+    if (index < 0 || (size_t)index >= document.accessors.size()) {
+        return false;
+    }
+    const Accessor &accessor = document.accessors[index];
+    size_t elementSize =
+        ComponentSize(accessor.componentType) * accessor.components;
+    if (accessor.sparse || elementSize == 0 || accessor.count == 0 ||
+        accessor.count > INT_MAX || accessor.bufferView < 0 ||
+        (size_t)accessor.bufferView >= document.bufferViews.size()) {
+        return false;
+    }
+    const BufferView &view = document.bufferViews[accessor.bufferView];
+    if (view.buffer != 0 || view.byteOffset > binSize ||
+        view.byteLength > binSize - view.byteOffset ||
+        view.byteLength < elementSize ||
+        (view.byteStride != 0 && view.byteStride < elementSize)) {
+        return false;
+    }
+    // The first element must fit after byteOffset and the other count - 1
+    // strides after it, checked without computing the end, which can wrap.
+    size_t stride = view.byteStride != 0 ? view.byteStride : elementSize;
+    return accessor.byteOffset <= view.byteLength - elementSize &&
+           accessor.count - 1 <=
+               (view.byteLength - accessor.byteOffset - elementSize) / stride;
+}
+
+// Checks an index accessor as ValidAccessor does, and that it holds tightly
+// packed unsigned scalars which each name one of vertexCount vertices.
+bool ValidIndices(const Document &document, int index, const char *bin,
+                  size_t binSize, size_t vertexCount) {
+    if (!ValidAccessor(document, index, binSize)) {
+        return false;
+    }
+    const Accessor &accessor = document.accessors[index];
+    const BufferView &view = document.bufferViews[accessor.bufferView];
+    size_t size = ComponentSize(accessor.componentType);
+    if (accessor.components != 1 ||
+        (accessor.componentType != GL_UNSIGNED_BYTE &&
+         accessor.componentType != GL_UNSIGNED_SHORT &&
+         accessor.componentType != GL_UNSIGNED_INT) ||
+        (view.byteStride != 0 && view.byteStride != size)) {
+        return false;
+    }
+
+    const char *data = bin + view.byteOffset + accessor.byteOffset;
+    uint32_t largest = 0;
+    for (size_t i = 0; i < accessor.count; i++) {
+        const char *element = data + i * size;
+        uint32_t value;
+        if (size == 1) {
+            value = (uint8_t)*element;
+        } else if (size == 2) {
+            uint16_t shortValue;
+            memcpy(&shortValue, element, sizeof(shortValue));
+            value = shortValue;
+        } else {
+            value = ReadUint32(element);
+        }
+        largest = std::max(largest, value);
+    }
+    return largest < vertexCount;
+}
+
+} // namespace
+
+GlbModel::GlbModel(const char *path, TextureDecoder &decoder)
+    : decoder(decoder) {
+    TRACE_SCOPE("GlbModel::GlbModel");
+    // Shared with the decoder, which may still read images after this
+    // returns.
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+    if (!file->IsOpen()) {
+        return;
+    }
+    file->WillReadSequentially();
+    const char *data = file->Data();
+    size_t size = file->Size();
+
+    if (size < 20 || ReadUint32(data) != GLB_MAGIC ||
+        ReadUint32(data + 4) != 2 || ReadUint32(data + 8) < 20 ||
+        ReadUint32(data + 8) > size ||
+        ReadUint32(data + 16) != GLB_CHUNK_JSON) {
+        LOG_ERROR("%s is not a glTF 2.0 binary file", path);
+        return;
+    }
+    size = ReadUint32(data + 8);
+    size_t jsonSize = ReadUint32(data + 12);
+    if (jsonSize > size - 20) {
+        LOG_ERROR("%s: JSON chunk runs past the end of the file", path);
+        return;
+    }
+    const char *json = data + 20;
+    const char *bin = nullptr;
+    size_t binSize = 0;
+    size_t binHeader = 20 + ((jsonSize + 3) & ~(size_t)3);
+    if (binHeader + 8 <= size &&
+        ReadUint32(data + binHeader + 4) == GLB_CHUNK_BIN) {
+        bin = data + binHeader + 8;
+        binSize = ReadUint32(data + binHeader);
+        if (binSize > size - binHeader - 8) {
+            LOG_ERROR("%s: BIN chunk runs past the end of the file", path);
+            return;
+        }
+    }
+
+    GltfHandler handler;
+    {
+        TRACE_SCOPE("GlbModel parse");
+        if (!JsonReader::Parse(json, jsonSize, handler)) {
+            if (!handler.document.invalidField.empty()) {
+                LOG_ERROR("%s: %s is not a valid index or size", path,
+                          handler.document.invalidField.c_str());
+            } else {
+                LOG_ERROR("%s: invalid JSON chunk", path);
+            }
+            return;
+        }
+    }
+    const Document &document = handler.document;
+    if (document.version.compare(0, 2, "2.") != 0) {
+        LOG_ERROR("%s: unsupported glTF version '%s'", path,
+                  document.version.c_str());
+        return;
+    }
+    if (!document.extensionsRequired.empty()) {
+        LOG_ERROR("%s: requires unsupported extension %s", path,
+                  document.extensionsRequired[0].c_str());
+        return;
+    }
+    if (!document.buffers.empty() && document.buffers[0].external) {
+        LOG_ERROR("%s: external buffers are not supported", path);
+        return;
+    }
+
+    // Images are decoded while the geometry uploads.
+    std::vector<unsigned int> images(document.images.size(),
+                                     TextureDecoder::NO_IMAGE);
+    for (size_t i = 0; i < document.images.size(); i++) {
+        const Image &image = document.images[i];
+        if (image.external || image.bufferView < 0 ||
+            (size_t)image.bufferView >= document.bufferViews.size()) {
+            LOG_WARN("%s: image %zu is not embedded, skipped", path, i);
+            continue;
+        }
+        const BufferView &view = document.bufferViews[image.bufferView];
+        if (view.buffer != 0 || view.byteOffset > binSize ||
+            view.byteLength > binSize - view.byteOffset) {
+            LOG_WARN("%s: image %zu is outside the BIN chunk", path, i);
+            continue;
+        }
+        images[i] = decoder.Submit(bin + view.byteOffset, view.byteLength,
+                                   file);
+    }
+
+    // GL buffer of each buffer view, uploaded on first use.
+    std::vector<int> viewVertexBuffer(document.bufferViews.size(), -1);
+    std::vector<int> viewElementBuffer(document.bufferViews.size(), -1);
+
+    TRACE_SCOPE("GlbModel upload");
+    primitives.reserve(document.primitives.size());
+    for (size_t p = 0; p < document.primitives.size(); p++) {
+        const MeshPrimitive &source = document.primitives[p];
+        int position = source.attributes[0];
+        if (!ValidAccessor(document, position, binSize)) {
+            LOG_WARN("%s: primitive %zu has invalid accessors, skipped", path,
+                     p);
+            continue;
+        }
+        size_t vertexCount = document.accessors[position].count;
+        if (source.indices >= 0 &&
+            !ValidIndices(document, source.indices, bin, binSize,
+                          vertexCount)) {
+            LOG_WARN("%s: primitive %zu has invalid indices, skipped", path,
+                     p);
+            continue;
+        }
+
+        // Invalid attributes are left out, but every attribute read must
+        // have one element per vertex.
+        int attributes[ATTRIBUTE_COUNT];
+        bool countsMatch = true;
+        for (int location = 0; location < ATTRIBUTE_COUNT; location++) {
+            int index = source.attributes[location];
+            attributes[location] = index;
+            if (index < 0) {
+                continue;
+            }
+            if (!ValidAccessor(document, index, binSize)) {
+                LOG_WARN("%s: primitive %zu %s is invalid, skipped", path, p,
+                         ATTRIBUTES[location]);
+                attributes[location] = -1;
+            } else if (document.accessors[index].count != vertexCount) {
+                countsMatch = false;
+            }
+        }
+        if (!countsMatch) {
+            LOG_WARN("%s: primitive %zu attribute counts differ, skipped",
+                     path, p);
+            continue;
+        }
+
+        Primitive primitive = {VertexArrayObject(),
+                               (GLenum)source.mode,
+                               (GLsizei)vertexCount,
+                               0,
+                               0,
+                               TextureDecoder::NO_IMAGE};
+        primitive.vao.Bind();
+
+        for (int location = 0; location < ATTRIBUTE_COUNT; location++) {
+            int index = attributes[location];
+            if (index < 0) {
+                continue;
+            }
+            const Accessor &accessor = document.accessors[index];
+            const BufferView &view = document.bufferViews[accessor.bufferView];
+            int &buffer = viewVertexBuffer[accessor.bufferView];
+            if (buffer < 0) {
+                buffer = (int)vertexBuffers.size();
+                vertexBuffers.emplace_back(
+                    (const void *)(bin + view.byteOffset),
+                    (GLsizeiptr)view.byteLength);
+                directUploadBytes += view.byteLength;
+            }
+            primitive.vao.LinkAttrib(
+                vertexBuffers[buffer], location, accessor.components,
+                accessor.componentType, view.byteStride,
+                (void *)accessor.byteOffset,
+                accessor.normalized ? GL_TRUE : GL_FALSE);
+        }
+
+        if (source.indices >= 0) {
+            const Accessor &accessor = document.accessors[source.indices];
+            const BufferView &view = document.bufferViews[accessor.bufferView];
+            const uint8_t *indices =
+                (const uint8_t *)bin + view.byteOffset + accessor.byteOffset;
+            primitive.count = (GLsizei)accessor.count;
+            if (accessor.componentType == GL_UNSIGNED_BYTE) {
+                // The one layout GPUs handle badly: widen to 16 bit.
+                std::vector<uint16_t> wide(indices, indices + accessor.count);
+                elementBuffers.emplace_back(
+                    (const void *)wide.data(),
+                    (GLsizeiptr)(wide.size() * sizeof(uint16_t)));
+                convertedUploadBytes += wide.size() * sizeof(uint16_t);
+                primitive.indexType = GL_UNSIGNED_SHORT;
+            } else {
+                int &buffer = viewElementBuffer[accessor.bufferView];
+                if (buffer < 0) {
+                    buffer = (int)elementBuffers.size();
+                    elementBuffers.emplace_back(
+                        (const void *)(bin + view.byteOffset),
+                        (GLsizeiptr)view.byteLength);
+                    directUploadBytes += view.byteLength;
+                } else {
+                    elementBuffers[buffer].Bind();
+                }
+                primitive.indexType = (GLenum)accessor.componentType;
+                primitive.indexOffset = accessor.byteOffset;
+            }
+        }
+        primitive.vao.Unbind();
+
+        if (source.material >= 0 &&
+            (size_t)source.material < document.materials.size()) {
+            int texture = document.materials[source.material];
+            if (texture >= 0 && (size_t)texture < document.textures.size()) {
+                int image = document.textures[texture];
+                if (image >= 0 && (size_t)image < images.size()) {
+                    primitive.image = images[image];
+                }
+            }
+        }
+
+        if (primitive.mode == GL_TRIANGLES) {
+            triangleCount += primitive.count / 3;
+        } else if (primitive.mode == GL_TRIANGLE_STRIP ||
+                   primitive.mode == GL_TRIANGLE_FAN) {
+            triangleCount += primitive.count > 2 ? primitive.count - 2 : 0;
+        }
+        primitives.push_back(std::move(primitive));
+    }
+
+    if (primitives.empty()) {
+        LOG_ERROR("%s: no primitives to draw", path);
+    }
+}
+
+bool GlbModel::IsLoaded() const { return !primitives.empty(); }
+
+void GlbModel::Draw() {
+    glActiveTexture(GL_TEXTURE0);
+    for (Primitive &primitive : primitives) {
+        glBindTexture(GL_TEXTURE_2D, decoder.TextureID(primitive.image));
+        primitive.vao.Bind();
+        if (primitive.indexType != 0) {
+            glDrawElements(primitive.mode, primitive.count,
+                           primitive.indexType,
+                           (void *)primitive.indexOffset);
+        } else {
+            glDrawArrays(primitive.mode, 0, primitive.count);
+        }
+    }
+}
+
+void GlbModel::Delete() {
+    for (Primitive &primitive : primitives) {
+        primitive.vao.Delete();
+    }
+    for (VertexBufferObject &buffer : vertexBuffers) {
+        buffer.Delete();
+    }
+    for (ElementBufferObject &buffer : elementBuffers) {
+        buffer.Delete();
+    }
+    primitives.clear();
+    vertexBuffers.clear();
+    elementBuffers.clear();
+}
+
+size_t GlbModel::PrimitiveCount() const { return primitives.size(); }
+
+size_t GlbModel::TriangleCount() const { return triangleCount; }
+
+size_t GlbModel::DirectUploadBytes() const { return directUploadBytes; }
+
+size_t GlbModel::ConvertedUploadBytes() const { return convertedUploadBytes; }
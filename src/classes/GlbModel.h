@@ -0,0 +1,69 @@
+#ifndef GLB_MODEL_H
+#define GLB_MODEL_H
+
+#include "ElementBufferObject.h"
+#include "TextureDecoder.h"
+#include "VertexArrayObject.h"
+#include "VertexBufferObject.h"
+#include "../glad/glad.h"
+#include <cstddef>
+#include <vector>
+
+// A glTF 2.0 binary (.glb) model, uploaded to the GPU.
+//
+// The file is memory mapped and its JSON chunk read with JsonReader. Each
+// buffer view holding vertices or indices is uploaded straight from the
+// mapping into one VertexBufferObject or ElementBufferObject, and every
+// primitive's VAO reads the accessors in place with their own offsets,
+// strides and component types, so no vertex data is copied on the CPU. Only
+// 8 bit indices are widened to 16 bit first. Embedded images are handed to
+// a TextureDecoder and show up once it has uploaded them.
+//
+// Meshes are drawn in model space: nodes and their transforms are ignored,
+// as are sparse accessors and external (.gltf style) buffers and images.
+// POSITION, COLOR_0 and TEXCOORD_0 feed vertex shader locations 0, 1 and 2.
+class GlbModel {
+  public:
+    // Constructor that loads path, queueing its images on decoder. Check
+    // IsLoaded before drawing.
+    GlbModel(const char *path, TextureDecoder &decoder);
+
+    // Whether the file was read and at least one primitive uploaded.
+    bool IsLoaded() const;
+
+    // Draws every primitive with its base colour texture on unit 0. Leaves
+    // the last primitive's VAO bound.
+    void Draw();
+
+    // Deletes the VAOs and buffers. The textures belong to the decoder.
+    void Delete();
+
+    size_t PrimitiveCount() const;
+    size_t TriangleCount() const;
+
+    // Bytes uploaded straight from the file, and bytes that had to be
+    // converted first.
+    size_t DirectUploadBytes() const;
+    size_t ConvertedUploadBytes() const;
+
+  private:
+    struct Primitive {
+        VertexArrayObject vao;
+        GLenum mode;
+        GLsizei count;
+        // Index type, or 0 to draw the vertices in order.
+        GLenum indexType;
+        size_t indexOffset;
+        unsigned int image;
+    };
+
+    TextureDecoder &decoder;
+    std::vector<Primitive> primitives;
+    std::vector<VertexBufferObject> vertexBuffers;
+    std::vector<ElementBufferObject> elementBuffers;
+    size_t triangleCount = 0;
+    size_t directUploadBytes = 0;
+    size_t convertedUploadBytes = 0;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "GpuProfiler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+
+GpuProfiler::GpuProfiler(int historyLength) : historyLength(historyLength) {
+    for (Frame &frame : frames) {
+        glGenQueries(MAX_SCOPES * 2, frame.queries);
+        frame.scopes.reserve(MAX_SCOPES);
+    }
+
+    // Remember where the GPU clock is relative to the CPU clock so GPU scopes
+    // can be shown next to CPU scopes in a trace.
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    long long cpuNow = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    clockOffset = cpuNow - gpuNow;
+}
+
+void GpuProfiler::BeginFrame() {
+    // Resolve every older frame that is ready.
+    for (int i = 1; i < FRAMES_IN_FLIGHT; i++) {
+        Frame &frame = frames[(current + i) % FRAMES_IN_FLIGHT];
+        if (frame.pending) {
+            Resolve(frame, false);
+        }
+    }
+
+    // The slot being reused must be free; drop it rather than stall.
+    Frame &frame = frames[current];
+    if (frame.pending && !Resolve(frame, false)) {
+        frame.pending = false;
+        droppedFrames++;
+    }
+
+    frame.scopes.clear();
+    frame.lastQuery = -1;
+    openScopes.clear();
+}
+
+void GpuProfiler::BeginScope(const char *name) {
+    Frame &frame = frames[current];
+    int index = (int)frame.scopes.size();
+    if (index >= MAX_SCOPES) {
+        // Still track nesting so the matching EndScope is ignored.
+        openScopes.push_back(-1);
+        return;
+    }
+
+    frame.scopes.push_back({name, (int)openScopes.size()});
+    glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+    frame.lastQuery = index * 2;
+    openScopes.push_back(index);
+}
+
+void GpuProfiler::EndScope() {
+    if (openScopes.empty()) {
+        return;
+    }
+
+    int index = openScopes.back();
+    openScopes.pop_back();
+    if (index >= 0) {
+        Frame &frame = frames[current];
+        glQueryCounter(frame.queries[index * 2 + 1], GL_TIMESTAMP);
+        frame.lastQuery = index * 2 + 1;
+    }
+}
+
+void GpuProfiler::EndFrame() {
+    // Close anything left open so every begin query has an end query.
+    while (!openScopes.empty()) {
+        EndScope();
+    }
+
+    frames[current].pending = !frames[current].scopes.empty();
+    current = (current + 1) % FRAMES_IN_FLIGHT;
+}
+
+void GpuProfiler::Flush() {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        Frame &frame = frames[(current + i) % FRAMES_IN_FLIGHT];
+        if (frame.pending) {
+            Resolve(frame, true);
+        }
+    }
+}
+
+bool GpuProfiler::Resolve(Frame &frame, bool wait) {
+    // Queries complete in order, so the last one issued tells us about all.
+    GLuint lastQuery = frame.queries[frame.lastQuery];
+    if (!wait) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+
+    lastFrame.clear();
+    for (size_t i = 0; i < frame.scopes.size(); i++) {
+        ScopeResult result;
+        result.name = frame.scopes[i].name;
+        result.depth = frame.scopes[i].depth;
+        glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT,
+                              &result.start);
+        glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT,
+                              &result.end);
+        lastFrame.push_back(result);
+        TRACE_GPU_EVENT(result.name, ToCpuNanoseconds(result.start),
+                        ToCpuNanoseconds(result.end));
+
+        // Update the rolling window of this scope.
+        double milliseconds = (result.end - result.start) / 1.0e6;
+        std::vector<double> &window = history[result.name];
+        window.push_back(milliseconds);
+        if ((int)window.size() > historyLength) {
+            window.erase(window.begin());
+        }
+
+        ScopeStats &scopeStats = stats[result.name];
+        scopeStats.last = milliseconds;
+        scopeStats.samples = (int)window.size();
+        scopeStats.min = *std::min_element(window.begin(), window.end());
+        scopeStats.max = *std::max_element(window.begin(), window.end());
+        double sum = 0.0;
+        for (double sample : window) {
+            sum += sample;
+        }
+        scopeStats.average = sum / window.size();
+    }
+
+    frame.pending = false;
+    return true;
+}
+
+const std::vector<GpuProfiler::ScopeResult> &GpuProfiler::LastFrame() const {
+    return lastFrame;
+}
+
+const std::map<std::string, GpuProfiler::ScopeStats> &
+GpuProfiler::Stats() const {
+    return stats;
+}
+
+int GpuProfiler::DroppedFrames() const { return droppedFrames; }
+
+long long GpuProfiler::ToCpuNanoseconds(GLuint64 gpuTimestamp) const {
+    return (long long)gpuTimestamp + clockOffset;
+}
+
+void GpuProfiler::Delete() {
+    for (Frame &frame : frames) {
+        glDeleteQueries(MAX_SCOPES * 2, frame.queries);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "../glad/glad.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Measures GPU time of nested named regions with GL_TIMESTAMP query pairs.
+// Queries are kept in a ring several frames deep and only read back once
+// GL_QUERY_RESULT_AVAILABLE says so, so profiling never stalls the pipeline.
+class GpuProfiler {
+  public:
+    // Number of frames whose queries can be in flight at once.
+    static const int FRAMES_IN_FLIGHT = 4;
+
+    // Maximum number of scopes recorded per frame.
+    static const int MAX_SCOPES = 64;
+
+    // One resolved scope of a finished frame.
+    struct ScopeResult {
+        const char *name;
+        int depth;
+        // GPU timestamps in nanoseconds.
+        GLuint64 start;
+        GLuint64 end;
+    };
+
+    // Rolling statistics of one scope over the last historyLength frames,
+    // in milliseconds.
+    struct ScopeStats {
+        double last = 0.0;
+        double average = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        int samples = 0;
+    };
+
+    // Constructor that allocates the query ring.
+    GpuProfiler(int historyLength = 120);
+
+    // Starts a new frame, reading back any frame that has finished.
+    void BeginFrame();
+
+    // Opens a scope nested inside the currently open one.
+    void BeginScope(const char *name);
+
+    // Closes the innermost open scope.
+    void EndScope();
+
+    // Ends the frame.
+    void EndFrame();
+
+    // Waits for every frame in flight and reads it back.
+    void Flush();
+
+    // Scopes of the most recently resolved frame, in begin order.
+    const std::vector<ScopeResult> &LastFrame() const;
+
+    // Rolling statistics for every scope seen so far, keyed by name.
+    const std::map<std::string, ScopeStats> &Stats() const;
+
+    // Frames whose results were not ready when their slot was reused.
+    int DroppedFrames() const;
+
+    // Converts a GPU timestamp to nanoseconds on the CPU steady clock.
+    long long ToCpuNanoseconds(GLuint64 gpuTimestamp) const;
+
+    // Deletes the query objects.
+    void Delete();
+
+  private:
+    struct Scope {
+        const char *name;
+        int depth;
+    };
+
+    struct Frame {
+        GLuint queries[MAX_SCOPES * 2];
+        std::vector<Scope> scopes;
+        // Index in queries of the last timestamp issued this frame. With
+        // nesting it is an outer scope's end, not the last scope's.
+        int lastQuery = -1;
+        bool pending = false;
+    };
+
+    Frame frames[FRAMES_IN_FLIGHT];
+    int current = 0;
+    std::vector<int> openScopes;
+    int historyLength;
+    int droppedFrames = 0;
+    long long clockOffset = 0;
+
+    std::vector<ScopeResult> lastFrame;
+    std::map<std::string, ScopeStats> stats;
+    std::map<std::string, std::vector<double>> history;
+
+    bool Resolve(Frame &frame, bool wait);
+};
+
+// Opens a GPU scope for the lifetime of the object.
+class GpuScope {
+  public:
+    GpuScope(GpuProfiler &profiler, const char *name) : profiler(profiler) {
+        profiler.BeginScope(name);
+    }
+    ~GpuScope() { profiler.EndScope(); }
+
+  private:
+    GpuProfiler &profiler;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "HeadlessContext.h"
+#include "Log.h"
+#include <EGL/eglext.h>
+
+HeadlessContext::HeadlessContext(int majorVersion, int minorVersion,
+                                 bool debug) {
+    // Prefer the surfaceless platform so no X11/Wayland connection is made.
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        LOG_ERROR("Failed to initialise EGL display");
+        display = EGL_NO_DISPLAY;
+        return;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        LOG_ERROR("EGL display does not support desktop OpenGL");
+        return;
+    }
+
+    // No config is needed because we never create a surface.
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        majorVersion,
+        EGL_CONTEXT_MINOR_VERSION,
+        minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_DEBUG,
+        debug ? EGL_TRUE : EGL_FALSE,
+        EGL_NONE,
+    };
+    context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+                               contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        LOG_ERROR("Failed to create EGL context (error 0x%x)", eglGetError());
+        return;
+    }
+    LOG_INFO("Created headless OpenGL %d.%d context on EGL %d.%d",
+             majorVersion, minorVersion, major, minor);
+}
+
+bool HeadlessContext::IsValid() const {
+    return display != EGL_NO_DISPLAY && context != EGL_NO_CONTEXT;
+}
+
+bool HeadlessContext::MakeCurrent() {
+    return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+void *HeadlessContext::GetProcAddress(const char *name) {
+    return (void *)eglGetProcAddress(name);
+}
+
+void HeadlessContext::Delete() {
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+}
@@ -0,0 +1,31 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <EGL/egl.h>
+
+// OpenGL context without a window or display server, created through EGL's
+// surfaceless platform (e.g. Mesa llvmpipe on GPU-less hosts). There is no
+// default framebuffer, so rendering has to go into a FrameBufferObject.
+class HeadlessContext {
+  public:
+    // Constructor that creates a core profile context of the given version.
+    HeadlessContext(int majorVersion, int minorVersion, bool debug = false);
+
+    // Whether the display and context were created successfully.
+    bool IsValid() const;
+
+    // Makes the context current on the calling thread.
+    bool MakeCurrent();
+
+    // Function loader to hand to gladLoadGLLoader.
+    static void *GetProcAddress(const char *name);
+
+    // Destroys the context and terminates the display.
+    void Delete();
+
+  private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "InstanceBuffer.h"
+#include "Trace.h"
+#include <cstddef>
+#include <utility>
+
+namespace {
+
+const GLsizeiptr MATRIX_SIZE = 16 * sizeof(float);
+
+} // namespace
+
+InstanceBuffer::InstanceBuffer(unsigned int maxInstances,
+                               unsigned int framesInFlight)
+    : bytesPerFrame(maxInstances * MATRIX_SIZE),
+      framesInFlight(framesInFlight), fences(framesInFlight, nullptr) {
+    TRACE_SCOPE("InstanceBuffer::InstanceBuffer");
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, ID());
+    glBufferData(GL_ARRAY_BUFFER, bytesPerFrame * framesInFlight, NULL,
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstanceBuffer::~InstanceBuffer() { Delete(); }
+
+InstanceBuffer::InstanceBuffer(InstanceBuffer &&other) noexcept
+    : buffer(std::move(other.buffer)), bytesPerFrame(other.bytesPerFrame),
+      framesInFlight(other.framesInFlight), frame(other.frame),
+      mapped(std::exchange(other.mapped, nullptr)),
+      fences(std::move(other.fences)) {
+    other.fences.clear();
+}
+
+InstanceBuffer &InstanceBuffer::operator=(InstanceBuffer &&other) noexcept {
+    if (this != &other) {
+        Delete();
+        buffer = std::move(other.buffer);
+        bytesPerFrame = other.bytesPerFrame;
+        framesInFlight = other.framesInFlight;
+        frame = other.frame;
+        mapped = std::exchange(other.mapped, nullptr);
+        fences = std::move(other.fences);
+        other.fences.clear();
+    }
+    return *this;
+}
+
+float *InstanceBuffer::BeginFrame() {
+    // Only blocks if the GPU is more than framesInFlight frames behind.
+    if (fences[frame]) {
+        glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GL_TIMEOUT_IGNORED);
+        glDeleteSync(fences[frame]);
+        fences[frame] = nullptr;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, ID());
+    mapped = (float *)glMapBufferRange(
+        GL_ARRAY_BUFFER, frame * bytesPerFrame, bytesPerFrame,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return mapped;
+}
+
+void InstanceBuffer::Unmap(unsigned int count) {
+    if (mapped == nullptr) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, ID());
+    if (count > 0) {
+        glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, count * MATRIX_SIZE);
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mapped = nullptr;
+}
+
+void InstanceBuffer::LinkAttrib(VertexArrayObject &VAO, unsigned int layout) {
+    VAO.Bind();
+    glBindBuffer(GL_ARRAY_BUFFER, ID());
+    for (unsigned int column = 0; column < 4; column++) {
+        glVertexAttribPointer(
+            layout + column, 4, GL_FLOAT, GL_FALSE, MATRIX_SIZE,
+            (void *)(frame * bytesPerFrame + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(layout + column);
+        glVertexAttribDivisor(layout + column, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::EndFrame() {
+    Unmap(0);
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame = (frame + 1) % framesInFlight;
+}
+
+void InstanceBuffer::Delete() {
+    Unmap(0);
+    for (GLsync &fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    buffer.Reset();
+}
+
+GLuint InstanceBuffer::ID() const { return buffer.Name(); }
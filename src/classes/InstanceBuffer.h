@@ -0,0 +1,59 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include "GLHandlePool.h"
+#include "../glad/glad.h"
+#include "VertexArrayObject.h"
+#include <vector>
+
+// Per-instance model matrices, rewritten every frame. Like UniformRing, the
+// buffer holds one region per frame in flight so the CPU can fill frame N+1
+// while the GPU still draws frame N. Usage per frame:
+//   BeginFrame() -> write matrices -> Unmap() -> LinkAttrib() ->
+//   glDrawElementsInstanced() -> EndFrame().
+class InstanceBuffer {
+  public:
+    // Name of the buffer, 0 once deleted.
+    GLuint ID() const;
+
+    // Constructor that allocates room for maxInstances column-major 4x4
+    // float matrices for each frame in flight.
+    InstanceBuffer(unsigned int maxInstances,
+                   unsigned int framesInFlight = 3);
+
+    // Deletes whatever Delete() has not.
+    ~InstanceBuffer();
+
+    InstanceBuffer(InstanceBuffer &&other) noexcept;
+    InstanceBuffer &operator=(InstanceBuffer &&other) noexcept;
+
+    InstanceBuffer(const InstanceBuffer &) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+    // Waits until the GPU is done with this frame's region and maps it.
+    // Returns room for maxInstances matrices, 16 byte aligned.
+    float *BeginFrame();
+
+    // Flushes the first count matrices and unmaps the region.
+    void Unmap(unsigned int count);
+
+    // Points the mat4 attribute at layout (which takes layout to
+    // layout + 3) of the VAO at this frame's matrices, one per instance.
+    void LinkAttrib(VertexArrayObject &VAO, unsigned int layout);
+
+    // Fences the frame's region and advances to the next one.
+    void EndFrame();
+
+    // Deletes the buffer and any pending fences.
+    void Delete();
+
+  private:
+    GLBuffer buffer;
+    GLsizeiptr bytesPerFrame;
+    unsigned int framesInFlight;
+    unsigned int frame = 0;
+    float *mapped = nullptr;
+    std::vector<GLsync> fences;
+};
+
+#endif
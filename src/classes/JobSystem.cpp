@@ -0,0 +1,121 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace {
+
+// Set on workers and while the submitting thread runs chunks, so nested
+// ParallelFor calls run inline instead of deadlocking.
+thread_local bool insideJob = false;
+
+// Set on workers only.
+thread_local unsigned int threadIndex = 0;
+
+} // namespace
+
+JobSystem::JobSystem(unsigned int workerCount) {
+    if (workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int JobSystem::ThreadCount() const {
+    return (unsigned int)workers.size() + 1;
+}
+
+unsigned int JobSystem::ThreadIndex() { return threadIndex; }
+
+void JobSystem::ParallelFor(size_t itemCount, size_t itemGrain,
+                            const std::function<void(size_t, size_t)> &loop) {
+    itemGrain = std::max<size_t>(itemGrain, 1);
+    if (itemCount == 0) {
+        return;
+    }
+    if (insideJob || workers.empty() || itemCount <= itemGrain) {
+        loop(0, itemCount);
+        return;
+    }
+
+    // One loop at a time; callers from other threads queue up here.
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &loop;
+        count = itemCount;
+        grain = itemGrain;
+        chunkCount = (itemCount + itemGrain - 1) / itemGrain;
+        nextChunk.store(0, std::memory_order_relaxed);
+        chunksDone.store(0, std::memory_order_relaxed);
+        generation++;
+    }
+    wake.notify_all();
+
+    insideJob = true;
+    RunChunks();
+    insideJob = false;
+
+    // Wait for the last chunk and for every worker to let go of the job.
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] {
+        return chunksDone.load(std::memory_order_acquire) == chunkCount &&
+               activeWorkers == 0;
+    });
+    job = nullptr;
+}
+
+void JobSystem::RunChunks() {
+    for (;;) {
+        size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= chunkCount) {
+            return;
+        }
+
+        size_t begin = chunk * grain;
+        size_t end = std::min(begin + grain, count);
+        (*job)(begin, end);
+        chunksDone.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index) {
+    insideJob = true;
+    threadIndex = index;
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            if (job == nullptr) {
+                continue;
+            }
+            activeWorkers++;
+        }
+
+        RunChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        done.notify_one();
+    }
+}
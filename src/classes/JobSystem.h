@@ -0,0 +1,64 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small worker pool for data parallel loops over large arrays.
+class JobSystem {
+  public:
+    // Constructor that starts workerCount threads, or one fewer than the
+    // number of hardware threads if 0 (the calling thread helps out).
+    JobSystem(unsigned int workerCount = 0);
+
+    // Stops and joins the workers.
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Threads that run jobs, including the calling thread.
+    unsigned int ThreadCount() const;
+
+    // Index of the calling thread: 1 to ThreadCount() - 1 on a worker, 0 on
+    // any other thread. Lets jobs pick per-thread data without locking.
+    // The index is per thread, not per JobSystem: every thread that is not
+    // a worker shares 0, and workers of two JobSystems share 1 and up, so
+    // per-thread data indexed by it must serve one JobSystem and one other
+    // thread.
+    static unsigned int ThreadIndex();
+
+    // Calls job(begin, end) over [0, count) in chunks of at most grain items
+    // and returns once every chunk is done. Calls from inside a job run
+    // inline.
+    void ParallelFor(size_t count, size_t grain,
+                     const std::function<void(size_t, size_t)> &job);
+
+  private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::mutex submitMutex;
+
+    // The loop being run, set for the duration of ParallelFor.
+    const std::function<void(size_t, size_t)> *job = nullptr;
+    size_t count = 0;
+    size_t grain = 1;
+    std::atomic<size_t> nextChunk{0};
+    size_t chunkCount = 0;
+    std::atomic<size_t> chunksDone{0};
+    unsigned int activeWorkers = 0;
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    void WorkerLoop(unsigned int index);
+    void RunChunks();
+};
+
+#endif
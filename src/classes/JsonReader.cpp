@@ -0,0 +1,292 @@
+#include "JsonReader.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+class Parser {
+  public:
+    Parser(const char *text, size_t size, JsonHandler &handler)
+        : p(text), end(text + size), handler(handler) {}
+
+    bool Run() {
+        SkipSpaces();
+        if (!Value(0)) {
+            return false;
+        }
+        SkipSpaces();
+        return p == end;
+    }
+
+  private:
+    const char *p;
+    const char *end;
+    JsonHandler &handler;
+    std::string scratch;
+
+    void SkipSpaces() {
+        while (p < end &&
+               (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            p++;
+        }
+    }
+
+    bool Literal(const char *word) {
+        size_t length = strlen(word);
+        if ((size_t)(end - p) < length || memcmp(p, word, length) != 0) {
+            return false;
+        }
+        p += length;
+        return true;
+    }
+
+    bool Value(int depth) {
+        if (p >= end) {
+            return false;
+        }
+        switch (*p) {
+        case '{':
+            return depth < JsonReader::MAX_DEPTH && Object(depth + 1);
+        case '[':
+            return depth < JsonReader::MAX_DEPTH && Array(depth + 1);
+        case '"': {
+            const char *value;
+            size_t length;
+            return String(value, length) && handler.String(value, length);
+        }
+        case 't':
+            return Literal("true") && handler.Bool(true);
+        case 'f':
+            return Literal("false") && handler.Bool(false);
+        case 'n':
+            return Literal("null") && handler.Null();
+        default:
+            return Number();
+        }
+    }
+
+    bool Object(int depth) {
+        p++;
+        if (!handler.StartObject()) {
+            return false;
+        }
+        SkipSpaces();
+        if (p < end && *p == '}') {
+            p++;
+            return handler.EndObject();
+        }
+        while (true) {
+            const char *key;
+            size_t length;
+            SkipSpaces();
+            if (p >= end || *p != '"' || !String(key, length) ||
+                !handler.Key(key, length)) {
+                return false;
+            }
+            SkipSpaces();
+            if (p >= end || *p++ != ':') {
+                return false;
+            }
+            SkipSpaces();
+            if (!Value(depth)) {
+                return false;
+            }
+            SkipSpaces();
+            if (p >= end) {
+                return false;
+            }
+            if (*p == '}') {
+                p++;
+                return handler.EndObject();
+            }
+            if (*p++ != ',') {
+                return false;
+            }
+        }
+    }
+
+    bool Array(int depth) {
+        p++;
+        if (!handler.StartArray()) {
+            return false;
+        }
+        SkipSpaces();
+        if (p < end && *p == ']') {
+            p++;
+            return handler.EndArray();
+        }
+        while (true) {
+            SkipSpaces();
+            if (!Value(depth)) {
+                return false;
+            }
+            SkipSpaces();
+            if (p >= end) {
+                return false;
+            }
+            if (*p == ']') {
+                p++;
+                return handler.EndArray();
+            }
+            if (*p++ != ',') {
+                return false;
+            }
+        }
+    }
+
+    // Reads the string at p. Without escapes, value points into the text.
+    bool String(const char *&value, size_t &length) {
+        const char *start = ++p;
+        while (p < end && *p != '"' && *p != '\\') {
+            if ((unsigned char)*p < 0x20) {
+                return false;
+            }
+            p++;
+        }
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '"') {
+            value = start;
+            length = p++ - start;
+            return true;
+        }
+
+        scratch.assign(start, p);
+        while (p < end && *p != '"') {
+            if ((unsigned char)*p < 0x20) {
+                return false;
+            }
+            if (*p != '\\') {
+                scratch += *p++;
+                continue;
+            }
+            if (++p >= end) {
+                return false;
+            }
+            char escape = *p++;
+            switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                scratch += escape;
+                break;
+            case 'b':
+                scratch += '\b';
+                break;
+            case 'f':
+                scratch += '\f';
+                break;
+            case 'n':
+                scratch += '\n';
+                break;
+            case 'r':
+                scratch += '\r';
+                break;
+            case 't':
+                scratch += '\t';
+                break;
+            case 'u': {
+                unsigned int code;
+                if (!Hex4(code)) {
+                    return false;
+                }
+                // A surrogate pair encodes one code point above 0xffff.
+                if (code >= 0xd800 && code < 0xdc00) {
+                    unsigned int low;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+                        return false;
+                    }
+                    p += 2;
+                    if (!Hex4(low) || low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                AppendUtf8(code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        if (p >= end) {
+            return false;
+        }
+        p++;
+        value = scratch.data();
+        length = scratch.size();
+        return true;
+    }
+
+    bool Hex4(unsigned int &code) {
+        if (end - p < 4) {
+            return false;
+        }
+        code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = *p++;
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                code |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                code |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void AppendUtf8(unsigned int code) {
+        if (code < 0x80) {
+            scratch += (char)code;
+        } else if (code < 0x800) {
+            scratch += (char)(0xc0 | code >> 6);
+            scratch += (char)(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            scratch += (char)(0xe0 | code >> 12);
+            scratch += (char)(0x80 | (code >> 6 & 0x3f));
+            scratch += (char)(0x80 | (code & 0x3f));
+        } else {
+            scratch += (char)(0xf0 | code >> 18);
+            scratch += (char)(0x80 | (code >> 12 & 0x3f));
+            scratch += (char)(0x80 | (code >> 6 & 0x3f));
+            scratch += (char)(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool Number() {
+        // Copy the number out so strtod cannot run past the end.
+        const char *start = p;
+        if (p < end && *p == '-') {
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            return false;
+        }
+        while (p < end && (strchr("0123456789.eE+-", *p) != nullptr)) {
+            p++;
+        }
+        char buffer[64];
+        size_t length = p - start;
+        if (length >= sizeof(buffer)) {
+            return false;
+        }
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        char *parsed;
+        double value = strtod(buffer, &parsed);
+        return parsed == buffer + length && handler.Number(value);
+    }
+};
+
+} // namespace
+
+bool JsonReader::Parse(const char *text, size_t size, JsonHandler &handler) {
+    Parser parser(text, size, handler);
+    return parser.Run();
+}
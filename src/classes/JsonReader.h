@@ -0,0 +1,43 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <cstddef>
+
+// Receives the events of JsonReader::Parse. Every event returns whether to
+// keep parsing; the defaults ignore the event.
+class JsonHandler {
+  public:
+    virtual ~JsonHandler() = default;
+
+    virtual bool StartObject() { return true; }
+    virtual bool EndObject() { return true; }
+    virtual bool StartArray() { return true; }
+    virtual bool EndArray() { return true; }
+
+    // An object key, followed by the events of its value.
+    virtual bool Key(const char * /*key*/, size_t /*length*/) { return true; }
+
+    virtual bool String(const char * /*value*/, size_t /*length*/) {
+        return true;
+    }
+    virtual bool Number(double /*value*/) { return true; }
+    virtual bool Bool(bool /*value*/) { return true; }
+    virtual bool Null() { return true; }
+};
+
+// Streaming (SAX style) JSON parser: values are reported to a handler as
+// they are read, nothing is built in memory.
+namespace JsonReader {
+
+// Deepest nesting of objects and arrays accepted.
+const int MAX_DEPTH = 256;
+
+// Parses JSON text, which need not be null terminated. Keys and strings
+// without escapes point straight into text; escaped ones are decoded into
+// a buffer that is only valid during the call. Returns false on a syntax
+// error or when the handler stops.
+bool Parse(const char *text, size_t size, JsonHandler &handler);
+
+} // namespace JsonReader
+
+#endif
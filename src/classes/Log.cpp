@@ -0,0 +1,196 @@
+#include "Log.h"
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Log {
+
+namespace {
+
+// Bytes of pending messages each thread can hold. Must be a power of two.
+const size_t RING_SIZE = 64 * 1024;
+
+// Single producer (the owning thread), single consumer (the writer thread)
+// ring of variable sized records. Together the per-thread rings form the
+// multi producer queue the writer drains.
+struct Ring {
+    char data[RING_SIZE];
+    // Bytes ever written by the producer and read by the consumer.
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
+// A record with no format function marks padding up to the end of the ring.
+const uint32_t PADDING = 0;
+
+std::mutex ringsMutex;
+std::vector<Ring *> rings;
+std::atomic<uint64_t> dropped{0};
+
+std::once_flag startOnce;
+std::thread writer;
+std::atomic<bool> running{false};
+FILE *output = stdout;
+int64_t startTime = 0;
+
+Ring *LocalRing() {
+    // Rings are never freed so messages survive their thread exiting.
+    thread_local Ring *ring = [] {
+        Ring *newRing = new Ring;
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(newRing);
+        return newRing;
+    }();
+    return ring;
+}
+
+const char *LevelName(uint32_t level) {
+    switch (level) {
+    case Trace:
+        return "TRACE";
+    case Debug:
+        return "DEBUG";
+    case Info:
+        return "INFO ";
+    case Warn:
+        return "WARN ";
+    default:
+        return "ERROR";
+    }
+}
+
+// Formats every published record of one ring into text. Returns whether
+// anything was written.
+bool Drain(Ring *ring, std::string &text) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t head = ring->head.load(std::memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+
+    char line[1024];
+    while (tail != head) {
+        const char *record = ring->data + (tail & (RING_SIZE - 1));
+        Detail::RecordHeader header;
+        memcpy(&header, record, sizeof(header));
+
+        if (header.formatFunction != nullptr) {
+            int prefix = snprintf(line, sizeof(line), "[%10.6f] %s ",
+                                  (header.time - startTime) / 1.0e9,
+                                  LevelName(header.level));
+            int length = header.formatFunction(
+                header.format, record + sizeof(header), line + prefix,
+                sizeof(line) - prefix);
+            size_t total = prefix + (length < 0 ? 0 : length);
+            if (total > sizeof(line) - 1) {
+                total = sizeof(line) - 1;
+            }
+            text.append(line, total);
+            text.push_back('\n');
+        }
+
+        tail += header.size;
+    }
+
+    ring->tail.store(tail, std::memory_order_release);
+    return true;
+}
+
+// Drains every ring and writes the result with one fwrite.
+bool DrainAll() {
+    std::string text;
+    bool wrote = false;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (Ring *ring : rings) {
+            wrote |= Drain(ring, text);
+        }
+    }
+
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        text += "[log] dropped " + std::to_string(lost) + " messages\n";
+    }
+
+    if (!text.empty()) {
+        fwrite(text.data(), 1, text.size(), output);
+        fflush(output);
+    }
+    return wrote;
+}
+
+void WriterLoop() {
+    while (running.load(std::memory_order_acquire)) {
+        // Back off while idle instead of making producers signal us.
+        if (!DrainAll()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    DrainAll();
+}
+
+} // namespace
+
+void Start(FILE *stream) {
+    std::call_once(startOnce, [stream] {
+        output = stream;
+        startTime = Detail::Now();
+        running.store(true, std::memory_order_release);
+        writer = std::thread(WriterLoop);
+        std::atexit(Shutdown);
+    });
+}
+
+void Shutdown() {
+    if (running.exchange(false, std::memory_order_acq_rel)) {
+        writer.join();
+    }
+}
+
+uint64_t DroppedMessages() { return dropped.load(std::memory_order_relaxed); }
+
+namespace Detail {
+
+int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+char *Reserve(size_t size) {
+    Start();
+
+    Ring *ring = LocalRing();
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t tail = ring->tail.load(std::memory_order_acquire);
+    size_t offset = head & (RING_SIZE - 1);
+
+    // Records never wrap; pad to the start of the ring if needed.
+    size_t padding = offset + size > RING_SIZE ? RING_SIZE - offset : 0;
+    if (size > RING_SIZE / 2 || head + padding + size - tail > RING_SIZE) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    if (padding > 0) {
+        RecordHeader header = {(uint32_t)padding, PADDING, 0, nullptr,
+                               nullptr};
+        memcpy(ring->data + offset, &header, sizeof(header));
+        head += padding;
+        ring->head.store(head, std::memory_order_release);
+    }
+
+    return ring->data + (head & (RING_SIZE - 1));
+}
+
+void Commit(size_t size) {
+    Ring *ring = LocalRing();
+    ring->head.store(ring->head.load(std::memory_order_relaxed) + size,
+                     std::memory_order_release);
+}
+
+} // namespace Detail
+
+} // namespace Log
@@ -0,0 +1,210 @@
+#ifndef LOG_H
+#define LOG_H
+
+// Asynchronous leveled logger.
+//
+//   LOG_INFO("Loaded %s (%d x %d)", path, width, height);
+//
+// The calling thread only copies the format pointer and the arguments into
+// its own lock-free ring buffer; a background thread formats them with
+// printf rules and writes them out. Formats must be string literals. Strings
+// passed as arguments are copied, so temporaries are fine.
+//
+// Messages below LEARNGL_LOG_LEVEL are removed at compile time.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+#ifndef LEARNGL_LOG_LEVEL
+#define LEARNGL_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+namespace Log {
+
+enum Level {
+    Trace = LOG_LEVEL_TRACE,
+    Debug = LOG_LEVEL_DEBUG,
+    Info = LOG_LEVEL_INFO,
+    Warn = LOG_LEVEL_WARN,
+    Error = LOG_LEVEL_ERROR,
+};
+
+// Starts the background writer. Called automatically by the first message.
+void Start(FILE *output = stdout);
+
+// Writes every queued message and stops the background writer.
+void Shutdown();
+
+// Messages dropped because a thread's ring buffer was full.
+uint64_t DroppedMessages();
+
+namespace Detail {
+
+// Formats a record payload into out, returns the formatted length.
+typedef int (*FormatFunction)(const char *format, const char *payload,
+                              char *out, size_t capacity);
+
+// Reserves size bytes in the calling thread's ring, or returns nullptr when
+// the ring is full. Commit publishes the record to the writer thread.
+char *Reserve(size_t size);
+void Commit(size_t size);
+
+struct alignas(8) RecordHeader {
+    uint32_t size;
+    uint32_t level;
+    int64_t time;
+    FormatFunction formatFunction;
+    const char *format;
+};
+
+// How an argument is stored in a record. Strings are copied inline,
+// everything else must be trivially copyable and is stored as is.
+template <typename T, typename = void> struct Argument {
+    typedef T Stored;
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "log arguments must be trivially copyable or strings");
+
+    static size_t Size(const T &) { return sizeof(T); }
+    static void Encode(char *&out, const T &value) {
+        memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+    }
+    static T Decode(const char *&in) {
+        T value;
+        memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+struct StringArgument {
+    typedef const char *Stored;
+
+    static size_t Length(const char *value) {
+        return value ? strlen(value) : 6;
+    }
+    static size_t Size(const char *value) {
+        return sizeof(uint32_t) + Length(value) + 1;
+    }
+    static void Encode(char *&out, const char *value) {
+        uint32_t length = (uint32_t)Length(value);
+        memcpy(out, &length, sizeof(length));
+        memcpy(out + sizeof(length), value ? value : "(null)", length);
+        out[sizeof(length) + length] = '\0';
+        out += sizeof(length) + length + 1;
+    }
+    static const char *Decode(const char *&in) {
+        uint32_t length;
+        memcpy(&length, in, sizeof(length));
+        const char *value = in + sizeof(length);
+        in += sizeof(length) + length + 1;
+        return value;
+    }
+};
+
+template <> struct Argument<const char *> : StringArgument {};
+template <> struct Argument<char *> : StringArgument {};
+template <> struct Argument<std::string> : StringArgument {
+    static size_t Size(const std::string &value) {
+        return StringArgument::Size(value.c_str());
+    }
+    static void Encode(char *&out, const std::string &value) {
+        StringArgument::Encode(out, value.c_str());
+    }
+};
+
+template <typename T> using Decayed = typename std::decay<T>::type;
+
+template <typename... Args>
+int Format(const char *format, const char *payload, char *out,
+           size_t capacity) {
+    if constexpr (sizeof...(Args) == 0) {
+        (void)payload;
+        return snprintf(out, capacity, "%s", format);
+    } else {
+        // Braced initialisation decodes the arguments left to right.
+        std::tuple<typename Argument<Decayed<Args>>::Stored...> values{
+            Argument<Decayed<Args>>::Decode(payload)...};
+        return std::apply(
+            [&](auto... value) {
+                return snprintf(out, capacity, format, value...);
+            },
+            values);
+    }
+}
+
+int64_t Now();
+
+} // namespace Detail
+
+// Queues one message. Use the LOG_* macros instead of calling this directly.
+template <typename... Args>
+void Write(Level level, const char *format, const Args &...args) {
+    using namespace Detail;
+
+    size_t size = sizeof(RecordHeader);
+    ((size += Argument<Decayed<Args>>::Size(args)), ...);
+    // Whole header-sized slots, so a padding record always fits.
+    size = (size + sizeof(RecordHeader) - 1) / sizeof(RecordHeader) *
+           sizeof(RecordHeader);
+
+    char *record = Reserve(size);
+    if (record == nullptr) {
+        return;
+    }
+
+    RecordHeader header = {(uint32_t)size, (uint32_t)level, Now(),
+                           &Format<Args...>, format};
+    memcpy(record, &header, sizeof(header));
+
+    char *payload = record + sizeof(RecordHeader);
+    (Argument<Decayed<Args>>::Encode(payload, args), ...);
+    (void)payload;
+    Commit(size);
+}
+
+} // namespace Log
+
+#if LEARNGL_LOG_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) Log::Write(Log::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if LEARNGL_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::Write(Log::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LEARNGL_LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::Write(Log::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LEARNGL_LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::Write(Log::Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LEARNGL_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::Write(Log::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#include "MappedFile.h"
+#include "Log.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const char *path) {
+    file = open(path, O_RDONLY);
+    if (file < 0) {
+        LOG_ERROR("Failed to open %s", path);
+        return;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        LOG_ERROR("Failed to stat %s", path);
+        close(file);
+        file = -1;
+        return;
+    }
+    size = (size_t)status.st_size;
+    if (size == 0) {
+        return;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Failed to map %s", path);
+        close(file);
+        file = -1;
+        size = 0;
+        return;
+    }
+    data = (const char *)mapping;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        munmap((void *)data, size);
+    }
+    if (file >= 0) {
+        close(file);
+    }
+}
+
+bool MappedFile::IsOpen() const { return file >= 0; }
+
+const char *MappedFile::Data() const { return data; }
+
+size_t MappedFile::Size() const { return size; }
+
+void MappedFile::WillReadSequentially() const {
+    if (data != nullptr) {
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+        madvise((void *)data, size, MADV_WILLNEED);
+    }
+}
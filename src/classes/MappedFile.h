@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+// A read-only memory mapping of a whole file.
+//
+// The pages are only read from disk when first touched, so loaders can parse
+// straight out of the mapping without reading the file into a buffer first.
+class MappedFile {
+  public:
+    // Constructor that maps path. Check IsOpen before using the data.
+    MappedFile(const char *path);
+
+    // Unmaps the file.
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Whether the file was opened and mapped. Empty files map to no data.
+    bool IsOpen() const;
+
+    const char *Data() const;
+    size_t Size() const;
+
+    // Hints that the whole file will be read front to back soon.
+    void WillReadSequentially() const;
+
+  private:
+    int file = -1;
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <vector>
+
+// A triangle mesh with vertices interleaved in the layout of the demo's
+// vertex shader: position (3 floats), colour (3) and texture coordinate
+// (2). Ready to hand to VertexBufferObject and ElementBufferObject.
+struct Mesh {
+    static const size_t VERTEX_FLOATS = 8;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    size_t VertexCount() const { return vertices.size() / VERTEX_FLOATS; }
+    size_t TriangleCount() const { return indices.size() / 3; }
+};
+
+#endif
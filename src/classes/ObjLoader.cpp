@@ -0,0 +1,548 @@
+#include "ObjLoader.h"
+#include "Log.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// No texture coordinate, in a corner's texcoord.
+const int32_t NO_TEXCOORD = -1;
+
+// One face corner: 0 based position and texture coordinate indices.
+struct Corner {
+    int32_t position;
+    int32_t texcoord;
+};
+
+// Everything parsed from one chunk of lines. Indices are final once the
+// chunks before it are counted: relative (negative) indices are stored
+// relative to the chunk's first vertex and listed in relativePositions
+// and relativeTexcoords.
+struct Chunk {
+    const char *begin;
+    const char *end;
+
+    // Six floats per position (x, y, z, r, g, b), two per texcoord.
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    std::vector<Corner> corners;
+    std::vector<uint32_t> relativePositions;
+    std::vector<uint32_t> relativeTexcoords;
+
+    // Counts of the chunks before this one.
+    size_t positionBase;
+    size_t texcoordBase;
+    size_t cornerBase;
+
+    // After deduplication: the chunk's unique (position, texcoord) keys,
+    // each corner's index into them, and their final vertex indices.
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> localIndices;
+    std::vector<uint32_t> remap;
+
+    // First line that failed to parse, if any.
+    const char *error;
+};
+
+// Open addressing hash map from vertex keys to indices.
+class KeyTable {
+  public:
+    explicit KeyTable(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) {
+            capacity *= 2;
+        }
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t bits = capacity; bits > 1; bits /= 2) {
+            shift--;
+        }
+        keys.assign(capacity, EMPTY);
+        values.resize(capacity);
+    }
+
+    // Returns the index of key, adding it with value if it is new.
+    uint32_t Insert(uint64_t key, uint32_t value, bool &inserted) {
+        size_t slot = (size_t)((key * 0x9e3779b97f4a7c15ull) >> shift);
+        while (true) {
+            if (keys[slot] == key) {
+                inserted = false;
+                return values[slot];
+            }
+            if (keys[slot] == EMPTY) {
+                keys[slot] = key;
+                values[slot] = value;
+                inserted = true;
+                return value;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+  private:
+    static constexpr uint64_t EMPTY = ~0ull;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> values;
+    size_t mask;
+    int shift;
+};
+
+// The key of a corner; texcoord NO_TEXCOORD maps to 0.
+inline uint64_t KeyOf(const Corner &corner) {
+    return (uint64_t)(uint32_t)corner.position << 32 |
+           (uint32_t)(corner.texcoord + 1);
+}
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline const char *SkipSpaces(const char *p, const char *end) {
+    while (p < end && IsSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline const char *NextLine(const char *p, const char *end) {
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    return newline != nullptr ? newline + 1 : end;
+}
+
+// Parses a decimal float at p. Returns the end of the number, or nullptr if
+// there is none. Plain decimals are converted directly; anything else
+// (inf, nan, hex) goes through strtof.
+const char *ParseFloat(const char *p, const char *end, float &out) {
+    static const double POWERS_OF_TEN[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; p < end && IsDigit(*p); p++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && IsDigit(*p); p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any) {
+        // Not a plain decimal; copy it out so strtof stops at the end.
+        char buffer[64];
+        size_t length = std::min<size_t>(end - start, sizeof(buffer) - 1);
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        char *parsed;
+        out = strtof(buffer, &parsed);
+        return parsed == buffer ? nullptr : start + (parsed - buffer);
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *exponentStart = p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        if (p < end && IsDigit(*p)) {
+            int value = 0;
+            for (; p < end && IsDigit(*p); p++) {
+                value = std::min(value * 10 + (*p - '0'), 100000);
+            }
+            exponent += negativeExponent ? -value : value;
+        } else {
+            p = exponentStart;
+        }
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0 && exponent >= -22) {
+        value /= POWERS_OF_TEN[-exponent];
+    } else if (exponent > 0 && exponent <= 22) {
+        value *= POWERS_OF_TEN[exponent];
+    } else if (exponent != 0) {
+        value *= std::pow(10.0, exponent);
+    }
+    out = (float)(negative ? -value : value);
+    return p;
+}
+
+// Parses an integer at p, or returns nullptr.
+inline const char *ParseInt(const char *p, const char *end, int64_t &out) {
+    bool negative = p < end && *p == '-';
+    if (negative) {
+        p++;
+    }
+    if (p >= end || !IsDigit(*p)) {
+        return nullptr;
+    }
+    int64_t value = 0;
+    for (; p < end && IsDigit(*p); p++) {
+        value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+    }
+    out = negative ? -value : value;
+    return p;
+}
+
+// Turns a 1 based or negative OBJ index into a 0 based one relative to the
+// chunk when relative is set. Returns false for 0.
+inline bool ResolveIndex(int64_t index, size_t count, int32_t &out,
+                         bool &relative) {
+    if (index > 0) {
+        out = (int32_t)(index - 1);
+        relative = false;
+        return true;
+    }
+    if (index < 0) {
+        out = (int32_t)((int64_t)count + index);
+        relative = true;
+        return true;
+    }
+    return false;
+}
+
+// Parses one face line after the "f".
+bool ParseFace(const char *p, const char *end, Chunk &chunk) {
+    Corner polygon[64];
+    bool relativePosition[64], relativeTexcoord[64];
+    int count = 0;
+    size_t positionCount = chunk.positions.size() / 6;
+    size_t texcoordCount = chunk.texcoords.size() / 2;
+
+    while (true) {
+        p = SkipSpaces(p, end);
+        if (p >= end || *p == '\n' || *p == '#') {
+            break;
+        }
+        if (count == 64) {
+            return false;
+        }
+
+        int64_t index;
+        p = ParseInt(p, end, index);
+        if (p == nullptr ||
+            !ResolveIndex(index, positionCount, polygon[count].position,
+                          relativePosition[count])) {
+            return false;
+        }
+        polygon[count].texcoord = NO_TEXCOORD;
+        relativeTexcoord[count] = false;
+        if (p < end && *p == '/') {
+            p++;
+            if (p < end && *p != '/') {
+                p = ParseInt(p, end, index);
+                if (p == nullptr ||
+                    !ResolveIndex(index, texcoordCount,
+                                  polygon[count].texcoord,
+                                  relativeTexcoord[count])) {
+                    return false;
+                }
+            }
+            // Skip the normal index.
+            if (p < end && *p == '/') {
+                const char *next = ParseInt(++p, end, index);
+                p = next != nullptr ? next : p;
+            }
+        }
+        if (p < end && !IsSpace(*p) && *p != '\n') {
+            return false;
+        }
+        count++;
+    }
+    // Points and lines written as faces are dropped.
+    if (count < 3) {
+        return count > 0;
+    }
+
+    // Triangle fan around the first corner.
+    for (int i = 1; i + 1 < count; i++) {
+        for (int corner : {0, i, i + 1}) {
+            uint32_t position = (uint32_t)chunk.corners.size();
+            if (relativePosition[corner]) {
+                chunk.relativePositions.push_back(position);
+            }
+            if (relativeTexcoord[corner]) {
+                chunk.relativeTexcoords.push_back(position);
+            }
+            chunk.corners.push_back(polygon[corner]);
+        }
+    }
+    return true;
+}
+
+void ParseChunk(Chunk &chunk) {
+    const char *p = chunk.begin, *end = chunk.end;
+    while (p < end) {
+        const char *line = p;
+        p = SkipSpaces(p, end);
+        if (p + 1 < end && p[0] == 'v' && IsSpace(p[1])) {
+            float values[7];
+            int count = 0;
+            p += 2;
+            while (count < 7) {
+                p = SkipSpaces(p, end);
+                const char *next =
+                    p < end && *p != '\n' && *p != '#'
+                        ? ParseFloat(p, end, values[count])
+                        : nullptr;
+                if (next == nullptr) {
+                    break;
+                }
+                p = next;
+                count++;
+            }
+            if (count < 3) {
+                chunk.error = line;
+                return;
+            }
+            // x y z [w] or x y z r g b.
+            bool coloured = count == 6;
+            chunk.positions.insert(chunk.positions.end(),
+                                   {values[0], values[1], values[2],
+                                    coloured ? values[3] : 1.0f,
+                                    coloured ? values[4] : 1.0f,
+                                    coloured ? values[5] : 1.0f});
+        } else if (p + 2 < end && p[0] == 'v' && p[1] == 't' &&
+                   IsSpace(p[2])) {
+            float u = 0.0f, v = 0.0f;
+            p = ParseFloat(SkipSpaces(p + 3, end), end, u);
+            if (p == nullptr) {
+                chunk.error = line;
+                return;
+            }
+            // v is optional.
+            const char *next = SkipSpaces(p, end);
+            if (next < end && *next != '\n' && *next != '#') {
+                p = ParseFloat(next, end, v);
+                if (p == nullptr) {
+                    chunk.error = line;
+                    return;
+                }
+            }
+            chunk.texcoords.push_back(u);
+            chunk.texcoords.push_back(v);
+        } else if (p + 1 < end && p[0] == 'f' && IsSpace(p[1])) {
+            const char *lineEnd = NextLine(p, end);
+            if (!ParseFace(p + 2, lineEnd, chunk)) {
+                chunk.error = line;
+                return;
+            }
+            p = lineEnd;
+            continue;
+        }
+        // Normals, comments, groups, materials and blank lines.
+        p = NextLine(p, end);
+    }
+}
+
+// Deduplicates the chunk's corners against each other.
+bool DeduplicateChunk(Chunk &chunk, size_t positionCount,
+                      size_t texcoordCount) {
+    for (uint32_t corner : chunk.relativePositions) {
+        chunk.corners[corner].position += (int32_t)chunk.positionBase;
+    }
+    for (uint32_t corner : chunk.relativeTexcoords) {
+        chunk.corners[corner].texcoord += (int32_t)chunk.texcoordBase;
+    }
+
+    KeyTable table(chunk.corners.size());
+    chunk.localIndices.resize(chunk.corners.size());
+    for (size_t i = 0; i < chunk.corners.size(); i++) {
+        const Corner &corner = chunk.corners[i];
+        if (corner.position < 0 || (size_t)corner.position >= positionCount ||
+            corner.texcoord < NO_TEXCOORD ||
+            corner.texcoord >= (int64_t)texcoordCount) {
+            return false;
+        }
+        bool inserted;
+        uint64_t key = KeyOf(corner);
+        chunk.localIndices[i] =
+            table.Insert(key, (uint32_t)chunk.keys.size(), inserted);
+        if (inserted) {
+            chunk.keys.push_back(key);
+        }
+    }
+    std::vector<Corner>().swap(chunk.corners);
+    return true;
+}
+
+// Runs job(i) for every i in [0, count), on jobs if given.
+template <typename Job>
+void ForEach(JobSystem *jobs, size_t count, const Job &job) {
+    auto range = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            job(i);
+        }
+    };
+    if (jobs != nullptr) {
+        jobs->ParallelFor(count, 1, range);
+    } else {
+        range(0, count);
+    }
+}
+
+// 1 based line number of p, for error messages.
+size_t LineNumber(const char *text, const char *p) {
+    return std::count(text, p, '\n') + 1;
+}
+
+} // namespace
+
+bool ObjLoader::Load(const char *path, Mesh &mesh, JobSystem *jobs) {
+    TRACE_SCOPE("ObjLoader::Load");
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    file.WillReadSequentially();
+    if (!Parse(file.Data(), file.Size(), mesh, jobs)) {
+        LOG_ERROR("Failed to load %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool ObjLoader::Parse(const char *text, size_t size, Mesh &mesh,
+                      JobSystem *jobs) {
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    // Line aligned chunks of about CHUNK_SIZE bytes.
+    std::vector<Chunk> chunks;
+    const char *end = text + size;
+    for (const char *begin = text; begin < end;) {
+        const char *chunkEnd =
+            end - begin > (ptrdiff_t)CHUNK_SIZE
+                ? NextLine(begin + CHUNK_SIZE, end)
+                : end;
+        Chunk chunk = {};
+        chunk.begin = begin;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+        begin = chunkEnd;
+    }
+
+    {
+        TRACE_SCOPE("parse");
+        ForEach(jobs, chunks.size(), [&](size_t i) { ParseChunk(chunks[i]); });
+    }
+
+    size_t positionCount = 0, texcoordCount = 0, cornerCount = 0;
+    for (Chunk &chunk : chunks) {
+        if (chunk.error != nullptr) {
+            LOG_ERROR("OBJ parse error on line %zu",
+                      LineNumber(text, chunk.error));
+            return false;
+        }
+        chunk.positionBase = positionCount;
+        chunk.texcoordBase = texcoordCount;
+        chunk.cornerBase = cornerCount;
+        positionCount += chunk.positions.size() / 6;
+        texcoordCount += chunk.texcoords.size() / 2;
+        cornerCount += chunk.corners.size();
+    }
+    if (positionCount > INT32_MAX || cornerCount > UINT32_MAX) {
+        LOG_ERROR("OBJ has too many vertices");
+        return false;
+    }
+
+    // Gather the attributes into flat arrays, then dedup each chunk.
+    std::vector<float> positions(positionCount * 6);
+    std::vector<float> texcoords(texcoordCount * 2);
+    std::vector<char> valid(chunks.size());
+    {
+        TRACE_SCOPE("deduplicate");
+        ForEach(jobs, chunks.size(), [&](size_t i) {
+            Chunk &chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(),
+                      positions.begin() + chunk.positionBase * 6);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+                      texcoords.begin() + chunk.texcoordBase * 2);
+            std::vector<float>().swap(chunk.positions);
+            std::vector<float>().swap(chunk.texcoords);
+            valid[i] = DeduplicateChunk(chunk, positionCount, texcoordCount);
+        });
+    }
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (!valid[i]) {
+            LOG_ERROR("OBJ face index out of range near line %zu",
+                      LineNumber(text, chunks[i].begin));
+            return false;
+        }
+    }
+
+    // Merge the unique keys of every chunk in order, so vertices are
+    // numbered by first use whatever the chunking.
+    std::vector<uint64_t> keys;
+    {
+        TRACE_SCOPE("merge");
+        size_t uniqueCount = 0;
+        for (const Chunk &chunk : chunks) {
+            uniqueCount += chunk.keys.size();
+        }
+        KeyTable table(uniqueCount);
+        for (Chunk &chunk : chunks) {
+            chunk.remap.resize(chunk.keys.size());
+            for (size_t i = 0; i < chunk.keys.size(); i++) {
+                bool inserted;
+                chunk.remap[i] = table.Insert(
+                    chunk.keys[i], (uint32_t)keys.size(), inserted);
+                if (inserted) {
+                    keys.push_back(chunk.keys[i]);
+                }
+            }
+            std::vector<uint64_t>().swap(chunk.keys);
+        }
+    }
+
+    TRACE_SCOPE("emit");
+    mesh.indices.resize(cornerCount);
+    ForEach(jobs, chunks.size(), [&](size_t i) {
+        Chunk &chunk = chunks[i];
+        unsigned int *out = mesh.indices.data() + chunk.cornerBase;
+        for (size_t corner = 0; corner < chunk.localIndices.size();
+             corner++) {
+            out[corner] = chunk.remap[chunk.localIndices[corner]];
+        }
+    });
+
+    mesh.vertices.resize(keys.size() * Mesh::VERTEX_FLOATS);
+    auto emit = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float *out = mesh.vertices.data() + i * Mesh::VERTEX_FLOATS;
+            const float *position = positions.data() + (keys[i] >> 32) * 6;
+            std::copy(position, position + 6, out);
+            uint32_t texcoord = (uint32_t)keys[i];
+            out[6] = texcoord != 0 ? texcoords[(texcoord - 1) * 2] : 0.0f;
+            out[7] = texcoord != 0 ? texcoords[(texcoord - 1) * 2 + 1] : 0.0f;
+        }
+    };
+    if (jobs != nullptr) {
+        jobs->ParallelFor(keys.size(), 64 * 1024, emit);
+    } else {
+        emit(0, keys.size());
+    }
+    return true;
+}
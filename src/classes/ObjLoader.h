@@ -0,0 +1,32 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "JobSystem.h"
+#include "Mesh.h"
+#include <cstddef>
+
+// Wavefront OBJ loader.
+//
+// The file is memory mapped and split into line aligned chunks that are
+// parsed in parallel on a JobSystem. Each chunk deduplicates its own
+// (position, texture coordinate) pairs, and only the unique pairs go
+// through the final, serial merge, so the serial part is a fraction of the
+// corner count. Polygons are triangulated as fans. Normals, materials and
+// groups are skipped; "v x y z r g b" vertex colours are kept, other
+// vertices are white.
+namespace ObjLoader {
+
+// Bytes of text parsed per job.
+const size_t CHUNK_SIZE = 1 << 20;
+
+// Loads the OBJ file at path into mesh. Returns false and logs the reason
+// on failure. Runs on jobs if given.
+bool Load(const char *path, Mesh &mesh, JobSystem *jobs = nullptr);
+
+// Parses OBJ text, which need not be null terminated.
+bool Parse(const char *text, size_t size, Mesh &mesh,
+           JobSystem *jobs = nullptr);
+
+} // namespace ObjLoader
+
+#endif
@@ -0,0 +1,324 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE 1
+#endif
+
+namespace {
+
+// Vertices with a smaller clip space w are treated as crossing the near
+// plane.
+const float MIN_W = 1e-5f;
+
+// Transforms a point by a column-major matrix.
+inline void TransformPoint(const float *m, float x, float y, float z,
+                           float clip[4]) {
+    for (int row = 0; row < 4; row++) {
+        clip[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row];
+    }
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : width(width), height(height) {
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    tileTriangles.resize(tilesX * tilesY);
+
+    int levelWidth = tilesX * TILE_SIZE;
+    int levelHeight = tilesY * TILE_SIZE;
+    for (;;) {
+        levels.push_back(std::vector<float>(levelWidth * levelHeight, 1.0f));
+        levelWidths.push_back(levelWidth);
+        levelHeights.push_back(levelHeight);
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+    memset(viewProjection, 0, sizeof(viewProjection));
+}
+
+void OcclusionCuller::BeginFrame(const float *matrix) {
+    memcpy(viewProjection, matrix, sizeof(viewProjection));
+    triangles.clear();
+}
+
+void OcclusionCuller::AddOccluder(const float *positions, size_t vertexCount,
+                                  const unsigned int *indices,
+                                  size_t indexCount) {
+    // Project every vertex once; w <= MIN_W marks vertices behind the eye.
+    std::vector<float> screen(vertexCount * 4);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float *position = positions + i * 3;
+        float clip[4];
+        TransformPoint(viewProjection, position[0], position[1], position[2],
+                       clip);
+        float *out = &screen[i * 4];
+        out[3] = clip[3];
+        if (clip[3] > MIN_W) {
+            out[0] = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+            out[1] = (clip[1] / clip[3] * 0.5f + 0.5f) * height;
+            out[2] = clip[2] / clip[3] * 0.5f + 0.5f;
+        }
+    }
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const float *v[3] = {&screen[indices[i] * 4],
+                             &screen[indices[i + 1] * 4],
+                             &screen[indices[i + 2] * 4]};
+        if (v[0][3] <= MIN_W || v[1][3] <= MIN_W || v[2][3] <= MIN_W) {
+            continue;
+        }
+
+        // Both faces are drawn; wind every triangle the same way so the
+        // edge functions are positive inside.
+        float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) -
+                     (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            std::swap(v[1], v[2]);
+        }
+
+        Triangle triangle;
+        float minX = INFINITY, minY = INFINITY;
+        float maxX = -INFINITY, maxY = -INFINITY;
+        for (int corner = 0; corner < 3; corner++) {
+            triangle.x[corner] = v[corner][0];
+            triangle.y[corner] = v[corner][1];
+            triangle.z[corner] = v[corner][2];
+            minX = std::min(minX, v[corner][0]);
+            minY = std::min(minY, v[corner][1]);
+            maxX = std::max(maxX, v[corner][0]);
+            maxY = std::max(maxY, v[corner][1]);
+        }
+
+        // Pixels whose centre may be covered, clipped to the screen.
+        triangle.minX = std::max((int)std::floor(minX), 0);
+        triangle.minY = std::max((int)std::floor(minY), 0);
+        triangle.maxX = std::min((int)std::ceil(maxX), width - 1);
+        triangle.maxY = std::min((int)std::ceil(maxY), height - 1);
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            continue;
+        }
+        triangles.push_back(triangle);
+    }
+}
+
+void OcclusionCuller::Rasterize(JobSystem *jobs) {
+    for (std::vector<unsigned int> &bin : tileTriangles) {
+        bin.clear();
+    }
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const Triangle &triangle = triangles[i];
+        for (int tileY = triangle.minY / TILE_SIZE;
+             tileY <= triangle.maxY / TILE_SIZE; tileY++) {
+            for (int tileX = triangle.minX / TILE_SIZE;
+                 tileX <= triangle.maxX / TILE_SIZE; tileX++) {
+                tileTriangles[tileY * tilesX + tileX].push_back(
+                    (unsigned int)i);
+            }
+        }
+    }
+
+    // Tiles own disjoint pixels, so they need no synchronisation.
+    auto rasterizeTiles = [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            RasterizeTile((int)tile);
+        }
+    };
+    if (jobs != nullptr) {
+        jobs->ParallelFor(tileTriangles.size(), 1, rasterizeTiles);
+    } else {
+        rasterizeTiles(0, tileTriangles.size());
+    }
+
+    // Each level only reads the one below, so its rows run in parallel.
+    for (size_t level = 1; level < levels.size(); level++) {
+        auto buildRows = [this, level](size_t begin, size_t end) {
+            BuildLevel((int)level, begin, end);
+        };
+        if (jobs != nullptr) {
+            jobs->ParallelFor(levelHeights[level], 16, buildRows);
+        } else {
+            buildRows(0, levelHeights[level]);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTile(int tile) {
+    int stride = levelWidths[0];
+    int tileMinX = (tile % tilesX) * TILE_SIZE;
+    int tileMinY = (tile / tilesX) * TILE_SIZE;
+
+    // Clear the tile to the far plane.
+    for (int y = tileMinY; y < tileMinY + TILE_SIZE; y++) {
+        std::fill(&levels[0][y * stride + tileMinX],
+                  &levels[0][y * stride + tileMinX + TILE_SIZE], 1.0f);
+    }
+
+    for (unsigned int index : tileTriangles[tile]) {
+        const Triangle &t = triangles[index];
+
+        // Edge functions and depth as planes a * x + b * y + c, evaluated
+        // at pixel centres.
+        float edgeA[3], edgeB[3], edgeC[3];
+        for (int edge = 0; edge < 3; edge++) {
+            int from = (edge + 1) % 3, to = (edge + 2) % 3;
+            edgeA[edge] = t.y[from] - t.y[to];
+            edgeB[edge] = t.x[to] - t.x[from];
+            edgeC[edge] = t.x[from] * t.y[to] - t.y[from] * t.x[to];
+        }
+        float area = edgeC[0] + edgeC[1] + edgeC[2];
+        float depthA = 0.0f, depthB = 0.0f, depthC = 0.0f;
+        for (int corner = 0; corner < 3; corner++) {
+            depthA += edgeA[corner] * t.z[corner] / area;
+            depthB += edgeB[corner] * t.z[corner] / area;
+            depthC += edgeC[corner] * t.z[corner] / area;
+        }
+
+        int minX = std::max(t.minX, tileMinX) & ~3;
+        int maxX = std::min(t.maxX, tileMinX + TILE_SIZE - 1);
+        int minY = std::max(t.minY, tileMinY);
+        int maxY = std::min(t.maxY, tileMinY + TILE_SIZE - 1);
+
+        for (int y = minY; y <= maxY; y++) {
+            float centreY = y + 0.5f;
+            float *row = &levels[0][y * stride];
+            int x = minX;
+#ifdef OCCLUSION_CULLER_SSE
+            const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 rowEdge[3], stepEdge[3];
+            for (int edge = 0; edge < 3; edge++) {
+                rowEdge[edge] = _mm_set1_ps(edgeB[edge] * centreY + edgeC[edge]);
+                stepEdge[edge] = _mm_set1_ps(edgeA[edge]);
+            }
+            __m128 rowDepth = _mm_set1_ps(depthB * centreY + depthC);
+            __m128 stepDepth = _mm_set1_ps(depthA);
+            for (; x <= maxX; x += 4) {
+                __m128 centreX =
+                    _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int edge = 0; edge < 3; edge++) {
+                    __m128 value = _mm_add_ps(
+                        _mm_mul_ps(stepEdge[edge], centreX), rowEdge[edge]);
+                    inside = _mm_and_ps(inside,
+                                        _mm_cmpge_ps(value, _mm_setzero_ps()));
+                }
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                __m128 z =
+                    _mm_add_ps(_mm_mul_ps(stepDepth, centreX), rowDepth);
+                __m128 stored = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(stored, z);
+                _mm_storeu_ps(row + x,
+                              _mm_or_ps(_mm_and_ps(inside, nearest),
+                                        _mm_andnot_ps(inside, stored)));
+            }
+#endif
+            for (; x <= maxX; x++) {
+                float centreX = x + 0.5f;
+                bool inside = true;
+                for (int edge = 0; edge < 3; edge++) {
+                    inside &= edgeA[edge] * centreX + edgeB[edge] * centreY +
+                                  edgeC[edge] >=
+                              0.0f;
+                }
+                if (inside) {
+                    float z = depthA * centreX + depthB * centreY + depthC;
+                    row[x] = std::min(row[x], z);
+                }
+            }
+        }
+    }
+}
+
+void OcclusionCuller::BuildLevel(int level, size_t firstRow, size_t lastRow) {
+    const std::vector<float> &below = levels[level - 1];
+    std::vector<float> &out = levels[level];
+    int belowWidth = levelWidths[level - 1];
+    int belowHeight = levelHeights[level - 1];
+    int levelWidth = levelWidths[level];
+
+    for (size_t y = firstRow; y < lastRow; y++) {
+        // Odd sizes repeat the last row or column.
+        size_t y0 = y * 2;
+        size_t y1 = std::min<size_t>(y0 + 1, belowHeight - 1);
+        for (int x = 0; x < levelWidth; x++) {
+            int x0 = x * 2;
+            int x1 = std::min(x0 + 1, belowWidth - 1);
+            out[y * levelWidth + x] =
+                std::max(std::max(below[y0 * belowWidth + x0],
+                                  below[y0 * belowWidth + x1]),
+                         std::max(below[y1 * belowWidth + x0],
+                                  below[y1 * belowWidth + x1]));
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const float min[3], const float max[3]) const {
+    float minX = INFINITY, minY = INFINITY, nearest = INFINITY;
+    float maxX = -INFINITY, maxY = -INFINITY;
+    for (int corner = 0; corner < 8; corner++) {
+        float clip[4];
+        TransformPoint(viewProjection, corner & 1 ? max[0] : min[0],
+                       corner & 2 ? max[1] : min[1],
+                       corner & 4 ? max[2] : min[2], clip);
+        if (clip[3] <= MIN_W) {
+            // Crosses the near plane: too close to say.
+            return true;
+        }
+
+        float x = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+        float y = (clip[1] / clip[3] * 0.5f + 0.5f) * height;
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip[2] / clip[3] * 0.5f + 0.5f);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height ||
+        nearest > 1.0f) {
+        return false;
+    }
+
+    // Occluders are sampled at pixel centres, so a silhouette pixel can be
+    // marked covered while part of it is not. Growing the box by a pixel
+    // takes in the uncovered neighbour and keeps the test conservative.
+    int x0 = std::max((int)std::floor(minX) - 1, 0);
+    int y0 = std::max((int)std::floor(minY) - 1, 0);
+    int x1 = std::min((int)std::floor(maxX) + 1, width - 1);
+    int y1 = std::min((int)std::floor(maxY) + 1, height - 1);
+
+    // The finest level where the box covers at most 4x4 texels.
+    int level = 0;
+    while (level + 1 < (int)levels.size() &&
+           ((x1 >> level) - (x0 >> level) > 3 ||
+            (y1 >> level) - (y0 >> level) > 3)) {
+        level++;
+    }
+
+    const std::vector<float> &farthest = levels[level];
+    int levelWidth = levelWidths[level];
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            if (nearest <= farthest[y * levelWidth + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t OcclusionCuller::TriangleCount() const { return triangles.size(); }
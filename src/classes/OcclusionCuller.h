@@ -0,0 +1,73 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "JobSystem.h"
+#include <cstddef>
+#include <vector>
+
+// Software occlusion culling against a CPU rasterized depth buffer.
+//
+// Each frame, occluder meshes are transformed and binned into screen tiles,
+// then the tiles are rasterized depth only, 4 pixels at a time with SSE, in
+// parallel on a JobSystem. A hierarchical Z pyramid keeping the farthest
+// depth of each 2x2 block is built on top, so testing an occludee's bounds
+// only reads a few texels at the level matching its screen size.
+//
+// Runs entirely on the CPU, so no GL context is needed.
+class OcclusionCuller {
+  public:
+    // Size of the screen tiles rasterized as one job, in pixels.
+    static const int TILE_SIZE = 32;
+
+    // Constructor that allocates a width x height depth buffer. A quarter
+    // or less of the real resolution is usually enough.
+    OcclusionCuller(int width, int height);
+
+    // Starts a frame seen through a column-major view-projection matrix,
+    // dropping the previous frame's occluders.
+    void BeginFrame(const float *viewProjection);
+
+    // Adds a triangle mesh with world space positions (3 floats per
+    // vertex) as an occluder. Triangles crossing the near plane are
+    // skipped, which only makes culling more conservative.
+    void AddOccluder(const float *positions, size_t vertexCount,
+                     const unsigned int *indices, size_t indexCount);
+
+    // Rasterizes the occluders and builds the depth pyramid. Runs on jobs
+    // if given.
+    void Rasterize(JobSystem *jobs = nullptr);
+
+    // Whether any part of the box may be visible: false only when it is
+    // off screen or entirely behind the rasterized occluders.
+    bool IsVisible(const float min[3], const float max[3]) const;
+
+    // Occluder triangles rasterized this frame.
+    size_t TriangleCount() const;
+
+    int width;
+    int height;
+
+  private:
+    // A triangle in pixel coordinates with depth in [0, 1].
+    struct Triangle {
+        float x[3], y[3], z[3];
+        int minX, minY, maxX, maxY;
+    };
+
+    float viewProjection[16];
+    std::vector<Triangle> triangles;
+
+    // Triangles overlapping each tile, row by row.
+    int tilesX, tilesY;
+    std::vector<std::vector<unsigned int>> tileTriangles;
+
+    // Level 0 is the depth buffer, padded to whole tiles. Each further
+    // level holds the farthest depth of a 2x2 block of the one below.
+    std::vector<std::vector<float>> levels;
+    std::vector<int> levelWidths, levelHeights;
+
+    void RasterizeTile(int tile);
+    void BuildLevel(int level, size_t firstRow, size_t lastRow);
+};
+
+#endif
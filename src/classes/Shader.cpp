@@ -1,12 +1,16 @@
 #include "Shader.h"
-#include "debug.h"
+#include "Log.h"
+#include "Trace.h"
 #include <fstream>
 #include <ostream>
 #include <sstream>
+#include <vector>
 
 using namespace std;
 
 Shader::Shader(const char *vertexPath, const char *fragmentPath) {
+    TRACE_SCOPE("Shader::Shader");
+
     // Retreive the vertex/fragment source code from the filepath.
     string vertexCode;
     string fragmentCode;
@@ -18,61 +22,93 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
     fragmentShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
 
     try {
-        // Open files.
-        LogInfo("Opening files.");
+        TRACE_SCOPE("Shader read sources");
 
+        // Open files.
+        LOG_DEBUG("Opening %s and %s", vertexPath, fragmentPath);
         vertexShaderFile.open(vertexPath);
-        LogInfo(vertexShaderFile.is_open() ? "true" : "false");
         fragmentShaderFile.open(fragmentPath);
-        LogInfo(fragmentShaderFile.is_open() ? "true" : "false");
 
         stringstream vertexShaderStream;
         stringstream fragmentShaderStream;
 
         // Read file's buffer contents into streams.
-        LogInfo("Reading file contents into streams.");
+        LOG_DEBUG("Reading file contents into streams.");
         vertexShaderStream << vertexShaderFile.rdbuf();
         fragmentShaderStream << fragmentShaderFile.rdbuf();
 
         // Close the file handlers.
-        LogInfo("Closing file handles.");
+        LOG_DEBUG("Closing file handles.");
         vertexShaderFile.close();
         fragmentShaderFile.close();
 
         // Convert the stream into string.
-        LogInfo("Converting the stream into string.");
+        LOG_DEBUG("Converting the stream into string.");
         vertexCode = vertexShaderStream.str();
         fragmentCode = fragmentShaderStream.str();
 
     } catch (std::ifstream::failure e) {
-        cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ:\n"
-             << "what - " << e.what() << "\n"
-             << "code - " << e.code() << endl;
+        LOG_ERROR("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ:\n"
+                  "what - %s\n"
+                  "code - %d",
+                  e.what(), e.code().value());
     }
 
+    build(vertexCode.data(), (GLint)vertexCode.size(), fragmentCode.data(),
+          (GLint)fragmentCode.size());
+}
+
+Shader::Shader(const char *vertexSource, GLint vertexLength,
+               const char *fragmentSource, GLint fragmentLength) {
+    TRACE_SCOPE("Shader::Shader");
+    build(vertexSource, vertexLength, fragmentSource, fragmentLength);
+}
+
+Shader::~Shader() { Delete(); }
+
+Shader::Shader(Shader &&other) noexcept : ID(other.ID) { other.ID = 0; }
+
+Shader &Shader::operator=(Shader &&other) noexcept {
+    if (this != &other) {
+        Delete();
+        ID = other.ID;
+        other.ID = 0;
+    }
+    return *this;
+}
+
+void Shader::build(const char *vertexSource, GLint vertexLength,
+                   const char *fragmentSource, GLint fragmentLength) {
     // Compile Shaders.
-    const char *vertexShaderCode = vertexCode.c_str();
-    const char *fragmentShaderCode = fragmentCode.c_str();
     unsigned int vertex, fragment;
 
     // Vertex shader.
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    {
+        TRACE_SCOPE("Shader compile vertex");
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vertexSource, &vertexLength);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+    }
 
     // Fragment Shaders.
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    {
+        TRACE_SCOPE("Shader compile fragment");
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fragmentSource, &fragmentLength);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+    }
 
     // Shader Program.
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    {
+        TRACE_SCOPE("Shader link");
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+    }
 
     // Shaders no longer needed after linking.
     glDeleteShader(vertex);
@@ -81,7 +117,12 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
 
 void Shader::Activate() { glUseProgram(ID); }
 
-void Shader::Delete() { glDeleteProgram(ID); }
+void Shader::Delete() {
+    if (ID != 0) {
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+}
 
 void Shader::setBool(const string &name, bool value) const {
     glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
@@ -92,7 +133,57 @@ void Shader::setInt(const string &name, int value) const {
 }
 
 void Shader::setFloat(const string &name, float value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+}
+
+UniformBlockLayout Shader::getUniformBlockLayout(const string &name) const {
+    UniformBlockLayout layout;
+    layout.index = glGetUniformBlockIndex(ID, name.c_str());
+    if (layout.index == GL_INVALID_INDEX) {
+        return layout;
+    }
+
+    glGetActiveUniformBlockiv(ID, layout.index, GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &layout.size);
+
+    GLint count = 0;
+    glGetActiveUniformBlockiv(ID, layout.index,
+                              GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+    if (count == 0) {
+        return layout;
+    }
+
+    vector<GLint> indices(count);
+    glGetActiveUniformBlockiv(ID, layout.index,
+                              GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES,
+                              indices.data());
+
+    // Query every member's offsets and strides in one call each.
+    vector<GLuint> uniforms(indices.begin(), indices.end());
+    vector<GLint> offsets(count), arrayStrides(count), matrixStrides(count);
+    glGetActiveUniformsiv(ID, count, uniforms.data(), GL_UNIFORM_OFFSET,
+                          offsets.data());
+    glGetActiveUniformsiv(ID, count, uniforms.data(), GL_UNIFORM_ARRAY_STRIDE,
+                          arrayStrides.data());
+    glGetActiveUniformsiv(ID, count, uniforms.data(),
+                          GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+
+    char memberName[256];
+    for (GLint i = 0; i < count; i++) {
+        glGetActiveUniformName(ID, uniforms[i], sizeof(memberName), NULL,
+                               memberName);
+        layout.members[memberName] = {offsets[i], arrayStrides[i],
+                                      matrixStrides[i]};
+    }
+
+    return layout;
+}
+
+void Shader::bindUniformBlock(const string &name, unsigned int binding) const {
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(ID, index, binding);
+    }
 }
 
 void Shader::checkCompileErrors(unsigned int shader, string type) {
@@ -102,21 +193,17 @@ void Shader::checkCompileErrors(unsigned int shader, string type) {
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n"
-                 << infoLog
-                 << "\n -- --------------------------------------------------- "
-                    "-- "
-                 << endl;
+            LOG_ERROR("ERROR::SHADER_COMPILATION_ERROR of type: %s\n%s\n -- "
+                      "--------------------------------------------------- -- ",
+                      type, infoLog);
         }
     } else {
         glGetProgramiv(shader, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n"
-                 << infoLog
-                 << "\n -- --------------------------------------------------- "
-                    "-- "
-                 << endl;
+            LOG_ERROR("ERROR::PROGRAM_LINKING_ERROR of type: %s\n%s\n -- "
+                      "--------------------------------------------------- -- ",
+                      type, infoLog);
         }
     }
 }
@@ -4,21 +4,51 @@
 #include "../glad/glad.h"
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 
+// Offsets and strides of a single member of a std140 uniform block.
+struct UniformBlockMember {
+    GLint offset;
+    GLint arrayStride;
+    GLint matrixStride;
+};
+
+// Layout of a uniform block as reported by the linked program.
+struct UniformBlockLayout {
+    GLuint index = GL_INVALID_INDEX;
+    GLint size = 0;
+    std::map<std::string, UniformBlockMember> members;
+};
+
+// Owns a linked program, which is deleted by Delete() or the destructor.
+// Move-only, so exactly one Shader deletes each program.
 class Shader {
   public:
-    // The Program ID.
-    unsigned int ID;
+    // The Program ID, 0 once deleted.
+    unsigned int ID = 0;
 
     // Constructor that reads and builds the shader.
     Shader(const char *vertexPath, const char *fragmentPath);
 
+    // Constructor that builds the shader from sources already in memory,
+    // which need not be null terminated.
+    Shader(const char *vertexSource, GLint vertexLength,
+           const char *fragmentSource, GLint fragmentLength);
+
+    ~Shader();
+
+    Shader(Shader &&other) noexcept;
+    Shader &operator=(Shader &&other) noexcept;
+
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+
     // Use or activate the shader.
     void Activate();
 
-    // Deactivate or delete the shader.
+    // Deletes the program; safe to call more than once.
     void Delete();
 
     // Utility uniform functions.
@@ -26,7 +56,17 @@ class Shader {
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
 
+    // Queries the layout of a uniform block so it can be packed on the CPU.
+    UniformBlockLayout getUniformBlockLayout(const std::string &name) const;
+
+    // Assigns a uniform block to a uniform buffer binding point.
+    void bindUniformBlock(const std::string &name, unsigned int binding) const;
+
   private:
+    // Compiles and links the program.
+    void build(const char *vertexSource, GLint vertexLength,
+               const char *fragmentSource, GLint fragmentLength);
+
     // Error checking.
     void checkCompileErrors(unsigned int shader, std::string type);
 };
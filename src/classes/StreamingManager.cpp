@@ -0,0 +1,377 @@
+#include "StreamingManager.h"
+#include "Log.h"
+#include "Trace.h"
+#include <algorithm>
+#include <queue>
+
+namespace {
+
+// Distance between the reads that fault in each page.
+const size_t PAGE_SIZE = 4096;
+
+// Reads a byte of every page in a range so the range is in memory before
+// the render thread uploads from it.
+void TouchPages(const char *data, size_t size) {
+    const volatile char *bytes = data;
+    for (size_t offset = 0; offset < size; offset += PAGE_SIZE) {
+        (void)bytes[offset];
+    }
+    if (size > 0) {
+        (void)bytes[size - 1];
+    }
+}
+
+int LevelSize(uint32_t size, int level) {
+    return std::max((int)(size >> level), 1);
+}
+
+} // namespace
+
+StreamingManager::StreamingManager(const AssetPack &pack, size_t budgetBytes,
+                                   size_t uploadBytesPerFrame,
+                                   unsigned int readerThreads)
+    : pack(pack), budgetBytes(budgetBytes),
+      uploadBytesPerFrame(uploadBytesPerFrame) {
+    for (unsigned int i = 0; i < readerThreads; i++) {
+        readers.emplace_back(&StreamingManager::ReadLoop, this);
+    }
+}
+
+StreamingManager::~StreamingManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+}
+
+unsigned int StreamingManager::AddTexture(const char *name) {
+    return Add(name, ASSET_PACK_TEXTURE);
+}
+
+unsigned int StreamingManager::AddMesh(const char *name) {
+    return Add(name, ASSET_PACK_MESH);
+}
+
+unsigned int StreamingManager::Add(const char *name, AssetPackType type) {
+    const AssetPackEntry *entry = pack.Find(name, type);
+    if (entry == nullptr) {
+        LOG_ERROR("Asset pack has no %s '%s' to stream",
+                  type == ASSET_PACK_TEXTURE ? "texture" : "mesh", name);
+        return NO_ASSET;
+    }
+    Asset asset;
+    asset.type = type;
+    asset.entry = entry;
+    if (type == ASSET_PACK_TEXTURE) {
+        asset.texture =
+            (const AssetPackTexture *)(pack.Data() + entry->offset);
+    }
+    assets.push_back(std::move(asset));
+    return (unsigned int)assets.size() - 1;
+}
+
+void StreamingManager::Request(unsigned int asset, float screenSize) {
+    if (asset >= assets.size() || screenSize <= 0.0f) {
+        return;
+    }
+    Asset &requested = assets[asset];
+    if (requested.lastRequest == frame) {
+        screenSize = std::max(screenSize, requested.screenSize);
+    } else if (requested.lastRequest != 0) {
+        recent.splice(recent.begin(), recent, requested.recent);
+    } else {
+        requested.recent = recent.insert(recent.begin(), asset);
+    }
+    requested.lastRequest = frame;
+    requested.screenSize = screenSize;
+
+    // The coarsest level still at least screenSize pixels across.
+    if (requested.type == ASSET_PACK_TEXTURE) {
+        const AssetPackTexture &texture = *requested.texture;
+        int level = 0;
+        while (level + 1 < (int)texture.mipCount &&
+               std::max(LevelSize(texture.width, level + 1),
+                        LevelSize(texture.height, level + 1)) >= screenSize) {
+            level++;
+        }
+        requested.wantedMip = level;
+    }
+}
+
+void StreamingManager::Update() {
+    TRACE_SCOPE("StreamingManager::Update");
+    glActiveTexture(GL_TEXTURE0);
+
+    // Upload what has been paged in, at least one load per frame so a
+    // large one cannot stall forever.
+    size_t uploaded = 0;
+    while (uploaded < uploadBytesPerFrame) {
+        Load load;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (read.empty()) {
+                break;
+            }
+            load = std::move(read.front());
+            read.pop_front();
+        }
+        Upload(load);
+        uploaded += load.bytes;
+    }
+
+    // Assets with nothing resident come first, then bigger on screen.
+    typedef std::pair<std::pair<bool, float>, size_t> Candidate;
+    std::priority_queue<Candidate> wanted;
+    std::vector<Load> loads;
+    for (unsigned int index : recent) {
+        const Asset &asset = assets[index];
+        if (asset.lastRequest != frame) {
+            break;
+        }
+        Load load;
+        if (!asset.loading && NextLoad(asset, load)) {
+            load.asset = index;
+            wanted.push({{asset.residentBytes == 0, asset.screenSize},
+                         loads.size()});
+            loads.push_back(std::move(load));
+        }
+    }
+
+    while (!wanted.empty() && loadsInFlight < MAX_LOADS_IN_FLIGHT) {
+        Load &load = loads[wanted.top().second];
+        wanted.pop();
+        if (!MakeRoom(load.bytes)) {
+            continue;
+        }
+        assets[load.asset].loading = true;
+        loadingBytes += load.bytes;
+        loadsInFlight++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued.push_back(std::move(load));
+        }
+        wake.notify_one();
+    }
+    frame++;
+}
+
+bool StreamingManager::NextLoad(const Asset &asset, Load &load) const {
+    load.bytes = 0;
+    load.ranges.clear();
+    const char *data = pack.Data();
+
+    if (asset.type == ASSET_PACK_MESH) {
+        if (asset.mesh) {
+            return false;
+        }
+        const AssetPackMesh *mesh =
+            (const AssetPackMesh *)(data + asset.entry->offset);
+        load.firstLevel = load.lastLevel = 0;
+        load.ranges.push_back({data + mesh->vertexOffset, mesh->vertexSize});
+        load.ranges.push_back({data + mesh->indexOffset, mesh->indexSize});
+        load.bytes = mesh->vertexSize + mesh->indexSize;
+        return true;
+    }
+
+    const AssetPackTexture &texture = *asset.texture;
+    int mipCount = (int)texture.mipCount;
+    if (mipCount == 0) {
+        return false;
+    }
+    if (asset.residentMip < 0) {
+        // The first load brings every small level at once.
+        load.lastLevel = mipCount - 1;
+        load.firstLevel = load.lastLevel;
+        while (load.firstLevel > asset.wantedMip &&
+               std::max(LevelSize(texture.width, load.firstLevel - 1),
+                        LevelSize(texture.height, load.firstLevel - 1)) <=
+                   FIRST_MIP_SIZE) {
+            load.firstLevel--;
+        }
+    } else if (asset.residentMip > asset.wantedMip) {
+        load.firstLevel = load.lastLevel = asset.residentMip - 1;
+    } else {
+        return false;
+    }
+    for (int level = load.firstLevel; level <= load.lastLevel; level++) {
+        load.ranges.push_back(
+            {data + texture.mipOffset[level], texture.mipSize[level]});
+        load.bytes += texture.mipSize[level];
+    }
+    return true;
+}
+
+bool StreamingManager::MakeRoom(size_t bytes) {
+    // Least recently requested first, never what this frame asked for.
+    auto it = recent.end();
+    while (residentBytes + loadingBytes + bytes > budgetBytes) {
+        if (it == recent.begin()) {
+            return false;
+        }
+        --it;
+        Asset &asset = assets[*it];
+        if (asset.lastRequest == frame) {
+            return false;
+        }
+        if (asset.loading) {
+            continue;
+        }
+        while (asset.residentBytes > 0 &&
+               residentBytes + loadingBytes + bytes > budgetBytes) {
+            EvictOne(*it);
+        }
+        if (asset.residentBytes == 0) {
+            asset.lastRequest = 0;
+            it = recent.erase(it);
+        }
+    }
+    return true;
+}
+
+size_t StreamingManager::EvictOne(unsigned int index) {
+    Asset &asset = assets[index];
+    size_t bytes = 0;
+    if (asset.type == ASSET_PACK_MESH) {
+        if (asset.mesh) {
+            asset.mesh->Delete();
+            asset.mesh.reset();
+            bytes = asset.residentBytes;
+        }
+    } else if (asset.residentMip >= 0) {
+        int level = asset.residentMip;
+        bytes = asset.texture->mipSize[level];
+        if (level == (int)asset.texture->mipCount - 1) {
+            asset.textureObject.Reset();
+            asset.residentMip = -1;
+        } else {
+            // A 0x0 image frees the level's storage.
+            glBindTexture(GL_TEXTURE_2D, asset.textureObject.Name());
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            asset.residentMip = level + 1;
+        }
+    }
+    asset.residentBytes -= bytes;
+    residentBytes -= bytes;
+    evictedBytes += bytes;
+    return bytes;
+}
+
+void StreamingManager::Upload(const Load &load) {
+    Asset &asset = assets[load.asset];
+    asset.loading = false;
+    loadingBytes -= load.bytes;
+    loadsInFlight--;
+
+    if (asset.type == ASSET_PACK_MESH) {
+        asset.mesh.reset(new BakedMesh(pack.LoadMesh(asset.entry->name)));
+    } else {
+        const AssetPackTexture &texture = *asset.texture;
+        if (asset.textureObject.Name() == 0) {
+            asset.textureObject = GLTexture::Create();
+            glBindTexture(GL_TEXTURE_2D, asset.textureObject.Name());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                            GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                            (GLint)texture.mipCount - 1);
+        } else {
+            glBindTexture(GL_TEXTURE_2D, asset.textureObject.Name());
+        }
+        for (int level = load.lastLevel; level >= load.firstLevel; level--) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA,
+                         LevelSize(texture.width, level),
+                         LevelSize(texture.height, level), 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE,
+                         load.ranges[level - load.firstLevel].first);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, load.firstLevel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        asset.residentMip = load.firstLevel;
+    }
+    asset.residentBytes += load.bytes;
+    residentBytes += load.bytes;
+    uploadedBytes += load.bytes;
+}
+
+void StreamingManager::ReadLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (stopping) {
+            return;
+        }
+        Load load = std::move(queued.front());
+        queued.pop_front();
+        lock.unlock();
+
+        {
+            TRACE_SCOPE("StreamingManager read");
+            for (const auto &range : load.ranges) {
+                TouchPages(range.first, range.second);
+            }
+        }
+
+        lock.lock();
+        read.push_back(std::move(load));
+    }
+}
+
+GLuint StreamingManager::TextureID(unsigned int asset) const {
+    return asset < assets.size() ? assets[asset].textureObject.Name() : 0;
+}
+
+int StreamingManager::ResidentMip(unsigned int asset) const {
+    return asset < assets.size() ? assets[asset].residentMip : -1;
+}
+
+int StreamingManager::WantedMip(unsigned int asset) const {
+    return asset < assets.size() ? assets[asset].wantedMip : 0;
+}
+
+BakedMesh *StreamingManager::ResidentMesh(unsigned int asset) {
+    return asset < assets.size() ? assets[asset].mesh.get() : nullptr;
+}
+
+size_t StreamingManager::BudgetBytes() const { return budgetBytes; }
+
+size_t StreamingManager::ResidentBytes() const { return residentBytes; }
+
+size_t StreamingManager::UploadedBytes() const { return uploadedBytes; }
+
+size_t StreamingManager::EvictedBytes() const { return evictedBytes; }
+
+size_t StreamingManager::PendingLoads() const { return loadsInFlight; }
+
+void StreamingManager::Delete() {
+    // Wait for the reads in flight so their uploads are not lost track of.
+    while (loadsInFlight > 0) {
+        Load load;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (read.empty()) {
+                lock.unlock();
+                std::this_thread::yield();
+                continue;
+            }
+            load = std::move(read.front());
+            read.pop_front();
+        }
+        Upload(load);
+    }
+    for (unsigned int index = 0; index < assets.size(); index++) {
+        while (assets[index].residentBytes > 0) {
+            EvictOne(index);
+        }
+        assets[index].lastRequest = 0;
+    }
+    recent.clear();
+}
@@ -0,0 +1,160 @@
+#ifndef STREAMING_MANAGER_H
+#define STREAMING_MANAGER_H
+
+#include "AssetPack.h"
+#include "GLHandlePool.h"
+#include "../glad/glad.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Streams textures and meshes from an AssetPack on demand, within a GPU
+// memory budget.
+//
+// Every frame the renderer Requests the assets it is about to draw with
+// their size on screen, then calls Update. The most wanted missing data is
+// paged in from the pack's mapping on background reader threads, so the
+// render thread never waits on the disk, and then uploaded straight from
+// the mapping on the render thread. Textures are resident per mip level:
+// the coarse levels, up to FIRST_MIP_SIZE, arrive first in one go so
+// something is visible at once; finer levels follow one at a time down to
+// the level that matches the screen size. When the budget is exceeded the
+// least recently requested assets give back their finest levels first.
+//
+// Textures keep their resident levels as GL_TEXTURE_BASE_LEVEL to
+// GL_TEXTURE_MAX_LEVEL, so they are complete whatever is resident.
+class StreamingManager {
+  public:
+    // Handle of an asset the pack does not have.
+    static const unsigned int NO_ASSET = 0xffffffffu;
+
+    // Levels at most this many pixels on a side load with the first batch.
+    static const int FIRST_MIP_SIZE = 64;
+
+    // Reads in flight at once, across every reader thread.
+    static const size_t MAX_LOADS_IN_FLIGHT = 8;
+
+    // Constructor that streams from pack, which must outlive the manager,
+    // keeping at most budgetBytes of textures and meshes resident.
+    // uploadBytesPerFrame bounds the upload work Update does per frame.
+    StreamingManager(const AssetPack &pack, size_t budgetBytes,
+                     size_t uploadBytesPerFrame = 8 << 20,
+                     unsigned int readerThreads = 1);
+
+    // Stops the readers. Call Delete first to free the GL objects.
+    ~StreamingManager();
+
+    StreamingManager(const StreamingManager &) = delete;
+    StreamingManager &operator=(const StreamingManager &) = delete;
+
+    // Registers an asset of the pack for streaming. Nothing is loaded until
+    // it is requested. Returns NO_ASSET if the pack has no such entry.
+    unsigned int AddTexture(const char *name);
+    unsigned int AddMesh(const char *name);
+
+    // Asks for an asset this frame. screenSize is its largest side on
+    // screen in pixels, e.g. projected from its distance; bigger assets
+    // load first, and textures load down to the level covering screenSize.
+    void Request(unsigned int asset, float screenSize);
+
+    // Uploads what the readers have paged in, evicts while over budget and
+    // starts reads for the most wanted missing data. Call once per frame
+    // on the GL thread, after the frame's requests. Leaves texture unit
+    // 0's binding at 0.
+    void Update();
+
+    // Texture with every resident level, or 0 while none is resident.
+    GLuint TextureID(unsigned int asset) const;
+
+    // Finest resident mip level of a texture, or -1.
+    int ResidentMip(unsigned int asset) const;
+
+    // Mip level the last request of a texture asked for.
+    int WantedMip(unsigned int asset) const;
+
+    // The mesh if it is resident, or nullptr.
+    BakedMesh *ResidentMesh(unsigned int asset);
+
+    size_t BudgetBytes() const;
+    size_t ResidentBytes() const;
+
+    // Totals since construction.
+    size_t UploadedBytes() const;
+    size_t EvictedBytes() const;
+
+    // Reads started but not uploaded yet.
+    size_t PendingLoads() const;
+
+    // Deletes every GL object; everything becomes non-resident.
+    void Delete();
+
+  private:
+    struct Asset {
+        AssetPackType type;
+        const AssetPackEntry *entry;
+        // Textures: levels [residentMip, mipCount) are on the GPU.
+        const AssetPackTexture *texture = nullptr;
+        GLTexture textureObject;
+        int residentMip = -1;
+        int wantedMip = 0;
+        // Meshes.
+        std::unique_ptr<BakedMesh> mesh;
+
+        size_t residentBytes = 0;
+        float screenSize = 0.0f;
+        // Frame of the last request plus one, 0 if never requested.
+        unsigned long long lastRequest = 0;
+        bool loading = false;
+        std::list<unsigned int>::iterator recent;
+    };
+
+    // Pack bytes to page in for one upload. Textures load levels
+    // [firstLevel, lastLevel].
+    struct Load {
+        unsigned int asset;
+        int firstLevel;
+        int lastLevel;
+        size_t bytes;
+        std::vector<std::pair<const char *, size_t>> ranges;
+    };
+
+    const AssetPack &pack;
+    size_t budgetBytes;
+    size_t uploadBytesPerFrame;
+    std::vector<Asset> assets;
+    // Requested assets, most recent first.
+    std::list<unsigned int> recent;
+    unsigned long long frame = 1;
+    size_t residentBytes = 0;
+    // Bytes of loads in flight, counted against the budget already.
+    size_t loadingBytes = 0;
+    size_t uploadedBytes = 0;
+    size_t evictedBytes = 0;
+    size_t loadsInFlight = 0;
+
+    std::vector<std::thread> readers;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Load> queued;
+    std::deque<Load> read;
+    bool stopping = false;
+
+    unsigned int Add(const char *name, AssetPackType type);
+    void ReadLoop();
+    void Upload(const Load &load);
+    // Bytes and levels of the next load an asset needs, false if none.
+    bool NextLoad(const Asset &asset, Load &load) const;
+    // Frees bytes from assets not requested this frame. Returns whether
+    // they fit in the budget afterwards.
+    bool MakeRoom(size_t bytes);
+    // Drops an asset's finest level, or its mesh. Returns bytes freed.
+    size_t EvictOne(unsigned int asset);
+};
+
+#endif
@@ -1,8 +1,10 @@
 #include "Texture.h"
 #include "Shader.h"
+#include "Trace.h"
 
 Texture::Texture(const char *image, GLenum textureType, GLenum slot,
                  GLenum format, GLenum pixelType) {
+    TRACE_SCOPE("Texture::Texture");
     type = textureType;
 
     int imageWidth;
@@ -13,12 +15,63 @@ Texture::Texture(const char *image, GLenum textureType, GLenum slot,
     stbi_set_flip_vertically_on_load(true);
 
     // Reads the image from a file and stores it in bytes.
-    unsigned char *bytes =
-        stbi_load(image, &imageWidth, &imageHeight, &numberOfColourChannels, 0);
+    unsigned char *bytes;
+    {
+        TRACE_SCOPE("Texture decode");
+        bytes = stbi_load(image, &imageWidth, &imageHeight,
+                          &numberOfColourChannels, 0);
+    }
 
-    glGenTextures(1, &ID);
+    Upload(bytes, imageWidth, imageHeight, slot, format, pixelType);
+
+    // Delete the image data because it is already in the OpenGL Texture object.
+    stbi_image_free(bytes);
+}
+
+Texture::Texture(const unsigned char *pixels, int width, int height,
+                 GLenum textureType, GLenum slot, GLenum format,
+                 GLenum pixelType) {
+    TRACE_SCOPE("Texture::Texture");
+    type = textureType;
+    Upload(pixels, width, height, slot, format, pixelType);
+}
+
+Texture::Texture(const unsigned char *const *mips, int mipCount, int width,
+                 int height, GLenum textureType, GLenum slot, GLenum format,
+                 GLenum pixelType) {
+    TRACE_SCOPE("Texture::Texture");
+    type = textureType;
+
+    texture = GLTexture::Create();
     glActiveTexture(slot);
-    glBindTexture(textureType, ID);
+    glBindTexture(type, ID());
+
+    glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(type, GL_TEXTURE_MAX_LEVEL,
+                    mipCount > 0 ? mipCount - 1 : 0);
+
+    // Uploads every level as is, nothing is generated on the GPU.
+    {
+        TRACE_SCOPE("Texture upload");
+        for (int level = 0; level < mipCount; level++) {
+            glTexImage2D(type, level, GL_RGBA, width, height, 0, format,
+                         pixelType, mips[level]);
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+    }
+
+    glBindTexture(type, 0);
+}
+
+void Texture::Upload(const unsigned char *pixels, int width, int height,
+                     GLenum slot, GLenum format, GLenum pixelType) {
+    texture = GLTexture::Create();
+    glActiveTexture(slot);
+    glBindTexture(type, ID());
 
     // Set the texture wrapping/filtering options.
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -28,16 +81,16 @@ Texture::Texture(const char *image, GLenum textureType, GLenum slot,
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     // Assigns the image to the OpenGL Texture object.
-    glTexImage2D(textureType, 0, GL_RGBA, imageWidth, imageHeight, 0, format,
-                 pixelType, bytes);
-    glGenerateMipmap(textureType);
-
-    // Delete the image data because it is already in the OpenGL Texture object.
-    stbi_image_free(bytes);
+    {
+        TRACE_SCOPE("Texture upload");
+        glTexImage2D(type, 0, GL_RGBA, width, height, 0, format,
+                     pixelType, pixels);
+        glGenerateMipmap(type);
+    }
 
     // Unbinds the OpenGL Texture object so that it can't be modified
     // accidentally.
-    glBindTexture(textureType, 0);
+    glBindTexture(type, 0);
 }
 
 void Texture::textureUnit(Shader &shader, const char *uniform,
@@ -47,8 +100,10 @@ void Texture::textureUnit(Shader &shader, const char *uniform,
     glUniform1i(textureUnit, unit);
 }
 
-void Texture::Bind() { glBindTexture(type, ID); }
+void Texture::Bind() { glBindTexture(type, ID()); }
 
 void Texture::Unbind() { glBindTexture(type, 0); }
 
-void Texture::Delete() { glDeleteTextures(1, &ID); }
+void Texture::Delete() { texture.Reset(); }
+
+GLuint Texture::ID() const { return texture.Name(); }
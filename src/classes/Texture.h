@@ -2,18 +2,30 @@
 #define TEXTURE_CLASS_H
 
 #include "Shader.h"
+#include "GLHandlePool.h"
 #include "../glad/glad.h"
 #include "../stb/stb_image.h"
 
 class Texture {
   public:
-    unsigned int ID;
+    // Name of the texture, 0 once deleted.
+    GLuint ID() const;
     GLenum type;
 
     // Constructor for the Texture.
     Texture(const char *image, GLenum textureType, GLenum slot, GLenum format,
             GLenum pixelType);
 
+    // Constructor for a Texture from already decoded pixels.
+    Texture(const unsigned char *pixels, int width, int height,
+            GLenum textureType, GLenum slot, GLenum format, GLenum pixelType);
+
+    // Constructor for a Texture from a prebuilt mip chain, largest first.
+    // Each level halves the size of the one before, down to 1 pixel.
+    Texture(const unsigned char *const *mips, int mipCount, int width,
+            int height, GLenum textureType, GLenum slot, GLenum format,
+            GLenum pixelType);
+
     // Assigns a texture unit to a texture.
     void textureUnit(Shader &shader, const char *uniform, unsigned int unit);
 
@@ -25,6 +37,12 @@ class Texture {
 
     // Deletes a texture.
     void Delete();
+
+  private:
+    GLTexture texture;
+    // Creates the OpenGL Texture object and uploads the pixels with mipmaps.
+    void Upload(const unsigned char *pixels, int width, int height,
+                GLenum slot, GLenum format, GLenum pixelType);
 };
 
 #endif
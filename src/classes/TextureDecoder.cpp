@@ -0,0 +1,122 @@
+#include "TextureDecoder.h"
+#include "Log.h"
+#include "Trace.h"
+#include "../stb/stb_image.h"
+
+TextureDecoder::TextureDecoder(unsigned int threadCount) {
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&TextureDecoder::DecodeLoop, this);
+    }
+}
+
+TextureDecoder::~TextureDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    for (Decoded &image : decoded) {
+        stbi_image_free(image.pixels);
+    }
+}
+
+unsigned int TextureDecoder::Submit(const void *data, size_t size,
+                                    std::shared_ptr<const void> keepAlive) {
+    unsigned int image = (unsigned int)textures.size();
+    textures.emplace_back();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({image, data, size, std::move(keepAlive)});
+    }
+    wake.notify_one();
+    return image;
+}
+
+size_t TextureDecoder::Upload() {
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(decoded);
+    }
+
+    size_t uploaded = 0;
+    for (Decoded &image : ready) {
+        if (image.pixels == nullptr) {
+            continue;
+        }
+        textures[image.image].reset(
+            new Texture(image.pixels, image.width, image.height,
+                        GL_TEXTURE_2D, GL_TEXTURE0, GL_RGBA, GL_UNSIGNED_BYTE));
+        stbi_image_free(image.pixels);
+        uploaded++;
+    }
+    return uploaded;
+}
+
+void TextureDecoder::Finish() {
+    TRACE_SCOPE("TextureDecoder::Finish");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        decodedOne.wait(lock,
+                        [this] { return queue.empty() && decoding == 0; });
+    }
+    Upload();
+}
+
+GLuint TextureDecoder::TextureID(unsigned int image) const {
+    return image < textures.size() && textures[image] != nullptr
+               ? textures[image]->ID()
+               : 0;
+}
+
+size_t TextureDecoder::Pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size() + decoding + decoded.size();
+}
+
+void TextureDecoder::Delete() {
+    for (std::unique_ptr<Texture> &texture : textures) {
+        texture.reset();
+    }
+}
+
+void TextureDecoder::DecodeLoop() {
+    // Images are stored top row first, the way glTF texture coordinates
+    // expect them. The setting is per thread, so Texture's flip for files
+    // loaded on the render thread is unaffected.
+    stbi_set_flip_vertically_on_load_thread(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) {
+            return;
+        }
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        decoding++;
+        lock.unlock();
+
+        Decoded image = {job.image, nullptr, 0, 0};
+        {
+            TRACE_SCOPE("Texture decode");
+            int channels;
+            image.pixels = stbi_load_from_memory(
+                (const stbi_uc *)job.data, (int)job.size, &image.width,
+                &image.height, &channels, 4);
+        }
+        if (image.pixels == nullptr) {
+            LOG_ERROR("Failed to decode image %u: %s", job.image,
+                      stbi_failure_reason());
+        }
+        job.keepAlive.reset();
+
+        lock.lock();
+        decoded.push_back(image);
+        decoding--;
+        decodedOne.notify_all();
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TEXTURE_DECODER_H
+#define TEXTURE_DECODER_H
+
+#include "Texture.h"
+#include "../glad/glad.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decodes compressed images (PNG, JPEG, ...) on background threads.
+//
+// Loaders Submit the encoded bytes and get a handle back straight away; the
+// pixels are decoded off the render thread and turned into textures by
+// Upload, which the render thread calls once per frame. Until then a
+// handle's texture ID is 0, so the image simply pops in when it is ready.
+// Images are decoded to RGBA as stored, without the vertical flip the
+// Texture class applies to files.
+class TextureDecoder {
+  public:
+    // Handle of an image that was never submitted.
+    static constexpr unsigned int NO_IMAGE = 0xffffffffu;
+
+    // Constructor that starts threadCount decode threads.
+    TextureDecoder(unsigned int threadCount = 1);
+
+    // Stops the threads, dropping images that were not decoded yet. Delete
+    // the textures first.
+    ~TextureDecoder();
+
+    TextureDecoder(const TextureDecoder &) = delete;
+    TextureDecoder &operator=(const TextureDecoder &) = delete;
+
+    // Queues size encoded bytes for decoding and returns the image's handle.
+    // The bytes must stay valid until the image is decoded; keepAlive, if
+    // given, is held until then.
+    unsigned int Submit(const void *data, size_t size,
+                        std::shared_ptr<const void> keepAlive = nullptr);
+
+    // Creates textures for the images decoded so far and returns how many.
+    // Needs the current GL context.
+    size_t Upload();
+
+    // Waits for every submitted image and uploads it.
+    void Finish();
+
+    // Texture of an image, or 0 until it is uploaded or if it failed to
+    // decode.
+    GLuint TextureID(unsigned int image) const;
+
+    // Images submitted but not uploaded yet.
+    size_t Pending() const;
+
+    // Deletes every uploaded texture.
+    void Delete();
+
+  private:
+    struct Job {
+        unsigned int image;
+        const void *data;
+        size_t size;
+        std::shared_ptr<const void> keepAlive;
+    };
+
+    struct Decoded {
+        unsigned int image;
+        unsigned char *pixels;
+        int width;
+        int height;
+    };
+
+    std::vector<std::thread> threads;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable decodedOne;
+    std::deque<Job> queue;
+    std::vector<Decoded> decoded;
+    // Images being decoded right now.
+    size_t decoding = 0;
+    bool stopping = false;
+
+    // Only touched by the render thread.
+    std::vector<std::unique_ptr<Texture>> textures;
+
+    void DecodeLoop();
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "Trace.h"
+
+#ifdef LEARNGL_TRACE
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Trace {
+
+namespace {
+
+// Events kept per thread. The buffer is a ring: once full, each new event
+// overwrites the oldest, so a long capture keeps its last frames.
+const size_t EVENTS_PER_THREAD = 1 << 16;
+
+struct Event {
+    const char *name;
+    long long start;
+    long long end;
+};
+
+// Written only by its owning thread. count is the number of events ever
+// recorded; event i lives in slot i % EVENTS_PER_THREAD. The owner
+// publishes each event by bumping count with release ordering, so Dump can
+// read the last EVENTS_PER_THREAD events without locking.
+struct ThreadBuffer {
+    int threadID;
+    std::vector<Event> events;
+    std::atomic<size_t> count{0};
+};
+
+// The registry is only locked when a thread records its first event and
+// when dumping. Buffers are never freed so they outlive their threads.
+std::mutex registryMutex;
+std::vector<ThreadBuffer *> registry;
+ThreadBuffer *gpuBuffer = nullptr;
+std::string sessionPath;
+int nextThreadID = 1;
+
+ThreadBuffer *NewBuffer() {
+    ThreadBuffer *buffer = new ThreadBuffer;
+    buffer->events.resize(EVENTS_PER_THREAD);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->threadID = nextThreadID++;
+    registry.push_back(buffer);
+    return buffer;
+}
+
+ThreadBuffer *LocalBuffer() {
+    thread_local ThreadBuffer *buffer = NewBuffer();
+    return buffer;
+}
+
+void Append(ThreadBuffer *buffer, const char *name, long long start,
+            long long end) {
+    size_t index = buffer->count.load(std::memory_order_relaxed);
+    buffer->events[index % EVENTS_PER_THREAD] = {name, start, end};
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void DumpAtExit() { Dump(); }
+
+} // namespace
+
+void BeginSession(const char *path) {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        sessionPath = path;
+    }
+
+    // Create the GPU track up front so it gets its own thread ID.
+    static ThreadBuffer *gpu = NewBuffer();
+    gpuBuffer = gpu;
+
+    // Dumped once at exit, however many sessions were begun.
+    static std::once_flag registered;
+    std::call_once(registered, []() { std::atexit(DumpAtExit); });
+}
+
+void Record(const char *name, long long start, long long end) {
+    Append(LocalBuffer(), name, start, end);
+}
+
+void RecordGpu(const char *name, long long start, long long end) {
+    // GPU results are only resolved on the render thread.
+    if (gpuBuffer != nullptr) {
+        Append(gpuBuffer, name, start, end);
+    }
+}
+
+void Dump() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (sessionPath.empty()) {
+        return;
+    }
+
+    FILE *file = fopen(sessionPath.c_str(), "w");
+    if (file == nullptr) {
+        return;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    const char *separator = "";
+    size_t overwritten = 0;
+    for (ThreadBuffer *buffer : registry) {
+        const char *threadName = buffer == gpuBuffer ? "GPU" : "CPU";
+        fprintf(file,
+                "%s{\"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"name\": "
+                "\"thread_name\", \"args\": {\"name\": \"%s %d\"}}",
+                separator, buffer->threadID, threadName, buffer->threadID);
+        separator = ",\n";
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        size_t first =
+            count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+        for (size_t i = first; i < count; i++) {
+            Event event = buffer->events[i % EVENTS_PER_THREAD];
+            // A thread still recording may have reused the slot meanwhile.
+            if (buffer->count.load(std::memory_order_acquire) >=
+                i + EVENTS_PER_THREAD) {
+                first++;
+                continue;
+            }
+            fprintf(file,
+                    ",\n{\"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"name\": "
+                    "\"%s\", \"ts\": %.3f, \"dur\": %.3f}",
+                    buffer->threadID, event.name, event.start / 1000.0,
+                    (event.end - event.start) / 1000.0);
+        }
+
+        if (first > 0) {
+            fprintf(stderr,
+                    "Trace: overwrote the oldest %zu events on thread %d\n",
+                    first, buffer->threadID);
+            overwritten += first;
+        }
+    }
+    fprintf(file, "\n],\n\"otherData\": {\"overwritten_events\": %zu}}\n",
+            overwritten);
+    fclose(file);
+}
+
+} // namespace Trace
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped CPU trace markers written as Chrome trace event JSON, viewable in
+// chrome://tracing or ui.perfetto.dev. Tracing is compiled in only when
+// LEARNGL_TRACE is defined (cmake -DLEARNGL_TRACE=ON); otherwise every macro
+// below expands to nothing.
+//
+//   TRACE_BEGIN_SESSION("trace.json"); // once, dumps the file at exit
+//   TRACE_SCOPE("Shader::Shader");     // times the enclosing block
+//
+// Names must be string literals, only the pointer is stored.
+
+#ifdef LEARNGL_TRACE
+
+#include <chrono>
+
+namespace Trace {
+
+// Current time on the steady clock in nanoseconds.
+inline long long Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Sets the output file and registers the dump to run at exit.
+void BeginSession(const char *path);
+
+// Appends a complete event to the calling thread's buffer.
+void Record(const char *name, long long start, long long end);
+
+// Appends a complete event to the GPU track. Times are CPU steady clock
+// nanoseconds (see GpuProfiler::ToCpuNanoseconds).
+void RecordGpu(const char *name, long long start, long long end);
+
+// Writes every buffered event to the session file.
+void Dump();
+
+// Records the lifetime of the object as one event.
+class Scope {
+  public:
+    Scope(const char *name) : name(name), start(Now()) {}
+    ~Scope() { Record(name, start, Now()); }
+
+  private:
+    const char *name;
+    long long start;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_BEGIN_SESSION(path) Trace::BeginSession(path)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_GPU_EVENT(name, start, end) Trace::RecordGpu(name, start, end)
+
+#else
+
+#define TRACE_BEGIN_SESSION(path) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_GPU_EVENT(name, start, end) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+#include "TransformSystem.h"
+#include <atomic>
+
+namespace {
+
+// Transforms per job when a depth is updated in parallel.
+const size_t UPDATE_GRAIN = 1024;
+
+} // namespace
+
+unsigned int TransformSystem::Create(unsigned int parent) {
+    uint32_t depth = 0;
+    uint32_t parentIndex = 0;
+    if (parent != NO_PARENT) {
+        depth = locations[parent].depth + 1;
+        parentIndex = locations[parent].index;
+    }
+    if (depth == depths.size()) {
+        depths.emplace_back();
+    }
+
+    Depth &level = depths[depth];
+    uint32_t index = (uint32_t)level.parent.size();
+    for (std::vector<float> *component :
+         {&level.positionX, &level.positionY, &level.positionZ,
+          &level.rotationX, &level.rotationY, &level.rotationZ}) {
+        component->push_back(0.0f);
+    }
+    for (std::vector<float> *component :
+         {&level.rotationW, &level.scaleX, &level.scaleY, &level.scaleZ}) {
+        component->push_back(1.0f);
+    }
+    level.parent.push_back(parentIndex);
+    level.dirty.push_back(1);
+    level.changed.push_back(0);
+    level.world.push_back(Matrix());
+
+    locations.push_back({depth, index});
+    return (unsigned int)locations.size() - 1;
+}
+
+void TransformSystem::SetPosition(unsigned int transform, float x, float y,
+                                  float z) {
+    Location location = locations[transform];
+    Depth &level = depths[location.depth];
+    level.positionX[location.index] = x;
+    level.positionY[location.index] = y;
+    level.positionZ[location.index] = z;
+    level.dirty[location.index] = 1;
+}
+
+void TransformSystem::SetRotation(unsigned int transform, float x, float y,
+                                  float z, float w) {
+    Location location = locations[transform];
+    Depth &level = depths[location.depth];
+    level.rotationX[location.index] = x;
+    level.rotationY[location.index] = y;
+    level.rotationZ[location.index] = z;
+    level.rotationW[location.index] = w;
+    level.dirty[location.index] = 1;
+}
+
+void TransformSystem::SetScale(unsigned int transform, float x, float y,
+                               float z) {
+    Location location = locations[transform];
+    Depth &level = depths[location.depth];
+    level.scaleX[location.index] = x;
+    level.scaleY[location.index] = y;
+    level.scaleZ[location.index] = z;
+    level.dirty[location.index] = 1;
+}
+
+void TransformSystem::Update(JobSystem *jobs) {
+    std::atomic<size_t> updated{0};
+    for (uint32_t depth = 0; depth < depths.size(); depth++) {
+        // Every parent is final before its depth's children start.
+        auto updateRange = [&](size_t begin, size_t end) {
+            size_t count = 0;
+            UpdateRange(depth, begin, end, count);
+            updated.fetch_add(count, std::memory_order_relaxed);
+        };
+
+        size_t count = depths[depth].parent.size();
+        if (jobs != nullptr) {
+            jobs->ParallelFor(count, UPDATE_GRAIN, updateRange);
+        } else {
+            updateRange(0, count);
+        }
+    }
+    lastUpdateCount = updated.load();
+}
+
+void TransformSystem::UpdateRange(uint32_t depth, size_t begin, size_t end,
+                                  size_t &updated) {
+    Depth &level = depths[depth];
+    const Depth *parents = depth > 0 ? &depths[depth - 1] : nullptr;
+
+    for (size_t i = begin; i < end; i++) {
+        bool changed = level.dirty[i] != 0 ||
+                       (parents != nullptr &&
+                        parents->changed[level.parent[i]] != 0);
+        level.changed[i] = changed;
+        level.dirty[i] = 0;
+        if (!changed) {
+            continue;
+        }
+
+        mat4 local = mat4::Trs(
+            vec3(level.positionX[i], level.positionY[i], level.positionZ[i]),
+            quat(level.rotationX[i], level.rotationY[i], level.rotationZ[i],
+                 level.rotationW[i]),
+            vec3(level.scaleX[i], level.scaleY[i], level.scaleZ[i]));
+        level.world[i] =
+            parents != nullptr ? mul(parents->world[level.parent[i]], local)
+                               : local;
+        updated++;
+    }
+}
+
+const TransformSystem::Matrix &
+TransformSystem::WorldMatrix(unsigned int transform) const {
+    Location location = locations[transform];
+    return depths[location.depth].world[location.index];
+}
+
+void TransformSystem::CopyWorldMatrices(Matrix *out, JobSystem *jobs) const {
+    auto copyRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            out[i] = WorldMatrix((unsigned int)i);
+        }
+    };
+    if (jobs != nullptr) {
+        jobs->ParallelFor(locations.size(), 16 * 1024, copyRange);
+    } else {
+        copyRange(0, locations.size());
+    }
+}
+
+size_t TransformSystem::Count() const { return locations.size(); }
+
+size_t TransformSystem::LastUpdateCount() const { return lastUpdateCount; }
+
+void TransformSystem::Clear() {
+    depths.clear();
+    locations.clear();
+    lastUpdateCount = 0;
+}
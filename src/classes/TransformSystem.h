@@ -0,0 +1,80 @@
+#ifndef TRANSFORM_SYSTEM_H
+#define TRANSFORM_SYSTEM_H
+
+#include "JobSystem.h"
+#include "VectorMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Transform hierarchy that computes world matrices for many objects.
+//
+// Local translation, rotation and scale are stored as structure of arrays,
+// one set of arrays per hierarchy depth, so a parent is always updated in
+// an earlier pass than its children. Update walks the depths in order and
+// computes each depth's world matrices in parallel with SIMD mat4 multiplies.
+// Transforms that were not changed and whose parent did not move are
+// skipped, so an untouched subtree costs one flag test per node.
+class TransformSystem {
+  public:
+    // Parent handle of root transforms.
+    static const unsigned int NO_PARENT = 0xffffffffu;
+
+    typedef mat4 Matrix;
+
+    // Adds an identity transform under parent, returns its handle.
+    unsigned int Create(unsigned int parent = NO_PARENT);
+
+    // Set the local transform, relative to the parent.
+    void SetPosition(unsigned int transform, float x, float y, float z);
+    void SetRotation(unsigned int transform, float x, float y, float z,
+                     float w);
+    void SetScale(unsigned int transform, float x, float y, float z);
+
+    // Recomputes the world matrices of changed transforms and their
+    // descendants. Runs on jobs if given.
+    void Update(JobSystem *jobs = nullptr);
+
+    // World matrix of a transform as of the last Update.
+    const Matrix &WorldMatrix(unsigned int transform) const;
+
+    // Copies every world matrix to out, in handle order.
+    void CopyWorldMatrices(Matrix *out, JobSystem *jobs = nullptr) const;
+
+    // Number of transforms, and of world matrices the last Update
+    // recomputed.
+    size_t Count() const;
+    size_t LastUpdateCount() const;
+
+    // Removes every transform.
+    void Clear();
+
+  private:
+    // Transforms of one hierarchy depth.
+    struct Depth {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+        std::vector<float> scaleX, scaleY, scaleZ;
+        // Index of the parent in the depth above.
+        std::vector<uint32_t> parent;
+        // Set by the setters; changed is set by Update for the children.
+        std::vector<uint8_t> dirty;
+        std::vector<uint8_t> changed;
+        std::vector<Matrix> world;
+    };
+
+    // Where each handle lives.
+    struct Location {
+        uint32_t depth;
+        uint32_t index;
+    };
+
+    std::vector<Depth> depths;
+    std::vector<Location> locations;
+    size_t lastUpdateCount = 0;
+
+    void UpdateRange(uint32_t depth, size_t begin, size_t end,
+                     size_t &updated);
+};
+
+#endif
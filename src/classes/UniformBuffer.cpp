@@ -0,0 +1,34 @@
+#include "UniformBuffer.h"
+#include "Trace.h"
+#include <cstddef>
+
+UniformBuffer::UniformBuffer(GLsizeiptr size, GLenum usage) : size(size) {
+    TRACE_SCOPE("UniformBuffer::UniformBuffer");
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_UNIFORM_BUFFER, ID());
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, usage);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::Update(GLintptr offset, GLsizeiptr dataSize,
+                           const void *data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, ID());
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+}
+
+void UniformBuffer::BindBase(unsigned int binding) {
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID());
+}
+
+void UniformBuffer::BindRange(unsigned int binding, GLintptr offset,
+                              GLsizeiptr rangeSize) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID(), offset, rangeSize);
+}
+
+void UniformBuffer::Bind() { glBindBuffer(GL_UNIFORM_BUFFER, ID()); }
+
+void UniformBuffer::Unbind() { glBindBuffer(GL_UNIFORM_BUFFER, 0); }
+
+void UniformBuffer::Delete() { buffer.Reset(); }
+
+GLuint UniformBuffer::ID() const { return buffer.Name(); }
@@ -0,0 +1,40 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include "GLHandlePool.h"
+#include "../glad/glad.h"
+
+class UniformBuffer {
+  public:
+    // Name of the UBO, 0 once deleted.
+    GLuint ID() const;
+
+    // Size of the buffer in bytes.
+    GLsizeiptr size;
+
+    // Constructor that generates a UBO of the given size with no contents.
+    UniformBuffer(GLsizeiptr size, GLenum usage = GL_DYNAMIC_DRAW);
+
+    // Writes data into the UBO starting at offset.
+    void Update(GLintptr offset, GLsizeiptr dataSize, const void *data);
+
+    // Binds the whole UBO to a uniform block binding point.
+    void BindBase(unsigned int binding);
+
+    // Binds part of the UBO to a uniform block binding point.
+    void BindRange(unsigned int binding, GLintptr offset, GLsizeiptr rangeSize);
+
+    // Binds the UBO.
+    void Bind();
+
+    // Unbinds the UBO.
+    void Unbind();
+
+    // Deletes the UBO.
+    void Delete();
+
+  private:
+    GLBuffer buffer;
+};
+
+#endif
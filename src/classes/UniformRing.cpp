@@ -0,0 +1,119 @@
+#include "UniformRing.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+UniformRing::UniformRing(GLsizeiptr bytesPerFrame, unsigned int framesInFlight)
+    : bytesPerFrame(bytesPerFrame), framesInFlight(framesInFlight),
+      fences(framesInFlight, nullptr) {
+    TRACE_SCOPE("UniformRing::UniformRing");
+    // Offsets passed to glBindBufferRange must be a multiple of this.
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+    // Rounded up so every frame's region starts aligned too.
+    this->bytesPerFrame =
+        (bytesPerFrame + alignment - 1) / alignment * alignment;
+
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_UNIFORM_BUFFER, ID());
+    glBufferData(GL_UNIFORM_BUFFER, this->bytesPerFrame * framesInFlight,
+                 NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing::~UniformRing() { Delete(); }
+
+UniformRing::UniformRing(UniformRing &&other) noexcept
+    : buffer(std::move(other.buffer)), bytesPerFrame(other.bytesPerFrame),
+      framesInFlight(other.framesInFlight), frame(other.frame),
+      alignment(other.alignment), head(other.head),
+      mapped(std::exchange(other.mapped, nullptr)),
+      fences(std::move(other.fences)) {
+    other.fences.clear();
+}
+
+UniformRing &UniformRing::operator=(UniformRing &&other) noexcept {
+    if (this != &other) {
+        Delete();
+        buffer = std::move(other.buffer);
+        bytesPerFrame = other.bytesPerFrame;
+        framesInFlight = other.framesInFlight;
+        frame = other.frame;
+        alignment = other.alignment;
+        head = other.head;
+        mapped = std::exchange(other.mapped, nullptr);
+        fences = std::move(other.fences);
+        other.fences.clear();
+    }
+    return *this;
+}
+
+void UniformRing::BeginFrame() {
+    // Only blocks if the GPU is more than framesInFlight frames behind.
+    if (fences[frame]) {
+        glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GL_TIMEOUT_IGNORED);
+        glDeleteSync(fences[frame]);
+        fences[frame] = nullptr;
+    }
+
+    head = 0;
+    glBindBuffer(GL_UNIFORM_BUFFER, ID());
+    mapped = (unsigned char *)glMapBufferRange(
+        GL_UNIFORM_BUFFER, frame * bytesPerFrame, bytesPerFrame,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+}
+
+GLintptr UniformRing::Push(const void *data, GLsizeiptr size) {
+    if (mapped == nullptr || head + size > bytesPerFrame) {
+        return -1;
+    }
+
+    GLintptr offset = head;
+    memcpy(mapped + offset, data, size);
+    head = (offset + size + alignment - 1) / alignment * alignment;
+    return frame * bytesPerFrame + offset;
+}
+
+void UniformRing::Unmap() {
+    if (mapped == nullptr) {
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ID());
+    // Padding after the last push can take head past the region.
+    if (head > 0) {
+        glFlushMappedBufferRange(GL_UNIFORM_BUFFER, 0,
+                                 std::min(head, (GLintptr)bytesPerFrame));
+    }
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    mapped = nullptr;
+}
+
+void UniformRing::BindRange(unsigned int binding, GLintptr offset,
+                            GLsizeiptr size) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID(), offset, size);
+}
+
+void UniformRing::EndFrame() {
+    Unmap();
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame = (frame + 1) % framesInFlight;
+}
+
+void UniformRing::Delete() {
+    Unmap();
+    for (GLsync &fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    buffer.Reset();
+}
+
+GLuint UniformRing::ID() const { return buffer.Name(); }
@@ -0,0 +1,62 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "GLHandlePool.h"
+#include "../glad/glad.h"
+#include <vector>
+
+// Packs every per-draw constant of a frame into one large uniform buffer.
+// The buffer is split into one region per frame in flight so the CPU can
+// write frame N+1 while the GPU still reads frame N. Usage per frame:
+//   BeginFrame() -> Push() for every draw -> Unmap() -> BindRange() + draw
+//   -> EndFrame().
+class UniformRing {
+  public:
+    // Name of the buffer, 0 once deleted.
+    GLuint ID() const;
+
+    // Constructor that allocates bytesPerFrame, rounded up to the uniform
+    // buffer offset alignment, for each frame in flight.
+    UniformRing(GLsizeiptr bytesPerFrame, unsigned int framesInFlight = 3);
+
+    // Deletes whatever Delete() has not.
+    ~UniformRing();
+
+    UniformRing(UniformRing &&other) noexcept;
+    UniformRing &operator=(UniformRing &&other) noexcept;
+
+    UniformRing(const UniformRing &) = delete;
+    UniformRing &operator=(const UniformRing &) = delete;
+
+    // Waits until the GPU is done with this frame's region and maps it.
+    void BeginFrame();
+
+    // Copies data into the mapped region and returns its offset in the
+    // buffer, or -1 if the region is full.
+    GLintptr Push(const void *data, GLsizeiptr size);
+
+    // Flushes the written bytes and unmaps the region. Must be called before
+    // any draw reads from the ring.
+    void Unmap();
+
+    // Binds one pushed block to a uniform block binding point.
+    void BindRange(unsigned int binding, GLintptr offset, GLsizeiptr size);
+
+    // Fences the frame's region and advances to the next one.
+    void EndFrame();
+
+    // Deletes the buffer and any pending fences.
+    void Delete();
+
+  private:
+    GLBuffer buffer;
+    GLsizeiptr bytesPerFrame;
+    unsigned int framesInFlight;
+    unsigned int frame = 0;
+    GLint alignment = 256;
+    GLintptr head = 0;
+    unsigned char *mapped = nullptr;
+    std::vector<GLsync> fences;
+};
+
+#endif
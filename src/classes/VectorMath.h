@@ -0,0 +1,505 @@
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#include <cmath>
+#include <cstddef>
+
+// Vector, matrix and quaternion math, header only.
+//
+// Matrices are column-major like OpenGL, so mat4::m can be passed straight
+// to glUniformMatrix4fv or copied into a uniform block. mat4 multiply,
+// batch point transforms and quaternion slerp use SSE on x86, and plain
+// C++ elsewhere or when VECTOR_MATH_SCALAR is defined. The plain versions
+// are always available with a Scalar suffix, as a reference and a
+// benchmark baseline. inverse is plain C++ everywhere: an SSE version
+// measured no faster than the compiler's code for it.
+//
+// The NEON path for AArch64 has not been built or tested yet, so it is
+// only used when VECTOR_MATH_NEON_UNTESTED is defined.
+
+#if !defined(VECTOR_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define VECTOR_MATH_SSE 1
+#elif !defined(VECTOR_MATH_SCALAR) && defined(VECTOR_MATH_NEON_UNTESTED) &&    \
+    defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VECTOR_MATH_NEON 1
+#endif
+
+struct vec3 {
+    float x, y, z;
+
+    constexpr vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+    constexpr explicit vec3(float s) : x(s), y(s), z(s) {}
+    constexpr vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+};
+
+struct alignas(16) vec4 {
+    float x, y, z, w;
+
+    constexpr vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+    constexpr explicit vec4(float s) : x(s), y(s), z(s), w(s) {}
+    constexpr vec4(float x, float y, float z, float w)
+        : x(x), y(y), z(z), w(w) {}
+    constexpr vec4(const vec3 &v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+    constexpr vec3 xyz() const { return vec3(x, y, z); }
+};
+
+// A rotation as a unit quaternion, (x, y, z) imaginary and w real.
+struct alignas(16) quat {
+    float x, y, z, w;
+
+    // The identity rotation.
+    constexpr quat() : x(0.0f), y(0.0f), z(0.0f), w(1.0f) {}
+    constexpr quat(float x, float y, float z, float w)
+        : x(x), y(y), z(z), w(w) {}
+
+    // Rotation by angle radians, counter-clockwise around a unit axis.
+    static quat AxisAngle(const vec3 &axis, float angle) {
+        float s = std::sin(0.5f * angle);
+        return quat(axis.x * s, axis.y * s, axis.z * s,
+                    std::cos(0.5f * angle));
+    }
+};
+
+// A column-major 4x4 matrix: element (row, column) is m[column * 4 + row].
+struct alignas(16) mat4 {
+    float m[16];
+
+    // The identity matrix.
+    constexpr mat4()
+        : m{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f} {}
+    constexpr mat4(const vec4 &c0, const vec4 &c1, const vec4 &c2,
+                   const vec4 &c3)
+        : m{c0.x, c0.y, c0.z, c0.w, c1.x, c1.y, c1.z, c1.w,
+            c2.x, c2.y, c2.z, c2.w, c3.x, c3.y, c3.z, c3.w} {}
+
+    constexpr vec4 Column(int column) const {
+        return vec4(m[column * 4], m[column * 4 + 1], m[column * 4 + 2],
+                    m[column * 4 + 3]);
+    }
+    constexpr vec4 Row(int row) const {
+        return vec4(m[row], m[4 + row], m[8 + row], m[12 + row]);
+    }
+
+    static constexpr mat4 Translation(const vec3 &t) {
+        return mat4(vec4(1.0f, 0.0f, 0.0f, 0.0f), vec4(0.0f, 1.0f, 0.0f, 0.0f),
+                    vec4(0.0f, 0.0f, 1.0f, 0.0f), vec4(t, 1.0f));
+    }
+
+    static constexpr mat4 Scale(const vec3 &s) {
+        return mat4(vec4(s.x, 0.0f, 0.0f, 0.0f), vec4(0.0f, s.y, 0.0f, 0.0f),
+                    vec4(0.0f, 0.0f, s.z, 0.0f), vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    }
+
+    static constexpr mat4 Rotation(const quat &q) {
+        return Trs(vec3(), q, vec3(1.0f));
+    }
+
+    // translation * rotation * scale, without any multiplies.
+    static constexpr mat4 Trs(const vec3 &t, const quat &r, const vec3 &s) {
+        return mat4(vec4((1.0f - 2.0f * (r.y * r.y + r.z * r.z)) * s.x,
+                         2.0f * (r.x * r.y + r.z * r.w) * s.x,
+                         2.0f * (r.x * r.z - r.y * r.w) * s.x, 0.0f),
+                    vec4(2.0f * (r.x * r.y - r.z * r.w) * s.y,
+                         (1.0f - 2.0f * (r.x * r.x + r.z * r.z)) * s.y,
+                         2.0f * (r.y * r.z + r.x * r.w) * s.y, 0.0f),
+                    vec4(2.0f * (r.x * r.z + r.y * r.w) * s.z,
+                         2.0f * (r.y * r.z - r.x * r.w) * s.z,
+                         (1.0f - 2.0f * (r.x * r.x + r.y * r.y)) * s.z, 0.0f),
+                    vec4(t, 1.0f));
+    }
+
+    // OpenGL perspective projection, depth mapped to [-1, 1].
+    static mat4 Perspective(float fovY, float aspect, float nearPlane,
+                            float farPlane) {
+        float f = 1.0f / std::tan(0.5f * fovY);
+        return mat4(vec4(f / aspect, 0.0f, 0.0f, 0.0f),
+                    vec4(0.0f, f, 0.0f, 0.0f),
+                    vec4(0.0f, 0.0f,
+                         (farPlane + nearPlane) / (nearPlane - farPlane),
+                         -1.0f),
+                    vec4(0.0f, 0.0f,
+                         2.0f * farPlane * nearPlane / (nearPlane - farPlane),
+                         0.0f));
+    }
+
+    // View matrix of a camera at eye looking at target.
+    static mat4 LookAt(const vec3 &eye, const vec3 &target, const vec3 &up);
+};
+
+// vec3 and vec4 arithmetic, componentwise.
+
+constexpr vec3 operator+(const vec3 &a, const vec3 &b) {
+    return vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+constexpr vec3 operator-(const vec3 &a, const vec3 &b) {
+    return vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+constexpr vec3 operator-(const vec3 &v) { return vec3(-v.x, -v.y, -v.z); }
+constexpr vec3 operator*(const vec3 &a, const vec3 &b) {
+    return vec3(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+constexpr vec3 operator*(const vec3 &v, float s) {
+    return vec3(v.x * s, v.y * s, v.z * s);
+}
+constexpr vec3 operator*(float s, const vec3 &v) { return v * s; }
+
+constexpr vec4 operator+(const vec4 &a, const vec4 &b) {
+    return vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+}
+constexpr vec4 operator-(const vec4 &a, const vec4 &b) {
+    return vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w);
+}
+constexpr vec4 operator*(const vec4 &v, float s) {
+    return vec4(v.x * s, v.y * s, v.z * s, v.w * s);
+}
+constexpr vec4 operator*(float s, const vec4 &v) { return v * s; }
+
+constexpr float dot(const vec3 &a, const vec3 &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+constexpr float dot(const vec4 &a, const vec4 &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+constexpr float dot(const quat &a, const quat &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+constexpr vec3 cross(const vec3 &a, const vec3 &b) {
+    return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+                a.x * b.y - a.y * b.x);
+}
+
+inline float length(const vec3 &v) { return std::sqrt(dot(v, v)); }
+
+inline vec3 normalize(const vec3 &v) { return v * (1.0f / length(v)); }
+
+inline quat normalize(const quat &q) {
+    float scale = 1.0f / std::sqrt(dot(q, q));
+    return quat(q.x * scale, q.y * scale, q.z * scale, q.w * scale);
+}
+
+// Hamilton product: rotating by b and then by a.
+constexpr quat operator*(const quat &a, const quat &b) {
+    return quat(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+constexpr quat conjugate(const quat &q) { return quat(-q.x, -q.y, -q.z, q.w); }
+
+// Rotates v by the unit quaternion q.
+constexpr vec3 rotate(const quat &q, const vec3 &v) {
+    // v + 2w(u x v) + 2u x (u x v), with u the imaginary part.
+    return v + cross(vec3(q.x, q.y, q.z), v) * (2.0f * q.w) +
+           cross(vec3(q.x, q.y, q.z), cross(vec3(q.x, q.y, q.z), v)) * 2.0f;
+}
+
+constexpr mat4 transpose(const mat4 &a) {
+    return mat4(a.Row(0), a.Row(1), a.Row(2), a.Row(3));
+}
+
+constexpr vec4 mul(const mat4 &a, const vec4 &v) {
+    return a.Column(0) * v.x + a.Column(1) * v.y + a.Column(2) * v.z +
+           a.Column(3) * v.w;
+}
+
+// a * (p, 1), dropping w. Exact for affine transforms.
+constexpr vec3 transformPoint(const mat4 &a, const vec3 &p) {
+    return mul(a, vec4(p, 1.0f)).xyz();
+}
+
+inline mat4 mat4::LookAt(const vec3 &eye, const vec3 &target,
+                         const vec3 &up) {
+    vec3 forward = normalize(target - eye);
+    vec3 right = normalize(cross(forward, up));
+    vec3 cameraUp = cross(right, forward);
+    return mat4(vec4(right.x, cameraUp.x, -forward.x, 0.0f),
+                vec4(right.y, cameraUp.y, -forward.y, 0.0f),
+                vec4(right.z, cameraUp.z, -forward.z, 0.0f),
+                vec4(-dot(right, eye), -dot(cameraUp, eye), dot(forward, eye),
+                     1.0f));
+}
+
+// Scalar reference versions of the SIMD functions below.
+
+inline mat4 mulScalar(const mat4 &a, const mat4 &b) {
+    mat4 out;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            out.m[column * 4 + row] = a.m[row] * b.m[column * 4] +
+                                      a.m[4 + row] * b.m[column * 4 + 1] +
+                                      a.m[8 + row] * b.m[column * 4 + 2] +
+                                      a.m[12 + row] * b.m[column * 4 + 3];
+        }
+    }
+    return out;
+}
+
+// Inverse from the 3D cross products of the columns. The matrix must be
+// invertible.
+inline mat4 inverseScalar(const mat4 &matrix) {
+    const float *m = matrix.m;
+    vec3 a(m[0], m[1], m[2]), b(m[4], m[5], m[6]);
+    vec3 c(m[8], m[9], m[10]), d(m[12], m[13], m[14]);
+    float x = m[3], y = m[7], z = m[11], w = m[15];
+
+    vec3 s = cross(a, b);
+    vec3 t = cross(c, d);
+    vec3 u = a * y - b * x;
+    vec3 v = c * w - d * z;
+    float invDet = 1.0f / (dot(s, v) + dot(t, u));
+    s = s * invDet;
+    t = t * invDet;
+    u = u * invDet;
+    v = v * invDet;
+
+    // These are the rows of the inverse.
+    vec3 r0 = cross(b, v) + t * y;
+    vec3 r1 = cross(v, a) - t * x;
+    vec3 r2 = cross(d, u) + s * w;
+    vec3 r3 = cross(u, c) - s * z;
+    return mat4(vec4(r0.x, r1.x, r2.x, r3.x), vec4(r0.y, r1.y, r2.y, r3.y),
+                vec4(r0.z, r1.z, r2.z, r3.z),
+                vec4(-dot(b, t), dot(a, t), -dot(d, s), dot(c, s)));
+}
+
+// Writes a * (in[i], 1) to out[i], dropping w. in and out may be the same
+// array.
+inline void transformPointsScalar(const mat4 &a, const vec3 *in, vec3 *out,
+                                  size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = transformPoint(a, in[i]);
+    }
+}
+
+// Writes a * in[i] to out[i]. in and out may be the same array.
+inline void transformPointsScalar(const mat4 &a, const vec4 *in, vec4 *out,
+                                  size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = mul(a, in[i]);
+    }
+}
+
+namespace vector_math_detail {
+
+// Weights of a and b in slerp(a, b, t), given cosTheta = |dot(a, b)|.
+// Returns false when the rotations are so close that the weights are
+// linear and the result needs normalizing.
+inline bool slerpWeights(float cosTheta, float t, float &weightA,
+                         float &weightB) {
+    if (cosTheta > 0.9995f) {
+        weightA = 1.0f - t;
+        weightB = t;
+        return false;
+    }
+    float theta = std::acos(cosTheta);
+    float invSin = 1.0f / std::sqrt(1.0f - cosTheta * cosTheta);
+    weightA = std::sin((1.0f - t) * theta) * invSin;
+    weightB = std::sin(t * theta) * invSin;
+    return true;
+}
+
+} // namespace vector_math_detail
+
+// Spherical interpolation from a to b along the shorter arc.
+inline quat slerpScalar(const quat &a, const quat &b, float t) {
+    float cosTheta = dot(a, b);
+    float sign = cosTheta < 0.0f ? -1.0f : 1.0f;
+    float weightA, weightB;
+    bool unit = vector_math_detail::slerpWeights(cosTheta * sign, t, weightA,
+                                                 weightB);
+    weightB *= sign;
+    quat out(a.x * weightA + b.x * weightB, a.y * weightA + b.y * weightB,
+             a.z * weightA + b.z * weightB, a.w * weightA + b.w * weightB);
+    return unit ? out : normalize(out);
+}
+
+#if defined(VECTOR_MATH_SSE) || defined(VECTOR_MATH_NEON)
+
+namespace vector_math_detail {
+
+// The few operations the SIMD functions need, for SSE and NEON.
+#ifdef VECTOR_MATH_SSE
+typedef __m128 simd4;
+
+inline simd4 load(const float *p) { return _mm_load_ps(p); }
+inline simd4 loadUnaligned(const float *p) { return _mm_loadu_ps(p); }
+inline void store(float *p, simd4 v) { _mm_store_ps(p, v); }
+inline void storeUnaligned(float *p, simd4 v) { _mm_storeu_ps(p, v); }
+inline simd4 splat(float s) { return _mm_set1_ps(s); }
+template <int LANE> inline simd4 lane(simd4 v) {
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(LANE, LANE, LANE, LANE));
+}
+inline simd4 sub(simd4 a, simd4 b) { return _mm_sub_ps(a, b); }
+inline simd4 mul(simd4 a, simd4 b) { return _mm_mul_ps(a, b); }
+// a * b + c.
+inline simd4 madd(simd4 a, simd4 b, simd4 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+// Sum of the lanes, in every lane.
+inline simd4 sum(simd4 v) {
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+inline float first(simd4 v) { return _mm_cvtss_f32(v); }
+#else
+typedef float32x4_t simd4;
+
+inline simd4 load(const float *p) { return vld1q_f32(p); }
+inline simd4 loadUnaligned(const float *p) { return vld1q_f32(p); }
+inline void store(float *p, simd4 v) { vst1q_f32(p, v); }
+inline void storeUnaligned(float *p, simd4 v) { vst1q_f32(p, v); }
+inline simd4 splat(float s) { return vdupq_n_f32(s); }
+template <int LANE> inline simd4 lane(simd4 v) {
+    return vdupq_laneq_f32(v, LANE);
+}
+inline simd4 sub(simd4 a, simd4 b) { return vsubq_f32(a, b); }
+inline simd4 mul(simd4 a, simd4 b) { return vmulq_f32(a, b); }
+inline simd4 madd(simd4 a, simd4 b, simd4 c) { return vfmaq_f32(c, a, b); }
+inline simd4 sum(simd4 v) { return vdupq_n_f32(vaddvq_f32(v)); }
+inline float first(simd4 v) { return vgetq_lane_f32(v, 0); }
+#endif
+
+// a * v for a matrix held as four column registers.
+inline simd4 transform(const simd4 columns[4], simd4 v) {
+    simd4 result = mul(columns[0], lane<0>(v));
+    result = madd(columns[1], lane<1>(v), result);
+    result = madd(columns[2], lane<2>(v), result);
+    return madd(columns[3], lane<3>(v), result);
+}
+
+} // namespace vector_math_detail
+
+inline mat4 mul(const mat4 &a, const mat4 &b) {
+    using namespace vector_math_detail;
+    simd4 columns[4] = {load(a.m), load(a.m + 4), load(a.m + 8),
+                        load(a.m + 12)};
+    mat4 out;
+    for (int column = 0; column < 4; column++) {
+        store(out.m + column * 4,
+              transform(columns, load(b.m + column * 4)));
+    }
+    return out;
+}
+
+inline void transformPoints(const mat4 &a, const vec3 *in, vec3 *out,
+                            size_t count) {
+    using namespace vector_math_detail;
+    // Broadcast the 12 elements that matter for an affine transform.
+    simd4 m00 = splat(a.m[0]), m10 = splat(a.m[1]), m20 = splat(a.m[2]);
+    simd4 m01 = splat(a.m[4]), m11 = splat(a.m[5]), m21 = splat(a.m[6]);
+    simd4 m02 = splat(a.m[8]), m12 = splat(a.m[9]), m22 = splat(a.m[10]);
+    simd4 m03 = splat(a.m[12]), m13 = splat(a.m[13]), m23 = splat(a.m[14]);
+
+    // Four points per iteration, converted to one register per component.
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float *source = &in[i].x;
+        float *destination = &out[i].x;
+#ifdef VECTOR_MATH_SSE
+        // (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3)
+        simd4 p0 = loadUnaligned(source), p1 = loadUnaligned(source + 4);
+        simd4 p2 = loadUnaligned(source + 8);
+        // (x2 y2 x3 y3) and (y0 z0 y1 z1).
+        simd4 xy23 = _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(2, 1, 3, 2));
+        simd4 yz01 = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(1, 0, 2, 1));
+        simd4 x = _mm_shuffle_ps(p0, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+        simd4 y = _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+        simd4 z = _mm_shuffle_ps(yz01, p2, _MM_SHUFFLE(3, 0, 3, 1));
+#else
+        float32x4x3_t points = vld3q_f32(source);
+        simd4 x = points.val[0], y = points.val[1], z = points.val[2];
+#endif
+        simd4 outX = madd(m02, z, madd(m01, y, madd(m00, x, m03)));
+        simd4 outY = madd(m12, z, madd(m11, y, madd(m10, x, m13)));
+        simd4 outZ = madd(m22, z, madd(m21, y, madd(m20, x, m23)));
+#ifdef VECTOR_MATH_SSE
+        // The same shuffles backwards.
+        xy23 = _mm_unpackhi_ps(outX, outY);
+        yz01 = _mm_unpacklo_ps(outY, outZ);
+        simd4 x01yz0 = _mm_shuffle_ps(outX, yz01, _MM_SHUFFLE(1, 0, 1, 0));
+        simd4 z23xy3 = _mm_shuffle_ps(outZ, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+        storeUnaligned(destination, _mm_shuffle_ps(x01yz0, x01yz0,
+                                                   _MM_SHUFFLE(1, 3, 2, 0)));
+        storeUnaligned(destination + 4,
+                       _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(1, 0, 3, 2)));
+        storeUnaligned(destination + 8, _mm_shuffle_ps(z23xy3, z23xy3,
+                                                       _MM_SHUFFLE(1, 3, 2, 0)));
+#else
+        float32x4x3_t result = {{outX, outY, outZ}};
+        vst3q_f32(destination, result);
+#endif
+    }
+    transformPointsScalar(a, in + i, out + i, count - i);
+}
+
+inline void transformPoints(const mat4 &a, const vec4 *in, vec4 *out,
+                            size_t count) {
+    using namespace vector_math_detail;
+    simd4 columns[4] = {load(a.m), load(a.m + 4), load(a.m + 8),
+                        load(a.m + 12)};
+    for (size_t i = 0; i < count; i++) {
+        store(&out[i].x, transform(columns, load(&in[i].x)));
+    }
+}
+
+inline quat slerp(const quat &a, const quat &b, float t) {
+    using namespace vector_math_detail;
+    simd4 va = load(&a.x), vb = load(&b.x);
+    float cosTheta = first(sum(mul(va, vb)));
+    float sign = cosTheta < 0.0f ? -1.0f : 1.0f;
+    float weightA, weightB;
+    bool unit = slerpWeights(cosTheta * sign, t, weightA, weightB);
+    simd4 result = madd(va, splat(weightA), mul(vb, splat(weightB * sign)));
+    if (!unit) {
+        result = mul(result, splat(1.0f / std::sqrt(first(
+                                 sum(mul(result, result))))));
+    }
+    quat out;
+    store(&out.x, result);
+    return out;
+}
+
+#else
+
+inline mat4 mul(const mat4 &a, const mat4 &b) { return mulScalar(a, b); }
+
+inline void transformPoints(const mat4 &a, const vec3 *in, vec3 *out,
+                            size_t count) {
+    transformPointsScalar(a, in, out, count);
+}
+
+inline void transformPoints(const mat4 &a, const vec4 *in, vec4 *out,
+                            size_t count) {
+    transformPointsScalar(a, in, out, count);
+}
+
+inline quat slerp(const quat &a, const quat &b, float t) {
+    return slerpScalar(a, b, t);
+}
+
+#endif
+
+inline mat4 inverse(const mat4 &a) { return inverseScalar(a); }
+
+inline mat4 operator*(const mat4 &a, const mat4 &b) { return mul(a, b); }
+
+constexpr vec4 operator*(const mat4 &a, const vec4 &v) { return mul(a, v); }
+
+// Name of the SIMD path the functions above were compiled with.
+inline const char *vectorMathKernel() {
+#if defined(VECTOR_MATH_SSE)
+    return "sse";
+#elif defined(VECTOR_MATH_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+#endif
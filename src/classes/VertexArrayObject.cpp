@@ -1,7 +1,11 @@
 #include "VertexArrayObject.h"
+#include "Trace.h"
 #include "VertexBufferObject.h"
 
-VertexArrayObject::VertexArrayObject() { glGenVertexArrays(1, &ID); }
+VertexArrayObject::VertexArrayObject() {
+    TRACE_SCOPE("VertexArrayObject::VertexArrayObject");
+    vertexArray = GLVertexArray::Create();
+}
 
 void VertexArrayObject::LinkVBO(VertexBufferObject &VBO, unsigned int layout) {
     VBO.Bind();
@@ -12,16 +16,19 @@ void VertexArrayObject::LinkVBO(VertexBufferObject &VBO, unsigned int layout) {
 
 void VertexArrayObject::LinkAttrib(VertexBufferObject &VBO, unsigned int layout,
                                    unsigned int numComponents, GLenum type,
-                                   GLsizeiptr stride, void *offset) {
+                                   GLsizeiptr stride, void *offset,
+                                   GLboolean normalized) {
     VBO.Bind();
-    glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride,
+    glVertexAttribPointer(layout, numComponents, type, normalized, stride,
                           offset);
     glEnableVertexAttribArray(layout);
     VBO.Unbind();
 }
 
-void VertexArrayObject::Bind() { glBindVertexArray(ID); }
+void VertexArrayObject::Bind() { glBindVertexArray(ID()); }
 
 void VertexArrayObject::Unbind() { glBindVertexArray(0); }
 
-void VertexArrayObject::Delete() { glDeleteVertexArrays(1, &ID); }
+void VertexArrayObject::Delete() { vertexArray.Reset(); }
+
+GLuint VertexArrayObject::ID() const { return vertexArray.Name(); }
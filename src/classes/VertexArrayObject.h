@@ -2,12 +2,13 @@
 #define VERTEX_ARRAY_OBJECT_H
 
 #include "VertexBufferObject.h"
+#include "GLHandlePool.h"
 #include "../glad/glad.h"
 
 class VertexArrayObject {
   public:
-    // ID reference for the VAO.
-    unsigned int ID;
+    // Name of the VAO, 0 once deleted.
+    GLuint ID() const;
 
     // Constructor that generates VAO ID.
     VertexArrayObject();
@@ -15,8 +16,9 @@ class VertexArrayObject {
     // Links a VBO to the VAO using a certain layout.
     void LinkVBO(VertexBufferObject &VBO, unsigned int layout);
 
-    // Links a VBO attribute to the VAO. 
-    void LinkAttrib(VertexBufferObject& VBO, unsigned int layout, unsigned int numComponents, GLenum type, GLsizeiptr stride, void* offset);
+    // Links a VBO attribute to the VAO. Integer attributes are read as
+    // 0..1 (or -1..1) floats when normalized.
+    void LinkAttrib(VertexBufferObject& VBO, unsigned int layout, unsigned int numComponents, GLenum type, GLsizeiptr stride, void* offset, GLboolean normalized = GL_FALSE);
 
     // Bind the VAO.
     void Bind();
@@ -26,6 +28,9 @@ class VertexArrayObject {
 
     // Deletes the VAO.
     void Delete();
+
+  private:
+    GLVertexArray vertexArray;
 };
 
 #endif
@@ -1,13 +1,24 @@
 #include "VertexBufferObject.h"
+#include "Trace.h"
 
 VertexBufferObject::VertexBufferObject(GLfloat *vertices, GLsizeiptr size) {
-    glGenBuffers(1, &ID);
-    glBindBuffer(GL_ARRAY_BUFFER, ID);
+    TRACE_SCOPE("VertexBufferObject::VertexBufferObject");
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, ID());
     glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 
-void VertexBufferObject::Bind() { glBindBuffer(GL_ARRAY_BUFFER, ID); }
+VertexBufferObject::VertexBufferObject(const void *data, GLsizeiptr size) {
+    TRACE_SCOPE("VertexBufferObject::VertexBufferObject");
+    buffer = GLBuffer::Create();
+    glBindBuffer(GL_ARRAY_BUFFER, ID());
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+}
+
+void VertexBufferObject::Bind() { glBindBuffer(GL_ARRAY_BUFFER, ID()); }
 
 void VertexBufferObject::Unbind() { glBindBuffer(GL_ARRAY_BUFFER, 0); }
 
-void VertexBufferObject::Delete() { glDeleteBuffers(1, &ID); }
+void VertexBufferObject::Delete() { buffer.Reset(); }
+
+GLuint VertexBufferObject::ID() const { return buffer.Name(); }
@@ -1,17 +1,21 @@
 #ifndef VERTEX_BUFFER_OBJECT
 #define VERTEX_BUFFER_OBJECT
 
+#include "GLHandlePool.h"
 #include "../glad/glad.h"
 
 class VertexBufferObject {
   public:
-    // Reference ID of the Vertex Buffer Object.
-    unsigned int ID;
+    // Name of the VBO, 0 once deleted.
+    GLuint ID() const;
 
     // Constructor that generates a Vertex Buffer Object and links it to
     // vertices.
     VertexBufferObject(GLfloat *vertices, GLsizeiptr size);
 
+    // Constructor that uploads size bytes of vertex data in any layout.
+    VertexBufferObject(const void *data, GLsizeiptr size);
+
     // Binds the VBO.
     void Bind();
 
@@ -20,6 +24,9 @@ class VertexBufferObject {
 
     // Deletes the VBO.
     void Delete();
+
+  private:
+    GLBuffer buffer;
 };
 
 #endif
@@ -0,0 +1,404 @@
+#include "VirtualTexture.h"
+#include "Log.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Requests handed to the workers and not uploaded yet, per allowed upload.
+const unsigned int PENDING_PER_UPLOAD = 4;
+
+int PageLevel(uint32_t page) { return (int)(page >> 16); }
+int PageX(uint32_t page) { return (int)(page & 0xff); }
+int PageY(uint32_t page) { return (int)((page >> 8) & 0xff); }
+
+} // namespace
+
+VirtualTexture::VirtualTexture(int pages, int cacheSlots, TileSource source,
+                               int feedbackWidth, int feedbackHeight,
+                               unsigned int workerThreads,
+                               unsigned int uploadsPerFrame)
+    : pages(pages), levels(1), cacheSlots(cacheSlots),
+      uploadsPerFrame(uploadsPerFrame), source(std::move(source)),
+      feedback(feedbackWidth, feedbackHeight),
+      slots((size_t)cacheSlots * cacheSlots) {
+    TRACE_SCOPE("VirtualTexture::VirtualTexture");
+    if (pages < 1 || pages > MAX_PAGES || (pages & (pages - 1)) != 0) {
+        LOG_ERROR("Virtual texture pages %d is not a power of two up to %d",
+                  pages, MAX_PAGES);
+        this->pages = pages = 1;
+    }
+    while ((1 << (levels - 1)) < pages) {
+        levels++;
+    }
+
+    // One texel per page and level, read without filtering.
+    pageTable = GLTexture::Create();
+    glBindTexture(GL_TEXTURE_2D, pageTable.Name());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (int level = 0; level < levels; level++) {
+        int size = pages >> level;
+        pageSlots.emplace_back((size_t)size * size, -1);
+        pageTableLevels.emplace_back((size_t)size * size * 4, 0);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, size, size, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    cache = GLTexture::Create();
+    glBindTexture(GL_TEXTURE_2D, cache.Name());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSlots * SLOT_SIZE,
+                 cacheSlots * SLOT_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLBuffer::Create(readbackBuffers, FEEDBACK_LATENCY + 1);
+    for (const GLBuffer &buffer : readbackBuffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.Name());
+        glBufferData(GL_PIXEL_PACK_BUFFER,
+                     (GLsizeiptr)feedbackWidth * feedbackHeight * 4, nullptr,
+                     GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // The coarsest page is the fallback of every other one.
+    Tile tile = {MakePage(levels - 1, 0, 0),
+                 std::vector<unsigned char>(SLOT_SIZE * SLOT_SIZE * 4)};
+    this->source(levels - 1, 0, 0, tile.texels.data());
+    UploadTile(tile);
+    slots[SlotOf(tile.page)].lastSeen = ~0ull;
+    UpdatePageTable();
+
+    for (unsigned int i = 0; i < workerThreads; i++) {
+        workers.emplace_back(&VirtualTexture::WorkLoop, this);
+    }
+}
+
+VirtualTexture::~VirtualTexture() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+VirtualTexture::Page VirtualTexture::MakePage(int level, int x, int y) {
+    return ((Page)level << 16) | ((Page)y << 8) | (Page)x;
+}
+
+int &VirtualTexture::SlotOf(Page page) {
+    int size = pages >> PageLevel(page);
+    return pageSlots[PageLevel(page)][PageY(page) * size + PageX(page)];
+}
+
+void VirtualTexture::Bind(const Shader &shader, GLuint pageTableUnit,
+                          GLuint cacheUnit, float lodBias) {
+    glActiveTexture(GL_TEXTURE0 + pageTableUnit);
+    glBindTexture(GL_TEXTURE_2D, pageTable.Name());
+    glActiveTexture(GL_TEXTURE0 + cacheUnit);
+    glBindTexture(GL_TEXTURE_2D, cache.Name());
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("pageTable", (int)pageTableUnit);
+    shader.setInt("pageCache", (int)cacheUnit);
+    shader.setFloat("virtualPages", (float)pages);
+    shader.setFloat("cacheSlots", (float)cacheSlots);
+    shader.setFloat("maxLevel", (float)(levels - 1));
+    shader.setFloat("lodBias", lodBias);
+}
+
+void VirtualTexture::BeginFeedback() {
+    feedback.Bind();
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::EndFeedback() {
+    // Every buffer is still waiting for the GPU; skip this frame's.
+    if (readbackFences[readbackHead] != nullptr) {
+        droppedFeedbacks++;
+        feedback.Unbind();
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, feedback.ID());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[readbackHead].Name());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, feedback.width, feedback.height, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readbackFences[readbackHead] =
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readbackHead = (readbackHead + 1) % (FEEDBACK_LATENCY + 1);
+    feedback.Unbind();
+}
+
+void VirtualTexture::Update() {
+    TRACE_SCOPE("VirtualTexture::Update");
+    glActiveTexture(GL_TEXTURE0);
+    ReadFeedback();
+
+    // Coarse pages were queued first, so they are uploaded first too.
+    for (unsigned int i = 0; i < uploadsPerFrame; i++) {
+        Tile tile;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (finished.empty()) {
+                break;
+            }
+            tile = std::move(finished.front());
+            finished.pop_front();
+        }
+        pending.erase(tile.page);
+        // With no slot free the page is dropped, and asked for again by the
+        // next feedback that still wants it.
+        if (SlotOf(tile.page) < 0) {
+            UploadTile(tile);
+        }
+    }
+
+    if (pageTableDirty) {
+        UpdatePageTable();
+    }
+    updates++;
+}
+
+void VirtualTexture::ReadFeedback() {
+    GLsync fence = readbackFences[readbackTail];
+    if (fence == nullptr ||
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) ==
+            GL_TIMEOUT_EXPIRED) {
+        return;
+    }
+    glDeleteSync(fence);
+    readbackFences[readbackTail] = nullptr;
+
+    TRACE_SCOPE("read feedback");
+    size_t texels = (size_t)feedback.width * feedback.height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[readbackTail].Name());
+    const unsigned char *data = (const unsigned char *)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)texels * 4, GL_MAP_READ_BIT);
+    readbackTail = (readbackTail + 1) % (FEEDBACK_LATENCY + 1);
+    seen.clear();
+    if (data != nullptr) {
+        // Cleared texels have alpha 0; written ones are x, y, level, 255.
+        for (size_t i = 0; i < texels; i++) {
+            const unsigned char *texel = data + i * 4;
+            int level = texel[2];
+            if (texel[3] != 255 || level >= levels ||
+                texel[0] >= (pages >> level) || texel[1] >= (pages >> level)) {
+                continue;
+            }
+            seen.push_back(MakePage(level, texel[0], texel[1]));
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+
+    // A missing page needs every missing ancestor down from its finest
+    // resident one, which is what is drawn meanwhile and must stay.
+    lastFeedback = updates;
+    requestedPages = seen.size();
+    missingPages = 0;
+    missing.clear();
+    for (Page page : seen) {
+        missingPages += SlotOf(page) < 0;
+        for (int level = PageLevel(page); level < levels; level++) {
+            int shift = level - PageLevel(page);
+            Page ancestor =
+                MakePage(level, PageX(page) >> shift, PageY(page) >> shift);
+            int slot = SlotOf(ancestor);
+            if (slot >= 0) {
+                if (slots[slot].lastSeen < updates) {
+                    slots[slot].lastSeen = updates;
+                }
+                break;
+            }
+            if (pending.count(ancestor) == 0) {
+                missing.push_back(ancestor);
+            }
+        }
+    }
+
+    // Coarsest first, since each one sharpens the most pixels.
+    std::sort(missing.begin(), missing.end(), [](Page a, Page b) {
+        return PageLevel(a) != PageLevel(b) ? PageLevel(a) > PageLevel(b)
+                                            : a < b;
+    });
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    size_t maxPending = (size_t)uploadsPerFrame * PENDING_PER_UPLOAD;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Page page : missing) {
+            if (pending.size() >= maxPending) {
+                break;
+            }
+            pending.insert(page);
+            queued.push_back(page);
+        }
+    }
+    wake.notify_all();
+    feedbackReadbacks++;
+}
+
+bool VirtualTexture::UploadTile(const Tile &tile) {
+    // A free slot, else the one seen longest ago before the last feedback.
+    int best = -1;
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (!slots[i].used) {
+            best = (int)i;
+            break;
+        }
+        if (slots[i].lastSeen < lastFeedback &&
+            (best < 0 || slots[i].lastSeen < slots[best].lastSeen)) {
+            best = (int)i;
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+
+    Slot &slot = slots[best];
+    if (slot.used) {
+        SlotOf(slot.page) = -1;
+        evictedPages++;
+        residentPages--;
+    }
+    slot.page = tile.page;
+    slot.used = true;
+    slot.lastSeen = updates;
+    SlotOf(tile.page) = best;
+    residentPages++;
+    uploadedPages++;
+    pageTableDirty = true;
+
+    glBindTexture(GL_TEXTURE_2D, cache.Name());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, best % cacheSlots * SLOT_SIZE,
+                    best / cacheSlots * SLOT_SIZE, SLOT_SIZE, SLOT_SIZE,
+                    GL_RGBA, GL_UNSIGNED_BYTE, tile.texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void VirtualTexture::UpdatePageTable() {
+    TRACE_SCOPE("update page table");
+    glBindTexture(GL_TEXTURE_2D, pageTable.Name());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int level = levels - 1; level >= 0; level--) {
+        int size = pages >> level;
+        const int *levelSlots = pageSlots[level].data();
+        unsigned char *entries = pageTableLevels[level].data();
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                unsigned char *entry = entries + (y * size + x) * 4;
+                int slot = levelSlots[y * size + x];
+                if (slot >= 0) {
+                    entry[0] = (unsigned char)(slot % cacheSlots);
+                    entry[1] = (unsigned char)(slot / cacheSlots);
+                    entry[2] = (unsigned char)level;
+                    entry[3] = 255;
+                } else if (level + 1 < levels) {
+                    // The parent's entry is already final.
+                    memcpy(entry,
+                           pageTableLevels[level + 1].data() +
+                               ((y / 2) * (size / 2) + x / 2) * 4,
+                           4);
+                }
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, size, size, GL_RGBA,
+                        GL_UNSIGNED_BYTE, entries);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    pageTableDirty = false;
+}
+
+void VirtualTexture::WorkLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (stopping) {
+            return;
+        }
+        Tile tile = {queued.front(), {}};
+        queued.pop_front();
+        lock.unlock();
+
+        tile.texels.resize(SLOT_SIZE * SLOT_SIZE * 4);
+        {
+            TRACE_SCOPE("VirtualTexture tile");
+            source(PageLevel(tile.page), PageX(tile.page), PageY(tile.page),
+                   tile.texels.data());
+        }
+
+        lock.lock();
+        finished.push_back(std::move(tile));
+    }
+}
+
+size_t VirtualTexture::CacheBytes() const {
+    return (size_t)cacheSlots * SLOT_SIZE * cacheSlots * SLOT_SIZE * 4;
+}
+
+size_t VirtualTexture::PageTableBytes() const {
+    size_t bytes = 0;
+    for (const std::vector<unsigned char> &level : pageTableLevels) {
+        bytes += level.size();
+    }
+    return bytes;
+}
+
+size_t VirtualTexture::VirtualBytes() const {
+    size_t bytes = 0;
+    for (int level = 0; level < levels; level++) {
+        size_t side = (size_t)(pages >> level) * PAGE_SIZE;
+        bytes += side * side * 4;
+    }
+    return bytes;
+}
+
+size_t VirtualTexture::ResidentPages() const { return residentPages; }
+
+size_t VirtualTexture::RequestedPages() const { return requestedPages; }
+
+size_t VirtualTexture::MissingPages() const { return missingPages; }
+
+size_t VirtualTexture::PendingPages() const { return pending.size(); }
+
+size_t VirtualTexture::UploadedPages() const { return uploadedPages; }
+
+size_t VirtualTexture::EvictedPages() const { return evictedPages; }
+
+size_t VirtualTexture::FeedbackReadbacks() const { return feedbackReadbacks; }
+
+size_t VirtualTexture::DroppedFeedbacks() const { return droppedFeedbacks; }
+
+void VirtualTexture::Delete() {
+    pageTable.Reset();
+    cache.Reset();
+    feedback.Delete();
+    for (GLBuffer &buffer : readbackBuffers) {
+        buffer.Reset();
+    }
+    for (GLsync &fence : readbackFences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include "FrameBufferObject.h"
+#include "GLHandlePool.h"
+#include "Shader.h"
+#include "../glad/glad.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Sparse virtual texture: a texture far larger than GPU memory, of which
+// only the pages on screen are resident.
+//
+// The virtual texture is split into PAGE_SIZE square pages at every mip
+// level. Resident pages live in slots of one physical cache texture, and a
+// page table texture with a mip chain maps every virtual page to the slot
+// of its finest resident ancestor, so a sample always finds something.
+//
+// Each frame the scene is drawn once more into a small feedback target
+// with the feedback shader, which writes the page every pixel wants. The
+// target is read back through pixel buffers once the GPU has finished it,
+// without stalling. Update turns the pages seen into requests, coarse levels
+// first. Worker threads produce the requested pages through the
+// TileSource, and Update uploads them into the least recently seen slots.
+// GPU memory is therefore the cache size chosen for the screen, whatever
+// the size of the virtual texture.
+//
+// Shaders: src/shaders/virtualTextureFragmentShader.glsl samples the
+// texture and virtualTextureFeedbackShader.glsl writes the feedback; their
+// PAGE_SIZE and PAGE_BORDER must match the constants below.
+class VirtualTexture {
+  public:
+    // Texels per side of a page, and of the neighbouring texels stored
+    // around it in the cache so bilinear filtering does not bleed.
+    static constexpr int PAGE_SIZE = 128;
+    static constexpr int PAGE_BORDER = 1;
+    static constexpr int SLOT_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+
+    // Largest page count per side; page coordinates are stored in bytes.
+    static constexpr int MAX_PAGES = 256;
+
+    // Feedback readbacks that may be in flight. Further feedback is
+    // dropped until the GPU catches up.
+    static constexpr int FEEDBACK_LATENCY = 2;
+
+    // Writes the SLOT_SIZE x SLOT_SIZE RGBA8 texels of page (x, y) of a mip
+    // level to out: level texels from (x * PAGE_SIZE - PAGE_BORDER,
+    // y * PAGE_SIZE - PAGE_BORDER), bottom row first. Called on the worker
+    // threads, so it must be thread-safe.
+    typedef std::function<void(int level, int x, int y, unsigned char *out)>
+        TileSource;
+
+    // Constructor for a virtual texture of pages x pages level 0 pages, a
+    // power of two up to MAX_PAGES, with a cache of cacheSlots x cacheSlots
+    // pages. The feedback target is feedbackWidth x feedbackHeight; at most
+    // uploadsPerFrame pages are uploaded per Update. Loads the coarsest
+    // page, which stays resident, before returning.
+    VirtualTexture(int pages, int cacheSlots, TileSource source,
+                   int feedbackWidth, int feedbackHeight,
+                   unsigned int workerThreads = 1,
+                   unsigned int uploadsPerFrame = 16);
+
+    // Stops the workers. Call Delete first to free the GL objects.
+    ~VirtualTexture();
+
+    VirtualTexture(const VirtualTexture &) = delete;
+    VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+    // Binds the page table and the cache to texture units 0, 1, ... and
+    // sets the uniforms of an activated virtual texture or feedback shader.
+    // lodBias is added to the mip level the shader computes; the feedback
+    // pass passes minus log2 of the screen to feedback size ratio.
+    void Bind(const Shader &shader, GLuint pageTableUnit, GLuint cacheUnit,
+              float lodBias = 0.0f);
+
+    // Binds and clears the feedback target. Draw the scene with the
+    // feedback shader, then call EndFeedback, which starts its readback.
+    void BeginFeedback();
+    void EndFeedback();
+
+    // Reads back the oldest finished feedback, requests the missing pages,
+    // uploads the pages the workers finished and updates the page table.
+    // Call once per frame on the GL thread.
+    void Update();
+
+    // Bytes of the page cache and page table, which is all the GPU memory
+    // the texture uses, and of the whole virtual texture with its mips.
+    size_t CacheBytes() const;
+    size_t PageTableBytes() const;
+    size_t VirtualBytes() const;
+
+    size_t ResidentPages() const;
+    // Pages the last feedback asked for, and how many of them were not
+    // resident.
+    size_t RequestedPages() const;
+    size_t MissingPages() const;
+    // Pages requested from the workers and not uploaded yet.
+    size_t PendingPages() const;
+
+    // Totals since construction.
+    size_t UploadedPages() const;
+    size_t EvictedPages() const;
+    size_t FeedbackReadbacks() const;
+    size_t DroppedFeedbacks() const;
+
+    // Deletes the textures, the feedback target and the pixel buffers.
+    void Delete();
+
+  private:
+    // A page is (level << 16) | (y << 8) | x.
+    typedef uint32_t Page;
+
+    struct Slot {
+        Page page;
+        bool used = false;
+        // Update in which the page was last seen in the feedback or
+        // uploaded; the coarsest page is never evicted.
+        unsigned long long lastSeen = 0;
+    };
+
+    struct Tile {
+        Page page;
+        std::vector<unsigned char> texels;
+    };
+
+    int pages;
+    int levels;
+    int cacheSlots;
+    unsigned int uploadsPerFrame;
+    TileSource source;
+
+    GLTexture pageTable;
+    GLTexture cache;
+    FrameBufferObject feedback;
+    GLBuffer readbackBuffers[FEEDBACK_LATENCY + 1];
+    GLsync readbackFences[FEEDBACK_LATENCY + 1] = {};
+    // Next buffer to read into, and oldest one in flight.
+    unsigned int readbackHead = 0;
+    unsigned int readbackTail = 0;
+
+    // Only touched by the GL thread.
+    std::vector<Slot> slots;
+    // Slot of every page of every level, or -1.
+    std::vector<std::vector<int>> pageSlots;
+    std::unordered_set<Page> pending;
+    // Entries of every page table level, RGBA8: slot x, slot y, level.
+    std::vector<std::vector<unsigned char>> pageTableLevels;
+    // Pages of the feedback being read.
+    std::vector<Page> seen;
+    std::vector<Page> missing;
+    bool pageTableDirty = true;
+    unsigned long long updates = 1;
+    // Update that read the last feedback. Slots not seen since are
+    // evictable.
+    unsigned long long lastFeedback = 0;
+    size_t residentPages = 0;
+    size_t requestedPages = 0;
+    size_t missingPages = 0;
+    size_t uploadedPages = 0;
+    size_t evictedPages = 0;
+    size_t feedbackReadbacks = 0;
+    size_t droppedFeedbacks = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Page> queued;
+    std::deque<Tile> finished;
+    bool stopping = false;
+
+    static Page MakePage(int level, int x, int y);
+    int &SlotOf(Page page);
+    void WorkLoop();
+    // Reads back a finished feedback and requests what it asks for.
+    void ReadFeedback();
+    // Uploads a tile into the least recently seen slot, if one is free.
+    bool UploadTile(const Tile &tile);
+    void UpdatePageTable();
+};
+
+#endif
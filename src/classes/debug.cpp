@@ -1,6 +0,0 @@
-#include <iostream>
-
-void LogInfo(const char *msg)
-{
-    std::cout<< msg << std::endl;
-}
@@ -1,8 +0,0 @@
-#ifndef DEBUG_H
-#define DEBUG_H
-
-#include <iostream>
-
-void LogInfo(const char *msg);
-
-#endif
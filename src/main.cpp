@@ -1,22 +1,46 @@
 #include "classes/ElementBufferObject.h"
+#include "classes/FixedTimestep.h"
+#include "classes/FrameBufferObject.h"
+#include "classes/FramePacer.h"
+#include "classes/GLDebug.h"
+#include "classes/GLHandlePool.h"
+#include "classes/GpuProfiler.h"
+#include "classes/HeadlessContext.h"
+#include "classes/Log.h"
 #include "classes/Shader.h"
 #include "classes/Texture.h"
+#include "classes/Trace.h"
+#include "classes/UniformRing.h"
 #include "classes/VertexArrayObject.h"
 #include "classes/VertexBufferObject.h"
-#include "classes/debug.h"
 #include "glad/glad.h"
 #include "stb/stb_image.h"
 #include <GLFW/glfw3.h>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+// State of the simulated quad, interpolated by the renderer.
+struct QuadState {
+    float phase;
+    float scale;
+};
 
 // Prototypes
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void processInput(GLFWwindow *window);
+void stepQuad(QuadState &quad, double seconds);
 
 // Constants
 const unsigned int WINDOW_WIDTH = 800;
 const unsigned int WINDOW_HEIGHT = 600;
+// Frame rate headless mode pretends to run at, so the simulation and the
+// saved image do not depend on how fast the machine renders.
+const double HEADLESS_FPS = 60.0;
+// Seconds per pulse of the simulated quad's size.
+const double QUAD_PULSE_PERIOD = 2.0;
 
 // Vertices.
 float vertices[] = {
@@ -33,32 +57,156 @@ unsigned int indices[] = {
     0, 3, 2  // lower triangle
 };
 
-int main(void) {
-    // Initialisation and configuration.
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-
-    // Create window.
-    GLFWwindow *window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
-                                          "LearnOpenGL", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+int main(int argc, char **argv) {
+    // Command line options.
+    //   --headless       render offscreen without a window or display.
+    //   --frames N       number of frames to render in headless mode.
+    //   --output FILE    save the last headless frame as a PPM image.
+    //   --gl-debug       log GL debug output, synchronously.
+    //   --gl-debug-async log GL debug output without serialising the driver.
+    //   --vsync MODE     off, on or adaptive (the default).
+    //   --fps N          cap the frame rate.
+    //   --frames-in-flight N
+    //                    frames the GPU may queue, 2 by default.
+    //   --no-input-prediction
+    //                    sample input at the start of the frame.
+    //   --sim-rate N     simulation steps per second, 60 by default.
+    //   --sim-inline     step the simulation on the render thread rather
+    //                    than its own; headless mode always does.
+    bool headless = false;
+    bool glDebug = false;
+    bool glDebugSynchronous = false;
+    int headlessFrames = 1;
+    const char *outputPath = NULL;
+    FramePacer::Settings pacing;
+    double simRate = 60.0;
+    bool simThread = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            headlessFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--gl-debug") == 0) {
+            glDebug = true;
+            glDebugSynchronous = true;
+        } else if (strcmp(argv[i], "--gl-debug-async") == 0) {
+            glDebug = true;
+            glDebugSynchronous = false;
+        } else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "off") == 0) {
+                pacing.vsync = VSYNC_OFF;
+            } else if (strcmp(mode, "on") == 0) {
+                pacing.vsync = VSYNC_ON;
+            } else if (strcmp(mode, "adaptive") == 0) {
+                pacing.vsync = VSYNC_ADAPTIVE;
+            } else {
+                LOG_ERROR("Unknown vsync mode: %s", mode);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            pacing.targetFps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 &&
+                   i + 1 < argc) {
+            pacing.maxFramesInFlight = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-input-prediction") == 0) {
+            pacing.predictInput = false;
+        } else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc) {
+            simRate = atof(argv[++i]);
+            if (simRate <= 0.0) {
+                LOG_ERROR("Simulation rate must be positive");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--sim-inline") == 0) {
+            simThread = false;
+        } else {
+            LOG_ERROR("Unknown argument: %s", argv[i]);
+            return -1;
+        }
+    }
+
+    // Writes trace.json at exit when built with -DLEARNGL_TRACE=ON.
+    TRACE_BEGIN_SESSION("trace.json");
+
+    GLFWwindow *window = NULL;
+    HeadlessContext *headlessContext = NULL;
+
+    if (headless) {
+        // Create a surfaceless context, no window or display server needed.
+        headlessContext = new HeadlessContext(3, 3, glDebug);
+        if (!headlessContext->IsValid() || !headlessContext->MakeCurrent()) {
+            LOG_ERROR("Failed to create headless context");
+            headlessContext->Delete();
+            delete headlessContext;
+            return -1;
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress)) {
+            LOG_ERROR("Failed to initialise GLAD");
+            return -1;
+        }
+    } else {
+        // Initialisation and configuration.
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, glDebug);
+
+        // Create window.
+        window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "LearnOpenGL",
+                                  NULL, NULL);
+        if (window == NULL) {
+            LOG_ERROR("Failed to create GLFW window");
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            LOG_ERROR("Failed to initialise GLAD");
+            return -1;
+        }
     }
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialise GLAD" << std::endl;
-        return -1;
+    if (glDebug) {
+        GLDebug::Install(glDebugSynchronous,
+                         headless
+                             ? (GLADloadproc)HeadlessContext::GetProcAddress
+                             : (GLADloadproc)glfwGetProcAddress);
+    }
+
+    // Headless mode never presents, so only the cap and the frames in
+    // flight apply there.
+    if (!headless) {
+        const GLFWvidmode *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (mode != NULL) {
+            pacing.refreshRate = mode->refreshRate;
+        }
+    }
+    FramePacer pacer(pacing);
+    if (!headless) {
+        bool tear = glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                    glfwExtensionSupported("GLX_EXT_swap_control_tear");
+        glfwSwapInterval(pacer.SwapInterval(tear));
+    }
+
+    // Headless mode has no default framebuffer, so render into an FBO.
+    FrameBufferObject *offscreen = NULL;
+    if (headless) {
+        offscreen = new FrameBufferObject(WINDOW_WIDTH, WINDOW_HEIGHT);
+        if (!offscreen->IsComplete()) {
+            LOG_ERROR("Offscreen framebuffer is incomplete");
+            return -1;
+        }
     }
 
     // Create shader.
-    LogInfo("Creating Shaders");
+    LOG_INFO("Creating Shaders");
     Shader shader("../src/shaders/vertexShader.glsl", "../src/shaders/fragmentShader.glsl");
 
     // Generates VAO and binds it.
@@ -84,38 +232,158 @@ int main(void) {
     VBO.Unbind();
     EBO.Unbind();
 
-    // Gets ID of uniform called "scale".
-    unsigned int uniformID = glGetUniformLocation(shader.ID, "scale");
+    // Per-draw constants live in a uniform block fed by a per-frame ring.
+    const unsigned int PER_DRAW_BINDING = 0;
+    shader.bindUniformBlock("PerDraw", PER_DRAW_BINDING);
+    UniformBlockLayout perDrawLayout = shader.getUniformBlockLayout("PerDraw");
+    std::vector<unsigned char> perDraw(perDrawLayout.size);
+    UniformRing uniformRing(64 * 1024);
 
     // Texture stuff
-    LogInfo("creating texture.");
+    LOG_INFO("creating texture.");
     Texture face("../src/resources/texture.png", GL_TEXTURE_2D, GL_TEXTURE0, GL_RGBA,
                  GL_UNSIGNED_BYTE);
     face.textureUnit(shader, "tex0", 0);
 
+    // GPU timings of the frame phases.
+    GpuProfiler gpuProfiler;
+
+    // The simulation steps at a fixed rate, on its own thread unless
+    // headless or --sim-inline, and publishes each state for the renderer.
+    QuadState quad = {0.0f, 1.0f};
+    StateSnapshots<QuadState> snapshots(quad);
+    FixedTimestep simulation(1.0 / simRate,
+                             [&](unsigned long long step, double seconds) {
+                                 stepQuad(quad, seconds);
+                                 snapshots.Publish(quad, step);
+                             });
+    if (!headless && simThread) {
+        simulation.Start();
+    }
+
     // Render loop.
-    while (!glfwWindowShouldClose(window)) {
-        // Input.
-        processInput(window);
+    int frame = 0;
+    while (headless ? frame < headlessFrames : !glfwWindowShouldClose(window)) {
+        TRACE_SCOPE("frame");
+        pacer.BeginFrame();
+
+        // Input, polled as late as the pacer allows.
+        if (!headless) {
+            TRACE_SCOPE("input");
+            glfwPollEvents();
+            processInput(window);
+        } else {
+            offscreen->Bind();
+        }
+        pacer.InputSampled();
+
+        gpuProfiler.BeginFrame();
+        gpuProfiler.BeginScope("frame");
 
         // Rendering the background.
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        {
+            TRACE_SCOPE("clear");
+            GpuScope gpuScope(gpuProfiler, "clear");
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        // Packs the per-draw constants of the frame in one buffer write.
+        GLintptr perDrawOffset;
+        {
+            TRACE_SCOPE("update constants");
+            uniformRing.BeginFrame();
+
+            // Draws one step behind the simulation, blending its last two
+            // states.
+            double now =
+                headless ? frame / HEADLESS_FPS : FixedTimestep::Now();
+            if (!simulation.Running()) {
+                simulation.Advance(now);
+            }
+            QuadState previous, current;
+            unsigned long long step = snapshots.Read(previous, current);
+            float alpha = simulation.Alpha(now, step);
+            float scale =
+                previous.scale + (current.scale - previous.scale) * alpha;
+            memcpy(perDraw.data() + perDrawLayout.members["scale"].offset,
+                   &scale, sizeof(scale));
+            perDrawOffset = uniformRing.Push(perDraw.data(), perDraw.size());
+            uniformRing.Unmap();
+        }
 
         // Rendering the triangle.
-        shader.Activate();
+        {
+            TRACE_SCOPE("draw");
+            GpuScope gpuScope(gpuProfiler, "draw");
+            shader.Activate();
+            uniformRing.BindRange(PER_DRAW_BINDING, perDrawOffset,
+                                  perDraw.size());
+
+            face.Bind();
+            VAO.Bind();
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            uniformRing.EndFrame();
+        }
 
-        // Assigns a value to the uniform. (Must be always done before
-        // activating.)
-        glUniform1f(uniformID, 0.5f);
+        gpuProfiler.EndScope();
+        gpuProfiler.EndFrame();
+        // Fence the GL objects released this frame; delete those of frames
+        // the GPU has finished.
+        GLHandlePool::EndFrame();
+        pacer.EndFrame();
 
-        face.Bind();
-        VAO.Bind();
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        // Swap buffers. Headless mode has nothing to present and never
+        // waits on vsync.
+        if (!headless) {
+            TRACE_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
+        pacer.Presented();
+        frame++;
+    }
+
+    simulation.Stop();
+
+    if (headless && outputPath != NULL) {
+        if (!offscreen->SavePPM(outputPath)) {
+            LOG_ERROR("Failed to write %s", outputPath);
+        }
+    }
 
-        // Call events and swap buffers.
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // Report where the GPU time went.
+    gpuProfiler.Flush();
+    for (const auto &scope : gpuProfiler.Stats()) {
+        LOG_INFO("GPU %s: %.3f ms avg, %.3f ms max over %d frames",
+                 scope.first, scope.second.average, scope.second.max,
+                 scope.second.samples);
+    }
+
+    FramePacer::Stats pacingStats = pacer.GetStats();
+    LOG_INFO("Frame time %.3f ms avg, %.3f ms jitter, %.3f ms p99; "
+             "input to present %.3f ms avg, %.3f ms p99",
+             pacingStats.frameMean, pacingStats.frameJitter,
+             pacingStats.frameP99, pacingStats.latencyMean,
+             pacingStats.latencyP99);
+
+    FixedTimestep::Stats simStats = simulation.GetStats();
+    LOG_INFO("Simulation %llu steps at %.0f Hz, %.3f ms avg, %.3f ms max, "
+             "%llu dropped",
+             simStats.steps, simRate, simStats.stepMean, simStats.stepMax,
+             simStats.droppedSteps);
+
+    if (glDebug) {
+        GLDebug::Counters counters = GLDebug::GetCounters();
+        LOG_INFO("GL debug messages: %llu high, %llu medium, %llu low, "
+                 "%llu notifications, %llu performance warnings, "
+                 "%llu suppressed",
+                 (unsigned long long)counters.high,
+                 (unsigned long long)counters.medium,
+                 (unsigned long long)counters.low,
+                 (unsigned long long)counters.notification,
+                 (unsigned long long)counters.performance,
+                 (unsigned long long)counters.suppressed);
+        GLDebug::Uninstall();
     }
 
     // Delete all the objects created.
@@ -123,10 +391,22 @@ int main(void) {
     VBO.Delete();
     EBO.Delete();
     face.Delete();
+    uniformRing.Delete();
+    pacer.Delete();
+    gpuProfiler.Delete();
     shader.Delete();
-    glfwDestroyWindow(window);
 
-    glfwTerminate();
+    if (headless) {
+        offscreen->Delete();
+        delete offscreen;
+        GLHandlePool::FlushAll();
+        headlessContext->Delete();
+        delete headlessContext;
+    } else {
+        GLHandlePool::FlushAll();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
     return 0;
 }
 
@@ -139,3 +419,10 @@ void processInput(GLFWwindow *window) {
         glfwSetWindowShouldClose(window, true);
     }
 }
+
+void stepQuad(QuadState &quad, double seconds) {
+    const double TWO_PI = 6.283185307179586;
+    quad.phase = (float)std::fmod(
+        quad.phase + TWO_PI * seconds / QUAD_PULSE_PERIOD, TWO_PI);
+    quad.scale = 1.0f + 0.2f * std::sin(quad.phase);
+}
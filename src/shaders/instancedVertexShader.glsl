@@ -0,0 +1,21 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColour;
+layout(location = 2) in vec2 aTextureCoordinate;
+
+// World matrix of the instance, from the per-frame instance buffer.
+layout(location = 3) in mat4 model;
+
+out vec3 ourColour;
+out vec2 textureCoordinate;
+
+// Per-view constants, packed into the frame's uniform ring.
+layout(std140) uniform PerView {
+    mat4 viewProj;
+};
+
+void main() {
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
+    ourColour = aColour;
+    textureCoordinate = aTextureCoordinate;
+}
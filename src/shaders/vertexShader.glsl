@@ -6,8 +6,13 @@ layout(location = 2) in vec2 aTextureCoordinate;
 out vec3 ourColour;
 out vec2 textureCoordinate;
 
+// Per-draw constants, packed into the frame's uniform ring.
+layout(std140) uniform PerDraw {
+    float scale;
+};
+
 void main() {
-    gl_Position = vec4(aPos, 1.0);
+    gl_Position = vec4(aPos * scale, 1.0);
     ourColour = aColour;
     textureCoordinate = aTextureCoordinate;
 }
@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColour;
+
+in vec2 textureCoordinate;
+
+// Must match VirtualTexture::PAGE_SIZE.
+const float PAGE_SIZE = 128.0;
+
+// Set by VirtualTexture::Bind.
+uniform float virtualPages;
+uniform float maxLevel;
+uniform float lodBias;
+
+// Writes the page this pixel wants as x, y, level, 255.
+void main() {
+    vec2 uv = clamp(textureCoordinate, 0.0, 0.99999);
+    vec2 texel = uv * virtualPages * PAGE_SIZE;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+    float level = clamp(floor(lod), 0.0, maxLevel);
+    vec2 page = floor(uv * virtualPages / exp2(level));
+    FragColour = vec4(page, level, 255.0) / 255.0;
+}
@@ -0,0 +1,33 @@
+#version 330 core
+out vec4 FragColour;
+
+in vec2 textureCoordinate;
+
+// Must match VirtualTexture::PAGE_SIZE and PAGE_BORDER.
+const float PAGE_SIZE = 128.0;
+const float PAGE_BORDER = 1.0;
+
+// Set by VirtualTexture::Bind.
+uniform sampler2D pageTable;
+uniform sampler2D pageCache;
+uniform float virtualPages;
+uniform float cacheSlots;
+uniform float maxLevel;
+uniform float lodBias;
+
+void main() {
+    vec2 uv = clamp(textureCoordinate, 0.0, 0.99999);
+    vec2 texel = uv * virtualPages * PAGE_SIZE;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+    float level = clamp(floor(lod), 0.0, maxLevel);
+
+    // Slot and level of the finest resident page covering uv.
+    vec3 entry = floor(textureLod(pageTable, uv, level).rgb * 255.0 + 0.5);
+    vec2 inPage = fract(uv * virtualPages / exp2(entry.b));
+    float slotSize = PAGE_SIZE + 2.0 * PAGE_BORDER;
+    vec2 cacheTexel = entry.rg * slotSize + PAGE_BORDER + inPage * PAGE_SIZE;
+    FragColour =
+        textureLod(pageCache, cacheTexel / (cacheSlots * slotSize), 0.0);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 2) in vec2 aTextureCoordinate;
+
+out vec2 textureCoordinate;
+
+// Per-view constants, packed into the frame's uniform ring.
+layout(std140) uniform PerView {
+    mat4 viewProj;
+};
+
+void main() {
+    gl_Position = viewProj * vec4(aPos, 1.0);
+    textureCoordinate = aTextureCoordinate;
+}
@@ -0,0 +1,85 @@
+#include "../classes/AssetPack.h"
+#include "../classes/AssetPackWriter.h"
+#include "../classes/Mesh.h"
+#include "Test.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const char *const PACK_PATH = "asset_pack_writer_test.pack";
+
+// Bakes a texture whose red channel is red[i] and returns the red channel
+// of its second mip level.
+std::vector<int> SecondMipRed(const std::vector<int> &red, int width,
+                              int height) {
+    std::vector<unsigned char> pixels;
+    for (int value : red) {
+        pixels.insert(pixels.end(), {(unsigned char)value, 0, 0, 255});
+    }
+    AssetPackWriter writer;
+    writer.AddTexture("texture", pixels.data(), width, height);
+    writer.Write(PACK_PATH);
+
+    std::vector<int> mip;
+    {
+        AssetPack pack(PACK_PATH);
+        const AssetPackEntry *entry =
+            pack.Find("texture", ASSET_PACK_TEXTURE);
+        CHECK(entry != nullptr);
+        if (entry != nullptr) {
+            const AssetPackTexture *texture =
+                (const AssetPackTexture *)(pack.Data() + entry->offset);
+            const unsigned char *level = (const unsigned char *)pack.Data() +
+                                         texture->mipOffset[1];
+            for (uint64_t i = 0; i < texture->mipSize[1]; i += 4) {
+                mip.push_back(level[i]);
+            }
+        }
+    }
+    remove(PACK_PATH);
+    return mip;
+}
+
+} // namespace
+
+TEST(AssetPackMipsFoldOddEdgesIn) {
+    // 3x3 to 1x1 averages all nine texels.
+    std::vector<int> mip =
+        SecondMipRed({0, 10, 20, 30, 40, 50, 60, 70, 80}, 3, 3);
+    CHECK_EQUAL((size_t)1, mip.size());
+    if (mip.size() == 1) {
+        CHECK_EQUAL(40, mip[0]);
+    }
+
+    // 5x1 to 2x1: the last texel joins the second block.
+    mip = SecondMipRed({0, 10, 20, 30, 40}, 5, 1);
+    CHECK_EQUAL((size_t)2, mip.size());
+    if (mip.size() == 2) {
+        CHECK_EQUAL(5, mip[0]);
+        CHECK_EQUAL(30, mip[1]);
+    }
+}
+
+TEST(AssetPackRejectsIndicesPastTheVertices) {
+    Mesh mesh;
+    mesh.vertices.assign(3 * Mesh::VERTEX_FLOATS, 0.5f);
+    mesh.indices = {0, 1, 3};
+    AssetPackWriter writer;
+    writer.AddMesh("mesh", mesh);
+    writer.Write(PACK_PATH);
+    {
+        AssetPack pack(PACK_PATH);
+        CHECK(!pack.IsOpen());
+    }
+
+    mesh.indices = {0, 1, 2};
+    AssetPackWriter validWriter;
+    validWriter.AddMesh("mesh", mesh);
+    validWriter.Write(PACK_PATH);
+    {
+        AssetPack pack(PACK_PATH);
+        CHECK(pack.IsOpen());
+    }
+    remove(PACK_PATH);
+}
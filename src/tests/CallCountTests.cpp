@@ -0,0 +1,153 @@
+#include "../classes/GLDispatch.h"
+#include "../classes/GLHandlePool.h"
+#include "../classes/Shader.h"
+#include "../classes/Texture.h"
+#include "../classes/UniformRing.h"
+#include "../classes/VertexArrayObject.h"
+#include "../classes/VertexBufferObject.h"
+#include "MockGL.h"
+#include "Test.h"
+#include <utility>
+
+TEST(ShaderCompilesEachStageOnce) {
+    MockGL mock;
+    Shader shader(LEARNGL_SOURCE_DIR "/shaders/vertexShader.glsl",
+                  LEARNGL_SOURCE_DIR "/shaders/fragmentShader.glsl");
+    CHECK(shader.ID != 0);
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glCreateShader"));
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glCompileShader"));
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glLinkProgram"));
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glDeleteShader"));
+
+    GLDispatch::Reset();
+    shader.Activate();
+    shader.Activate();
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glUseProgram"));
+    CHECK_EQUAL(1u, GLDispatch::StateChanges());
+    CHECK_EQUAL(1u, GLDispatch::RedundantStateCalls());
+    shader.Delete();
+}
+
+TEST(ShaderDeletesItsProgramOnce) {
+    MockGL mock;
+    {
+        Shader shader(LEARNGL_SOURCE_DIR "/shaders/vertexShader.glsl",
+                      LEARNGL_SOURCE_DIR "/shaders/fragmentShader.glsl");
+        Shader moved(std::move(shader));
+        CHECK_EQUAL(0u, shader.ID);
+        CHECK(moved.ID != 0);
+        moved.Delete();
+    }
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glDeleteProgram"));
+}
+
+TEST(TextureUploadsOneLevelAndGeneratesMips) {
+    MockGL mock;
+    Texture texture(LEARNGL_SOURCE_DIR "/resources/texture.png",
+                    GL_TEXTURE_2D, GL_TEXTURE0, GL_RGBA, GL_UNSIGNED_BYTE);
+    CHECK(texture.ID() != 0);
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glTexImage2D"));
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glGenerateMipmap"));
+    CHECK_EQUAL(4u, GLDispatch::CallCount("glTexParameteri"));
+
+    // Upload leaves the texture unbound, so only the second Bind is
+    // redundant.
+    GLDispatch::Reset();
+    texture.Bind();
+    texture.Bind();
+    CHECK_EQUAL(1u, GLDispatch::RedundantStateCalls());
+    texture.Unbind();
+    CHECK_EQUAL(2u, GLDispatch::StateChanges());
+}
+
+TEST(VertexSetupCountsTheRebind) {
+    MockGL mock;
+    float vertices[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f};
+    VertexArrayObject vao;
+    vao.Bind();
+    VertexBufferObject vbo(vertices, sizeof(vertices));
+    vao.LinkAttrib(vbo, 0, 2, GL_FLOAT, 2 * sizeof(float), (void *)0);
+    vao.Unbind();
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glBufferData"));
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glVertexAttribPointer"));
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glEnableVertexAttribArray"));
+    // LinkAttrib binds the VBO its constructor left bound.
+    CHECK_EQUAL(1u, GLDispatch::RedundantStateCalls());
+}
+
+TEST(ShadowTracksBindingsPerTargetAndUnit) {
+    MockGL mock;
+    glBindBuffer(GL_ARRAY_BUFFER, 5);
+    glBindBuffer(GL_ARRAY_BUFFER, 5);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+    CHECK_EQUAL(2u, GLDispatch::StateChanges());
+    CHECK_EQUAL(1u, GLDispatch::RedundantStateCalls());
+
+    // Texture bindings belong to the active unit.
+    GLDispatch::Reset();
+    glBindTexture(GL_TEXTURE_2D, 3);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 3);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 3);
+    CHECK_EQUAL(4u, GLDispatch::StateChanges());
+    CHECK_EQUAL(1u, GLDispatch::RedundantStateCalls());
+
+    GLDispatch::Reset();
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    CHECK_EQUAL(2u, GLDispatch::StateChanges());
+    CHECK_EQUAL(2u, GLDispatch::RedundantStateCalls());
+}
+
+TEST(ShadowForgetsDeletedObjects) {
+    MockGL mock;
+    GLuint buffer = 7;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glDeleteBuffers(1, &buffer);
+    // Deleting a bound buffer unbinds it, so binding the name again is a
+    // change.
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    CHECK_EQUAL(2u, GLDispatch::StateChanges());
+    CHECK_EQUAL(0u, GLDispatch::RedundantStateCalls());
+}
+
+TEST(UniformRingFlushesOncePerFrame) {
+    MockGL mock;
+    // Rounded up to the mock's 256 byte alignment.
+    UniformRing ring(100, 2);
+    float constants[16] = {};
+
+    ring.BeginFrame();
+    CHECK_EQUAL((GLintptr)0, ring.Push(constants, sizeof(constants)));
+    CHECK_EQUAL((GLintptr)-1, ring.Push(constants, sizeof(constants)));
+    ring.EndFrame();
+
+    ring.BeginFrame();
+    CHECK_EQUAL((GLintptr)256, ring.Push(constants, sizeof(constants)));
+    ring.EndFrame();
+
+    CHECK_EQUAL(1u, GLDispatch::CallCount("glBufferData"));
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glMapBufferRange"));
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glFlushMappedBufferRange"));
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glFenceSync"));
+    ring.Delete();
+}
+
+TEST(HandlePoolFlushAllDeletesSpares) {
+    MockGL mock;
+    GLHandlePool &pool = GLHandlePool::Get(GL_OBJECT_BUFFER);
+    GLBuffer buffer = GLBuffer::Create();
+    buffer.Reset();
+
+    // One call for the destroyed buffer, one for the rest of its batch.
+    GLDispatch::Reset();
+    GLHandlePool::FlushAll();
+    CHECK_EQUAL(2u, GLDispatch::CallCount("glDeleteBuffers"));
+
+    size_t generateCalls = pool.GenerateCalls();
+    buffer = GLBuffer::Create();
+    CHECK_EQUAL(generateCalls + 1, pool.GenerateCalls());
+}
@@ -0,0 +1,209 @@
+#include "../classes/FrameArena.h"
+#include "../classes/JobSystem.h"
+#include "Test.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Global operator new and delete are replaced for the whole tests
+// executable, so every C++ allocation, aligned or not, goes through here.
+// Only threads that set countAllocations are counted.
+namespace {
+
+thread_local bool countAllocations = false;
+std::atomic<long long> countedAllocations(0);
+
+void *CountedAllocate(size_t size, size_t alignment) {
+    if (countAllocations) {
+        countedAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *memory = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        memory = std::malloc(size > 0 ? size : 1);
+    } else if (posix_memalign(&memory, alignment, size > 0 ? size : 1) !=
+               0) {
+        memory = nullptr;
+    }
+    return memory;
+}
+
+void *CountedAllocateOrThrow(size_t size, size_t alignment) {
+    void *memory = CountedAllocate(size, alignment);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+    return CountedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void *operator new[](size_t size) {
+    return CountedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void *operator new(size_t size, std::align_val_t alignment) {
+    return CountedAllocateOrThrow(size, (size_t)alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return CountedAllocateOrThrow(size, (size_t)alignment);
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return CountedAllocate(size, alignof(std::max_align_t));
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return CountedAllocate(size, alignof(std::max_align_t));
+}
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+    return CountedAllocate(size, (size_t)alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+    return CountedAllocate(size, (size_t)alignment);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete[](void *memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete(void *memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+void operator delete(void *memory, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+void operator delete[](void *memory, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+const size_t OBJECTS = 100000;
+const size_t GRAIN = 1024;
+
+struct alignas(64) CacheLine {
+    char bytes[64];
+};
+
+// What the jobs of one frame share, so the job lambda captures one pointer
+// and fits in std::function without allocating.
+struct ArenaFrame {
+    ThreadFrameArenas *arenas;
+    unsigned int frame;
+    uint32_t **lists;
+    size_t *counts;
+};
+
+// Builds a sorted list of every fourth object per chunk in the arenas of
+// the job threads, counting heap allocations, and returns their sum.
+uint64_t BuildLists(JobSystem &jobs, ThreadFrameArenas &arenas,
+                    unsigned int frame) {
+    countAllocations = true;
+    size_t chunkCount = (OBJECTS + GRAIN - 1) / GRAIN;
+    FrameArena &local = arenas.Local();
+    ArenaFrame shared = {&arenas, frame,
+                         local.Allocate<uint32_t *>(chunkCount),
+                         local.Allocate<size_t>(chunkCount)};
+    ArenaFrame *pointer = &shared;
+    jobs.ParallelFor(OBJECTS, GRAIN, [pointer](size_t begin, size_t end) {
+        bool counting = countAllocations;
+        countAllocations = true;
+        FrameArena &arena = pointer->arenas->Local();
+        FrameVector<uint32_t> list{FrameAllocator<uint32_t>(arena)};
+        list.reserve((end - begin + 3) / 4);
+        for (size_t i = end; i-- > begin;) {
+            if ((i + pointer->frame) % 4 == 0) {
+                list.push_back((uint32_t)i);
+            }
+        }
+        std::sort(list.begin(), list.end());
+        pointer->lists[begin / GRAIN] = list.data();
+        pointer->counts[begin / GRAIN] = list.size();
+        countAllocations = counting;
+    });
+    countAllocations = false;
+
+    uint64_t sum = 0;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        for (size_t i = 0; i < shared.counts[chunk]; i++) {
+            sum += shared.lists[chunk][i];
+        }
+    }
+    return sum;
+}
+
+} // namespace
+
+TEST(AllocationCounterSeesAlignedNew) {
+    long long before = countedAllocations.load();
+    countAllocations = true;
+    std::vector<int> *plain = new std::vector<int>(16);
+    CacheLine *aligned = new CacheLine[4];
+    countAllocations = false;
+    // The vector object, its storage and the aligned array.
+    CHECK_EQUAL(3, countedAllocations.load() - before);
+    CHECK_EQUAL((uintptr_t)0, (uintptr_t)aligned % 64);
+    delete[] aligned;
+    delete plain;
+}
+
+TEST(FrameArenaJobsDoNotTouchTheHeapAfterWarmUp) {
+    JobSystem jobs(3);
+    ThreadFrameArenas arenas(jobs.ThreadCount(), 256 * 1024);
+
+    // The first frames may allocate the job system's own state.
+    const unsigned int WARMUP = 2;
+    long long allocations = 0;
+    for (unsigned int frame = 0; frame < WARMUP + 8; frame++) {
+        arenas.BeginFrame();
+        long long before = countedAllocations.load();
+        uint64_t sum = BuildLists(jobs, arenas, frame);
+        if (frame >= WARMUP) {
+            allocations += countedAllocations.load() - before;
+        }
+
+        uint64_t expected = 0;
+        for (size_t i = 0; i < OBJECTS; i++) {
+            expected += (i + frame) % 4 == 0 ? i : 0;
+        }
+        CHECK_EQUAL(expected, sum);
+    }
+    CHECK_EQUAL(0, allocations);
+    CHECK_EQUAL((size_t)0, arenas.OverflowAllocations());
+}
+
+TEST(FrameArenaOverflowGoesToTheHeapAndIsCounted) {
+    FrameArena arena(1024, 2);
+    CHECK(arena.Allocate(512) != nullptr);
+    CHECK(arena.Allocate(1024) != nullptr);
+    CHECK_EQUAL((size_t)1, arena.OverflowAllocations());
+    CHECK_EQUAL((size_t)512, arena.Used());
+
+    // Each block starts empty when it comes round again.
+    arena.BeginFrame();
+    arena.BeginFrame();
+    CHECK_EQUAL((size_t)0, arena.Used());
+    CHECK_EQUAL((uintptr_t)0, (uintptr_t)arena.Allocate(8, 64) % 64);
+}
@@ -0,0 +1,34 @@
+#include "../classes/GLDispatch.h"
+#include "../classes/VertexBufferObject.h"
+#include "../glad/glad.h"
+#include "MockGL.h"
+#include "Test.h"
+
+TEST(MockDispatchRunsWithoutContext) {
+    void *before = (void *)glad_glBufferData;
+    {
+        MockGL mock;
+        CHECK((void *)glad_glBufferData != before);
+
+        float vertices[] = {0.0f, 1.0f, 2.0f};
+        VertexBufferObject first(vertices, sizeof(vertices));
+        VertexBufferObject second(vertices, sizeof(vertices));
+        CHECK(first.ID() != 0);
+        CHECK(second.ID() != 0);
+        CHECK(first.ID() != second.ID());
+        CHECK_EQUAL(2u, GLDispatch::CallCount("glBufferData"));
+        CHECK_EQUAL(2u, GLDispatch::CallCount("glBindBuffer"));
+    }
+    CHECK((void *)glad_glBufferData == before);
+}
+
+TEST(MockDispatchResetClearsCounters) {
+    MockGL mock;
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    CHECK_EQUAL(2u, GLDispatch::TotalCalls());
+    GLDispatch::Reset();
+    CHECK_EQUAL(0u, GLDispatch::TotalCalls());
+    CHECK_EQUAL(0u, GLDispatch::CallCount("glBindBuffer"));
+    CHECK(GLDispatch::CallCounts().empty());
+}
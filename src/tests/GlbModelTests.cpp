@@ -0,0 +1,117 @@
+#include "../classes/GlbModel.h"
+#include "../classes/TextureDecoder.h"
+#include "MockGL.h"
+#include "Test.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+const char *const GLB_PATH = "glb_model_test.glb";
+
+// One triangle: three positions in buffer view 0, then three 16 bit indices
+// in buffer view 1. accessors is the JSON of the accessors array.
+void WriteTriangleGlb(const std::string &accessors,
+                      const uint16_t indices[3]) {
+    std::string bin(48, '\0');
+    const float positions[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    bin.replace(0, sizeof(positions), (const char *)positions,
+                sizeof(positions));
+    bin.replace(36, 6, (const char *)indices, 6);
+
+    std::string json =
+        "{\"asset\":{\"version\":\"2.0\"},"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,"
+        "\"COLOR_0\":2},\"indices\":1}]}],"
+        "\"buffers\":[{\"byteLength\":48}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},"
+        "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":12}],"
+        "\"accessors\":" +
+        accessors + "}";
+    json.resize((json.size() + 3) & ~(size_t)3, ' ');
+
+    auto word = [](std::string &out, uint32_t value) {
+        out.append((const char *)&value, sizeof(value));
+    };
+    std::string file;
+    word(file, 0x46546c67);
+    word(file, 2);
+    word(file, (uint32_t)(12 + 8 + json.size() + 8 + bin.size()));
+    word(file, (uint32_t)json.size());
+    word(file, 0x4e4f534a);
+    file += json;
+    word(file, (uint32_t)bin.size());
+    word(file, 0x004e4942);
+    file += bin;
+
+    FILE *out = fopen(GLB_PATH, "wb");
+    fwrite(file.data(), 1, file.size(), out);
+    fclose(out);
+}
+
+const char *const POSITIONS =
+    "{\"bufferView\":0,\"componentType\":5126,\"count\":3,"
+    "\"type\":\"VEC3\"}";
+const char *const INDICES =
+    "{\"bufferView\":1,\"componentType\":5123,\"count\":3,"
+    "\"type\":\"SCALAR\"}";
+const uint16_t TRIANGLE[3] = {0, 1, 2};
+
+// Loads GLB_PATH and returns how many primitives were kept.
+size_t LoadedPrimitives() {
+    MockGL gl;
+    TextureDecoder decoder;
+    GlbModel model(GLB_PATH, decoder);
+    size_t count = model.PrimitiveCount();
+    model.Delete();
+    remove(GLB_PATH);
+    return count;
+}
+
+} // namespace
+
+TEST(GlbModelLoadsValidTriangle) {
+    WriteTriangleGlb(std::string("[") + POSITIONS + "," + INDICES + "]",
+                     TRIANGLE);
+    CHECK_EQUAL((size_t)1, LoadedPrimitives());
+}
+
+TEST(GlbModelRejectsAccessorWhoseEndWraps) {
+    // 2^62: (count - 1) * 12 + 12 wraps to 0 in 64 bits.
+    WriteTriangleGlb("[{\"bufferView\":0,\"componentType\":5126,"
+                     "\"count\":4611686018427387904,\"type\":\"VEC3\"}," +
+                         std::string(INDICES) + "]",
+                     TRIANGLE);
+    CHECK_EQUAL((size_t)0, LoadedPrimitives());
+}
+
+TEST(GlbModelRejectsFractionalAndHugeNumbers) {
+    WriteTriangleGlb("[{\"bufferView\":0,\"componentType\":5126,"
+                     "\"count\":2.5,\"type\":\"VEC3\"}," +
+                         std::string(INDICES) + "]",
+                     TRIANGLE);
+    CHECK_EQUAL((size_t)0, LoadedPrimitives());
+
+    WriteTriangleGlb("[{\"bufferView\":1e300,\"componentType\":5126,"
+                     "\"count\":3,\"type\":\"VEC3\"}," +
+                         std::string(INDICES) + "]",
+                     TRIANGLE);
+    CHECK_EQUAL((size_t)0, LoadedPrimitives());
+}
+
+TEST(GlbModelSkipsOutOfRangeIndices) {
+    const uint16_t outOfRange[3] = {0, 1, 3};
+    WriteTriangleGlb(std::string("[") + POSITIONS + "," + INDICES + "]",
+                     outOfRange);
+    CHECK_EQUAL((size_t)0, LoadedPrimitives());
+}
+
+TEST(GlbModelSkipsMismatchedAttributeCounts) {
+    // COLOR_0 has two elements for three vertices.
+    WriteTriangleGlb(std::string("[") + POSITIONS + "," + INDICES +
+                         ",{\"bufferView\":0,\"componentType\":5126,"
+                         "\"count\":2,\"type\":\"VEC3\"}]",
+                     TRIANGLE);
+    CHECK_EQUAL((size_t)0, LoadedPrimitives());
+}
@@ -0,0 +1,22 @@
+#ifndef MOCK_GL_H
+#define MOCK_GL_H
+
+#include "../classes/GLDispatch.h"
+#include "../classes/GLHandlePool.h"
+
+// Installs the GLDispatch mock for the lifetime of a test, so wrapper
+// classes run without a context, and deletes what the test left in the
+// handle pools before restoring the dispatch.
+struct MockGL {
+    MockGL() { GLDispatch::InstallRecording(GLDispatch::Mock); }
+
+    ~MockGL() {
+        GLHandlePool::FlushAll();
+        GLDispatch::Uninstall();
+    }
+
+    MockGL(const MockGL &) = delete;
+    MockGL &operator=(const MockGL &) = delete;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <sstream>
+#include <string>
+
+// Minimal self-registering unit tests, run by the tests executable.
+//
+//   TEST(FrameArenaReusesBlocks) {
+//       CHECK(arena.Used() == 0);
+//       CHECK_EQUAL(3u, arena.OverflowAllocations());
+//   }
+//
+// A failed check is reported with its file and line and the test carries
+// on, so one run shows every failure.
+namespace Test {
+
+typedef void (*Function)();
+
+// Adds a test to the list the tests executable runs.
+struct Registration {
+    Registration(const char *name, Function function);
+};
+
+// Records a failed check in the running test.
+void Fail(const char *file, int line, const std::string &message);
+
+template <typename T> std::string Describe(const T &value) {
+    std::ostringstream text;
+    text << value;
+    return text.str();
+}
+
+template <typename A, typename B>
+void CheckEqual(const A &expected, const B &actual, const char *file,
+                int line, const char *expression) {
+    if (!(expected == actual)) {
+        Fail(file, line,
+             std::string(expression) + ": expected " + Describe(expected) +
+                 ", got " + Describe(actual));
+    }
+}
+
+} // namespace Test
+
+#define TEST(name)                                                             \
+    static void name();                                                        \
+    static Test::Registration name##Registration(#name, name);                 \
+    static void name()
+
+#define CHECK(expression)                                                      \
+    ((expression) ? (void)0 : Test::Fail(__FILE__, __LINE__, #expression))
+
+#define CHECK_EQUAL(expected, actual)                                          \
+    Test::CheckEqual((expected), (actual), __FILE__, __LINE__, #actual)
+
+#endif
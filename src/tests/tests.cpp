@@ -0,0 +1,64 @@
+// Unit tests of the wrapper classes. GL is mocked through GLDispatch, so
+// the tests need no GPU and no context.
+//
+//   tests            runs every test.
+//   tests NAME       runs the tests whose name contains NAME.
+//
+// Exits with 1 if any check failed.
+
+#include "../classes/Log.h"
+#include "Test.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct TestCase {
+    const char *name;
+    Test::Function function;
+};
+
+// Function-local so registrations from other files can run first.
+std::vector<TestCase> &Tests() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+int failures = 0;
+
+} // namespace
+
+namespace Test {
+
+Registration::Registration(const char *name, Function function) {
+    Tests().push_back({name, function});
+}
+
+void Fail(const char *file, int line, const std::string &message) {
+    fprintf(stderr, "  %s:%d: %s\n", file, line, message.c_str());
+    failures++;
+}
+
+} // namespace Test
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    Log::Start(stderr);
+
+    int run = 0, failed = 0;
+    for (const TestCase &test : Tests()) {
+        if (filter != NULL && strstr(test.name, filter) == NULL) {
+            continue;
+        }
+        int before = failures;
+        test.function();
+        bool passed = failures == before;
+        printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+        run++;
+        failed += !passed;
+    }
+
+    printf("%d tests, %d failed\n", run, failed);
+    return failed > 0 ? 1 : 0;
+}